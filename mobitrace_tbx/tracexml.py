@@ -38,15 +38,34 @@ def saveDocument(doc,filename):
   """
   Save the generated XML document to file
   """
+  addSizeHints(doc);
   file_object = open(filename,"w");
   xml.dom.ext.PrettyPrint(doc,file_object);
   file_object.close();
   
   
+def addSizeHints(doc):
+  """
+  Add the number of nodes and waypoint records as attributes of the root element.
+  The NodeFactory uses these hints to pre-size its per-node waypoint lists.
+  """
+  root = doc.documentElement;
+  nodes = {};
+  records = 0;
+  for element in root.childNodes:
+    if element.nodeType != element.ELEMENT_NODE: continue;
+    if element.tagName == WAYPOINT_NODE_NAME: records += 1;
+    for child in element.getElementsByTagName(ID_LABEL):
+      nodes[child.firstChild.data.strip()] = 1;
+  root.setAttribute("nodes",str(len(nodes)));
+  root.setAttribute("records",str(records));
+
+
 def createRootNode():
   """
   Create the root XML document node. Returns the XML document and the root element.
-  """  doc = xml.dom.minidom.Document();
+  """
+  doc = xml.dom.minidom.Document();
   root_element = doc.createElement(ROOT_NODE_NAME);
   doc.appendChild(root_element);
   return doc,root_element;
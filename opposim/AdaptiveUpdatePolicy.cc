@@ -0,0 +1,73 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "AdaptiveUpdatePolicy.h"
+
+AdaptiveUpdatePolicy::AdaptiveUpdatePolicy() 
+  : m_intervals( "updateInterval", UPDATE_INTERVAL_HISTOGRAM_CELLS )
+{
+  m_maxError = 0.0;
+  m_minInterval = 0.0;
+  m_maxInterval = 0.0;
+  m_observerError = 0.0;
+}
+
+void AdaptiveUpdatePolicy::configure( double maxError, double minInterval, double maxInterval )
+{
+  m_maxError = maxError;
+  m_minInterval = minInterval;
+  m_maxInterval = maxInterval;
+  m_observerError = 0.0;
+  m_intervals.clearResult();
+}
+
+double AdaptiveUpdatePolicy::nextInterval( double speed, double fixedInterval, double horizon )
+{
+  if ( !enabled() )
+    return fixedInterval;
+
+  double maxError = m_maxError;
+  if ( m_observerError > 0.0 && m_observerError < maxError )
+    maxError = m_observerError;
+
+  double interval = speed > 0.0 ? maxError / speed : m_maxInterval;
+  if ( interval > m_maxInterval )
+    interval = m_maxInterval;
+  if ( interval < m_minInterval )
+    interval = m_minInterval;
+  // Events known ahead, such as the end of a pause, are not overshot
+  if ( horizon > 0.0 && horizon < interval )
+    interval = horizon;
+
+  m_intervals.collect( interval );
+  return interval;
+}
+
+void AdaptiveUpdatePolicy::recordScalar( const char *name )
+{
+  if ( m_intervals.samples() > 0 )
+    m_intervals.recordScalar( name );
+}
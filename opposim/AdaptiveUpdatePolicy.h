@@ -0,0 +1,83 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __ADAPTIVE_UPDATE_POLICY_INCLUDED__
+#define __ADAPTIVE_UPDATE_POLICY_INCLUDED__
+
+#include <omnetpp.h>
+
+// Number of cells of the histogram of chosen update intervals
+#define UPDATE_INTERVAL_HISTOGRAM_CELLS 20
+
+/**
+ * @brief Chooses the update interval of a mobility module from a position error budget.
+ *
+ * A node moving at a given speed is at most speed * interval meters from its last
+ * published position when it is next updated. The policy picks the longest interval
+ * keeping that distance within the maximum position error, bounded by a minimum and
+ * a maximum interval. A node which does not move is updated at the maximum interval,
+ * and an interval may be cut short by an event known ahead, such as the end of a pause.
+ *
+ * Observers which need the position of a node at a finer resolution, e.g. a channel
+ * control tracking nodes in a dense cluster, request a smaller error with 
+ * setObserverError(). The smaller of the two errors is used until the request is 
+ * cleared. A zero maximum error disables the policy and the fixed interval is used.
+ *
+ * The chosen intervals are collected into a histogram.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class AdaptiveUpdatePolicy
+{
+  private:
+    double m_maxError;
+    double m_minInterval;
+    double m_maxInterval;
+    /** @brief The error requested by observers, zero if none */
+    double m_observerError;
+    cDoubleHistogram m_intervals;
+
+  public:
+    /** @brief Constructor. The policy is disabled until configured. */
+    AdaptiveUpdatePolicy();
+
+    /** @brief Sets the maximum position error in meters and the interval bounds in 
+               seconds. Clears the observer error and the histogram. */
+    void configure( double maxError, double minInterval, double maxInterval );
+    /** @brief Returns true if the interval is chosen adaptively */
+    bool enabled() const { return m_maxError > 0.0; }
+    /** @brief Sets the maximum position error requested by observers. Zero clears it. */
+    void setObserverError( double maxError ) { m_observerError = maxError; }
+
+    /** @brief Returns the interval until the next update of a node moving at a speed.
+               The fixed interval is returned if the policy is disabled. A positive 
+               horizon caps the interval. */
+    double nextInterval( double speed, double fixedInterval, double horizon = 0.0 );
+    /** @brief Records the histogram of chosen intervals as scalars */
+    void recordScalar( const char *name );
+};
+
+#endif /* __ADAPTIVE_UPDATE_POLICY_INCLUDED__ */
@@ -0,0 +1,371 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "BinaryTrace.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Record orderings used by BinaryTraceWriter::sortRecords() and groupRecords()
+ */
+struct CommandTimeLess
+{
+  bool operator()( const BINARY_COMMAND_RECORD &a, const BINARY_COMMAND_RECORD &b ) const
+  {
+    return a.time < b.time;
+  }
+};
+
+struct WaypointNodeTimeLess
+{
+  bool operator()( const BINARY_WAYPOINT_RECORD &a, const BINARY_WAYPOINT_RECORD &b ) const
+  {
+    return a.nodeId < b.nodeId || ( a.nodeId == b.nodeId && a.time < b.time );
+  }
+};
+
+struct WaypointNodeLess
+{
+  bool operator()( const BINARY_WAYPOINT_RECORD &a, const BINARY_WAYPOINT_RECORD &b ) const
+  {
+    return a.nodeId < b.nodeId;
+  }
+};
+
+struct ContactNodeLess
+{
+  bool operator()( const BINARY_CONTACT_RECORD &a, const BINARY_CONTACT_RECORD &b ) const
+  {
+    return a.nodeId < b.nodeId;
+  }
+};
+
+struct ContactNodeTimeLess
+{
+  bool operator()( const BINARY_CONTACT_RECORD &a, const BINARY_CONTACT_RECORD &b ) const
+  {
+    return a.nodeId < b.nodeId || ( a.nodeId == b.nodeId && a.time < b.time );
+  }
+};
+
+//
+// BinaryTraceReader
+//
+
+BinaryTraceReader::BinaryTraceReader()
+{
+  m_base = NULL;
+  m_size = 0;
+}
+
+BinaryTraceReader::~BinaryTraceReader()
+{
+  close();
+}
+
+bool BinaryTraceReader::open( const char *filename )
+{
+  close();
+
+  int fd = ::open( filename, O_RDONLY );
+  if ( fd < 0 )
+  {
+    m_lastError = "Unable to open binary trace file";
+    return false;
+  }
+
+  struct stat st;
+  if ( fstat( fd, &st ) != 0 || (size_t)st.st_size < sizeof(BINARY_TRACE_HEADER) )
+  {
+    ::close(fd);
+    m_lastError = "Binary trace file is truncated";
+    return false;
+  }
+
+  // A shared read-only mapping. Processes mapping the same trace use the same
+  // physical pages.
+  void *base = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+  ::close(fd);
+  if ( base == MAP_FAILED )
+  {
+    m_lastError = "Unable to map binary trace file";
+    return false;
+  }
+  m_base = (const char *)base;
+  m_size = st.st_size;
+
+  // The records are read sequentially when the trace is loaded.
+  madvise( base, m_size, MADV_SEQUENTIAL );
+
+  const BINARY_TRACE_HEADER *hdr = header();
+  if ( hdr->magic != BINARY_TRACE_MAGIC )
+  {
+    close();
+    m_lastError = "Not a binary trace file or wrong byte order";
+    return false;
+  }
+  if ( hdr->version != BINARY_TRACE_VERSION )
+  {
+    close();
+    m_lastError = "Unsupported binary trace version";
+    return false;
+  }
+
+  size_t expected = sizeof(BINARY_TRACE_HEADER)
+                  + (size_t)hdr->commandCount * sizeof(BINARY_COMMAND_RECORD)
+                  + (size_t)hdr->waypointCount * sizeof(BINARY_WAYPOINT_RECORD)
+                  + (size_t)hdr->contactCount * sizeof(BINARY_CONTACT_RECORD)
+                  + hdr->stringTableSize;
+  if ( expected != m_size || hdr->stringTableSize == 0 || m_base[m_size-1] != '\0' )
+  {
+    close();
+    m_lastError = "Binary trace file size does not match its header";
+    return false;
+  }
+
+  return true;
+}
+
+void BinaryTraceReader::close()
+{
+  if ( m_base != NULL )
+    munmap( (void *)m_base, m_size );
+  m_base = NULL;
+  m_size = 0;
+}
+
+const BINARY_TRACE_HEADER *BinaryTraceReader::header() const
+{
+  return (const BINARY_TRACE_HEADER *)m_base;
+}
+
+const BINARY_COMMAND_RECORD *BinaryTraceReader::commands() const
+{
+  return (const BINARY_COMMAND_RECORD *)( m_base + sizeof(BINARY_TRACE_HEADER) );
+}
+
+const BINARY_WAYPOINT_RECORD *BinaryTraceReader::waypoints() const
+{
+  return (const BINARY_WAYPOINT_RECORD *)( commands() + header()->commandCount );
+}
+
+const BINARY_CONTACT_RECORD *BinaryTraceReader::contacts() const
+{
+  return (const BINARY_CONTACT_RECORD *)( waypoints() + header()->waypointCount );
+}
+
+const char *BinaryTraceReader::string( uint32_t offset ) const
+{
+  const char *table = (const char *)( contacts() + header()->contactCount );
+  if ( offset >= header()->stringTableSize )
+    return "";
+  return table + offset;
+}
+
+//
+// BinaryTraceWriter
+//
+
+BinaryTraceWriter::BinaryTraceWriter( uint32_t traceType )
+{
+  memset( &m_header, 0, sizeof(m_header) );
+  m_header.magic = BINARY_TRACE_MAGIC;
+  m_header.version = BINARY_TRACE_VERSION;
+  m_header.traceType = traceType;
+
+  // Offset zero is reserved for the empty string
+  m_strings.push_back('\0');
+  m_stringOffsets[""] = 0;
+}
+
+void BinaryTraceWriter::addCreate( double time, int nodeId, double x, double y, const char *type,
+                                   const char *name, const char *prefix, const char *icon,
+                                   const char *mobilityModel )
+{
+  BINARY_COMMAND_RECORD rec;
+  memset( &rec, 0, sizeof(rec) );
+  rec.time = time;
+  rec.x = x;
+  rec.y = y;
+  rec.kind = CREATE_EVENT_KIND;
+  rec.nodeId = nodeId;
+  rec.type = _intern(type);
+  rec.name = _intern(name);
+  rec.prefix = _intern(prefix);
+  rec.icon = _intern(icon);
+  rec.mobilityModel = _intern(mobilityModel);
+  m_commands.push_back(rec);
+  _updateTimeRange( time, nodeId );
+}
+
+void BinaryTraceWriter::addDestroy( double time, int nodeId )
+{
+  BINARY_COMMAND_RECORD rec;
+  memset( &rec, 0, sizeof(rec) );
+  rec.time = time;
+  rec.kind = DESTROY_EVENT_KIND;
+  rec.nodeId = nodeId;
+  m_commands.push_back(rec);
+  _updateTimeRange( time, nodeId );
+}
+
+void BinaryTraceWriter::addWaypoint( const WAYPOINT_EVENT &waypoint )
+{
+  BINARY_WAYPOINT_RECORD rec;
+  memset( &rec, 0, sizeof(rec) );
+  rec.time = waypoint.time;
+  rec.x = waypoint.x;
+  rec.y = waypoint.y;
+  rec.speed = waypoint.speed;
+  rec.nodeId = waypoint.id;
+  m_waypoints.push_back(rec);
+  _updateTimeRange( waypoint.time, waypoint.id );
+}
+
+void BinaryTraceWriter::addContact( const CONTACT_EVENT &contact )
+{
+  BINARY_CONTACT_RECORD rec;
+  memset( &rec, 0, sizeof(rec) );
+  rec.time = contact.time;
+  rec.nodeId = contact.id;
+  rec.peerId = contact.peerId;
+  rec.type = contact.type;
+  m_contacts.push_back(rec);
+  _updateTimeRange( contact.time, contact.id );
+}
+
+void BinaryTraceWriter::beginTrace( TRACE_TYPE traceType, unsigned long nodesHint, unsigned long recordsHint )
+{
+  m_header.traceType = traceType == ContactTrace ? BINARY_CONTACT_TRACE : BINARY_MOBILITY_TRACE;
+  m_commands.reserve( nodesHint * 2 );
+  if ( traceType == ContactTrace )
+    m_contacts.reserve( recordsHint );
+  else
+    m_waypoints.reserve( recordsHint );
+}
+
+void BinaryTraceWriter::addCommand( const TRACE_COMMAND &command )
+{
+  if ( command.kind == CREATE_EVENT_KIND )
+    addCreate( command.time, command.nodeId, command.x, command.y, command.type.c_str(),
+               command.name.c_str(), command.prefix.c_str(), command.icon.c_str(),
+               command.mobilityModel.c_str() );
+  else
+    addDestroy( command.time, command.nodeId );
+}
+
+void BinaryTraceWriter::setValidated( double scenarioSizeX, double scenarioSizeY )
+{
+  m_header.flags |= BINARY_TRACE_VALIDATED;
+  m_header.scenarioSizeX = scenarioSizeX;
+  m_header.scenarioSizeY = scenarioSizeY;
+}
+
+void BinaryTraceWriter::sortRecords()
+{
+  std::stable_sort( m_commands.begin(), m_commands.end(), CommandTimeLess() );
+  std::stable_sort( m_waypoints.begin(), m_waypoints.end(), WaypointNodeTimeLess() );
+  std::stable_sort( m_contacts.begin(), m_contacts.end(), ContactNodeTimeLess() );
+  m_header.flags |= BINARY_TRACE_SORTED | BINARY_TRACE_GROUPED;
+}
+
+void BinaryTraceWriter::groupRecords()
+{
+  std::stable_sort( m_waypoints.begin(), m_waypoints.end(), WaypointNodeLess() );
+  std::stable_sort( m_contacts.begin(), m_contacts.end(), ContactNodeLess() );
+  m_header.flags |= BINARY_TRACE_GROUPED;
+}
+
+bool BinaryTraceWriter::write( const char *filename )
+{
+  // Pad the string table so the file size stays a multiple of 8 bytes
+  while ( m_strings.size() % 8 != 0 )
+    m_strings.push_back('\0');
+
+  m_header.nodeCount = m_nodes.size();
+  m_header.commandCount = m_commands.size();
+  m_header.waypointCount = m_waypoints.size();
+  m_header.contactCount = m_contacts.size();
+  m_header.stringTableSize = m_strings.size();
+
+  FILE *f = fopen( filename, "wb" );
+  if ( f == NULL )
+  {
+    m_lastError = "Unable to create binary trace file";
+    return false;
+  }
+
+  bool ok = fwrite( &m_header, sizeof(m_header), 1, f ) == 1;
+  if ( ok && !m_commands.empty() )
+    ok = fwrite( &m_commands[0], sizeof(BINARY_COMMAND_RECORD), m_commands.size(), f ) == m_commands.size();
+  if ( ok && !m_waypoints.empty() )
+    ok = fwrite( &m_waypoints[0], sizeof(BINARY_WAYPOINT_RECORD), m_waypoints.size(), f ) == m_waypoints.size();
+  if ( ok && !m_contacts.empty() )
+    ok = fwrite( &m_contacts[0], sizeof(BINARY_CONTACT_RECORD), m_contacts.size(), f ) == m_contacts.size();
+  if ( ok )
+    ok = fwrite( m_strings.data(), 1, m_strings.size(), f ) == m_strings.size();
+
+  if ( fclose(f) != 0 )
+    ok = false;
+  if ( !ok )
+    m_lastError = "Error writing binary trace file";
+  return ok;
+}
+
+uint32_t BinaryTraceWriter::_intern( const char *str )
+{
+  if ( str == NULL || *str == '\0' )
+    return 0;
+
+  std::map<std::string,uint32_t>::iterator iter = m_stringOffsets.find(str);
+  if ( iter != m_stringOffsets.end() )
+    return iter->second;
+
+  uint32_t offset = m_strings.size();
+  m_strings.append(str);
+  m_strings.push_back('\0');
+  m_stringOffsets[str] = offset;
+  return offset;
+}
+
+void BinaryTraceWriter::_updateTimeRange( double time, int nodeId )
+{
+  if ( m_nodes.empty() && m_commands.size() + m_waypoints.size() + m_contacts.size() == 1 )
+  {
+    m_header.startTime = time;
+    m_header.endTime = time;
+  }
+  if ( time < m_header.startTime )
+    m_header.startTime = time;
+  if ( time > m_header.endTime )
+    m_header.endTime = time;
+  m_nodes[nodeId] = true;
+}
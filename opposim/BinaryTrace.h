@@ -0,0 +1,240 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+/**
+ * @file BinaryTrace.h
+ * @brief On-disk layout, reader and writer for the binary trace format.
+ *
+ * The binary trace format is a compact alternative to the XML trace files read by
+ * the NodeFactory. A binary trace is laid out as follows:
+ * -# A fixed size BINARY_TRACE_HEADER.
+ * -# commandCount BINARY_COMMAND_RECORD entries (create and destroy commands, in
+ *    trace order).
+ * -# waypointCount BINARY_WAYPOINT_RECORD entries.
+ * -# contactCount BINARY_CONTACT_RECORD entries.
+ * -# A string table of stringTableSize bytes holding zero terminated strings. String
+ *    fields of the records are byte offsets into this table. Offset zero is always
+ *    the empty string.
+ *
+ * The waypoint and contact records are in trace order. If the BINARY_TRACE_GROUPED flag
+ * is set they are grouped by node, in trace order within each node, and if the
+ * BINARY_TRACE_SORTED flag is set they are also ordered by time within each node. The
+ * records of a node in a grouped trace are contiguous and can be used in place.
+ *
+ * All records have a fixed width and are 8 byte aligned so the file can be memory
+ * mapped and the records read in place. Values are stored in the native byte order
+ * of the host which wrote the file. The magic number is used to reject files written
+ * with a different byte order.
+ *
+ * @author Kristjan V. Jonsson
+ */
+
+#ifndef __BINARY_TRACE_INCLUDED__
+#define __BINARY_TRACE_INCLUDED__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include "TraceTypes.h"
+#include "TraceSink.h"
+
+#define BINARY_TRACE_MAGIC    0x5254504F  // "OPTR" when stored little endian
+#define BINARY_TRACE_VERSION  2
+
+// Trace types stored in the header. Match the values of the NodeFactory TRACE_TYPE enum.
+#define BINARY_MOBILITY_TRACE 1
+#define BINARY_CONTACT_TRACE  2
+
+// Header flags
+// The records were validated against the scenario size stored in the header
+#define BINARY_TRACE_VALIDATED 0x1
+// Commands are ordered by time, waypoints and contacts by node and then time
+#define BINARY_TRACE_SORTED    0x2
+// Waypoints and contacts are grouped by node, in trace order within each node
+#define BINARY_TRACE_GROUPED   0x4
+
+/**
+ * @brief The binary trace file header.
+ */
+struct BINARY_TRACE_HEADER
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t traceType;        /**< BINARY_MOBILITY_TRACE or BINARY_CONTACT_TRACE */
+  uint32_t nodeCount;        /**< Number of distinct node ids in the trace */
+  uint32_t commandCount;     /**< Number of create and destroy records */
+  uint32_t waypointCount;    /**< Number of waypoint records */
+  uint32_t contactCount;     /**< Number of contact and break records */
+  uint32_t stringTableSize;  /**< Size of the string table in bytes */
+  double   startTime;        /**< Time of the earliest event in the trace */
+  double   endTime;          /**< Time of the latest event in the trace */
+  uint32_t flags;            /**< BINARY_TRACE_VALIDATED, _SORTED and _GROUPED */
+  uint32_t reserved;
+  double   scenarioSizeX;    /**< Scenario size the records were validated against */
+  double   scenarioSizeY;
+};
+
+/**
+ * @brief A create or destroy command. The kind is CREATE_EVENT_KIND or DESTROY_EVENT_KIND.
+ *        The string and location fields are only used by create commands.
+ */
+struct BINARY_COMMAND_RECORD
+{
+  double   time;
+  double   x;
+  double   y;
+  int32_t  kind;
+  int32_t  nodeId;
+  uint32_t type;           /**< String table offset of the module type */
+  uint32_t name;           /**< String table offset of the module name */
+  uint32_t prefix;         /**< String table offset of the name prefix */
+  uint32_t icon;           /**< String table offset of the icon path */
+  uint32_t mobilityModel;  /**< String table offset of the mobility model */
+  uint32_t reserved;
+};
+
+/**
+ * @brief A single waypoint record.
+ */
+struct BINARY_WAYPOINT_RECORD
+{
+  double  time;
+  double  x;
+  double  y;
+  double  speed;
+  int32_t nodeId;
+  int32_t reserved;
+};
+
+/**
+ * @brief A single contact or break record. The type is a ContactEventType value.
+ */
+struct BINARY_CONTACT_RECORD
+{
+  double  time;
+  int32_t nodeId;
+  int32_t peerId;
+  int32_t type;
+  int32_t reserved;
+};
+
+/**
+ * @brief Read-only view of a memory mapped binary trace file.
+ *
+ * The reader maps the whole file and validates the header and section sizes. The
+ * record accessors return pointers straight into the mapping, which remains valid
+ * until close() is called or the reader is destroyed.
+ */
+class BinaryTraceReader
+{
+  private:
+    /** @brief Start of the mapping. NULL if no file is open. */
+    const char   *m_base;
+    /** @brief Size of the mapping in bytes. */
+    size_t        m_size;
+    /** @brief Description of the last error. */
+    std::string   m_lastError;
+
+  public:
+    BinaryTraceReader();
+    ~BinaryTraceReader();
+
+    /** @brief Maps and validates a binary trace file. Returns false on error. */
+    bool open( const char *filename );
+    /** @brief Unmaps the file. */
+    void close();
+    /** @brief Returns a description of the last error encountered. */
+    const std::string &lastError() const { return m_lastError; }
+
+    const BINARY_TRACE_HEADER   *header() const;
+    const BINARY_COMMAND_RECORD *commands() const;
+    const BINARY_WAYPOINT_RECORD *waypoints() const;
+    const BINARY_CONTACT_RECORD *contacts() const;
+    /** @brief Returns the string stored at the given string table offset. */
+    const char *string( uint32_t offset ) const;
+    /** @brief Returns the size of the mapped file in bytes. */
+    size_t size() const { return m_size; }
+
+  private:
+    BinaryTraceReader( const BinaryTraceReader& );
+    BinaryTraceReader &operator=( const BinaryTraceReader& );
+};
+
+/**
+ * @brief Accumulates trace records in memory and writes them as a binary trace file.
+ *
+ * The writer is also a TraceSink, so a trace parser can write into it directly.
+ */
+class BinaryTraceWriter : public TraceSink
+{
+  private:
+    BINARY_TRACE_HEADER                  m_header;
+    std::vector<BINARY_COMMAND_RECORD>   m_commands;
+    std::vector<BINARY_WAYPOINT_RECORD>  m_waypoints;
+    std::vector<BINARY_CONTACT_RECORD>   m_contacts;
+    std::string                          m_strings;
+    std::map<std::string,uint32_t>       m_stringOffsets;
+    std::map<int,bool>                   m_nodes;
+    std::string                          m_lastError;
+
+  public:
+    BinaryTraceWriter( uint32_t traceType );
+
+    void addCreate( double time, int nodeId, double x, double y, const char *type,
+                    const char *name, const char *prefix, const char *icon,
+                    const char *mobilityModel );
+    void addDestroy( double time, int nodeId );
+    virtual void addWaypoint( const WAYPOINT_EVENT &waypoint );
+    virtual void addContact( const CONTACT_EVENT &contact );
+
+    /** @brief TraceSink implementation. Sets the trace type. */
+    virtual void beginTrace( TRACE_TYPE traceType, unsigned long nodesHint, unsigned long recordsHint );
+    /** @brief TraceSink implementation. Adds a create or destroy command. */
+    virtual void addCommand( const TRACE_COMMAND &command );
+
+    /** @brief Marks the trace as validated against a scenario size. The caller is 
+               responsible for the validation. */
+    void setValidated( double scenarioSizeX, double scenarioSizeY );
+    /** @brief Orders the commands by time and the waypoints and contacts by node and
+               time. Records with equal keys keep the order they were added in. */
+    void sortRecords();
+    /** @brief Groups the waypoints and contacts by node, keeping the order of the
+               records of each node. */
+    void groupRecords();
+
+    /** @brief Writes the accumulated records to a file. Returns false on error. */
+    bool write( const char *filename );
+    /** @brief Returns a description of the last error encountered. */
+    const std::string &lastError() const { return m_lastError; }
+
+  private:
+    uint32_t _intern( const char *str );
+    void _updateTimeRange( double time, int nodeId );
+};
+
+#endif /* __BINARY_TRACE_INCLUDED__ */
@@ -0,0 +1,130 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "BonnMotionTraceParser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+BonnMotionTraceParser::BonnMotionTraceParser( double scenarioSizeX, double scenarioSizeY )
+  : TraceSource( scenarioSizeX, scenarioSizeY )
+{
+}
+
+bool BonnMotionTraceParser::parseFile( const char *filename, TraceSink *sink )
+{
+  m_samples = 0;
+  m_waypoints = 0;
+
+  FILE *f = fopen( filename, "r" );
+  if ( f == NULL )
+  {
+    m_lastError = "Unable to open config file";
+    return false;
+  }
+
+  sink->beginTrace( MobilityTrace, 0, 0 );
+
+  // Lines hold the whole movement of a node and have no length limit
+  char *line = NULL;
+  size_t capacity = 0;
+  int lineNumber = 0;
+  int nodeId = 0;
+  bool ok = true;
+  while ( ok && getline( &line, &capacity, f ) != -1 )
+  {
+    lineNumber++;
+    const char *p = line;
+    while ( isspace( *p ) )
+      p++;
+    if ( *p == '\0' )
+      continue;
+    ok = _parseLine( p, nodeId++, sink );
+  }
+  free( line );
+  fclose(f);
+
+  if ( !ok )
+  {
+    _setErrorLine( lineNumber );
+    return false;
+  }
+  return true;
+}
+
+bool BonnMotionTraceParser::_parseLine( const char *line, int nodeId, TraceSink *sink )
+{
+  double prevTime = 0.0;
+  double prevX = 0.0;
+  double prevY = 0.0;
+  unsigned long count = 0;
+  const char *p = line;
+  while ( true )
+  {
+    char *end;
+    double time = strtod( p, &end );
+    if ( end == p )
+      break;
+    p = end;
+    double x = strtod( p, &end );
+    bool ok = end != p;
+    p = end;
+    double y = ok ? strtod( p, &end ) : 0.0;
+    ok = ok && end != p;
+    p = end;
+    if ( !ok )
+    {
+      m_lastError = "Malformed BonnMotion movement";
+      return false;
+    }
+    if ( !_validateLocation( x, y ) )
+      return false;
+    m_samples++;
+
+    if ( count == 0 )
+      _createNode( sink, nodeId, time, x, y );
+    else if ( time < prevTime )
+    {
+      m_lastError = "BonnMotion samples of a node not in time order";
+      return false;
+    }
+    else
+      _addMovement( sink, nodeId, prevTime, prevX, prevY, time, x, y );
+    prevTime = time;
+    prevX = x;
+    prevY = y;
+    count++;
+  }
+
+  while ( isspace( *p ) )
+    p++;
+  if ( *p != '\0' )
+  {
+    m_lastError = "Malformed BonnMotion movement";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,60 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __BONNMOTION_TRACE_PARSER_INCLUDED__
+#define __BONNMOTION_TRACE_PARSER_INCLUDED__
+
+#include <string>
+#include "TraceSource.h"
+
+/**
+ * @brief Parser for BonnMotion movement files (the uncompressed .movements file).
+ *
+ * Each line holds the movement of one node, as a list of location samples:
+ *
+ *   t1 x1 y1 t2 x2 y2 ...
+ *
+ * The node of the first line has id 0, the next 1 and so on. The node moves in a
+ * straight line between consecutive samples. It is created at its first sample, and
+ * each following sample becomes a waypoint. Only two dimensional scenarios are
+ * supported. Lines are read one at a time, so only a single node is held in memory.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class BonnMotionTraceParser : public TraceSource
+{
+  public:
+    /** @brief Constructor. A zero scenario size disables location validation. */
+    BonnMotionTraceParser( double scenarioSizeX, double scenarioSizeY );
+
+    /** @brief Parses a BonnMotion movement file. Returns false on error. */
+    virtual bool parseFile( const char *filename, TraceSink *sink );
+
+  private:
+    bool _parseLine( const char *line, int nodeId, TraceSink *sink );
+};
+
+#endif /* __BONNMOTION_TRACE_PARSER_INCLUDED__ */
@@ -0,0 +1,188 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "CompactTrace.h"
+
+WaypointStore::WaypointStore( WAYPOINT_ENCODING encoding )
+{
+  m_encoding = encoding;
+  m_size = 0;
+  m_cursor = 0;
+  m_lastTime = 0.0;
+  m_lastX = 0.0;
+  m_lastY = 0.0;
+}
+
+bool WaypointStore::parseEncoding( const std::string &name, WAYPOINT_ENCODING &encoding )
+{
+  if ( name == "double" )
+    encoding = DoubleEncoding;
+  else if ( name == "float" )
+    encoding = FloatEncoding;
+  else if ( name == "delta" )
+    encoding = DeltaEncoding;
+  else
+    return false;
+  return true;
+}
+
+void WaypointStore::assign( const waypointEventsVector &waypoints )
+{
+  clear();
+  m_size = waypoints.size();
+  if ( m_size == 0 )
+    return;
+
+  if ( m_encoding == DoubleEncoding )
+  {
+    m_events = waypoints;
+  }
+  else if ( m_encoding == FloatEncoding )
+  {
+    m_floats.resize( m_size );
+    for ( unsigned int i=0; i < m_size; i++ )
+    {
+      m_floats[i].time = waypoints[i].time;
+      m_floats[i].x = waypoints[i].x;
+      m_floats[i].y = waypoints[i].y;
+      m_floats[i].speed = waypoints[i].speed;
+    }
+  }
+  else
+  {
+    // The differences are taken from the waypoints as they will be decoded. The first
+    // waypoint is the origin of the differences, so it is decoded exactly.
+    m_deltas.resize( m_size );
+    m_lastTime = waypoints[0].time;
+    m_lastX = waypoints[0].x;
+    m_lastY = waypoints[0].y;
+    double time = m_lastTime;
+    double x = m_lastX;
+    double y = m_lastY;
+    for ( unsigned int i=0; i < m_size; i++ )
+    {
+      DELTA_WAYPOINT &delta = m_deltas[i];
+      delta.dt = static_cast<float>( waypoints[i].time - time );
+      delta.dx = static_cast<float>( waypoints[i].x - x );
+      delta.dy = static_cast<float>( waypoints[i].y - y );
+      delta.speed = static_cast<float>( waypoints[i].speed );
+      time += delta.dt;
+      x += delta.dx;
+      y += delta.dy;
+    }
+  }
+}
+
+void WaypointStore::adopt( waypointEventsVector &waypoints )
+{
+  if ( m_encoding != DoubleEncoding )
+  {
+    assign( waypoints );
+    waypointEventsVector().swap( waypoints );
+    return;
+  }
+
+  // Take the storage of the list and leave the list with the old, released, storage
+  clear();
+  m_events.swap( waypoints );
+  m_size = m_events.size();
+}
+
+void WaypointStore::clear()
+{
+  waypointEventsVector().swap( m_events );
+  std::vector<FLOAT_WAYPOINT>().swap( m_floats );
+  std::vector<DELTA_WAYPOINT>().swap( m_deltas );
+  m_size = 0;
+  m_cursor = 0;
+}
+
+WAYPOINT WaypointStore::next()
+{
+  if ( m_encoding == DoubleEncoding )
+    return m_events[m_cursor++];
+
+  WAYPOINT waypoint;
+  if ( m_encoding == FloatEncoding )
+  {
+    const FLOAT_WAYPOINT &stored = m_floats[m_cursor];
+    waypoint.time = stored.time;
+    waypoint.x = stored.x;
+    waypoint.y = stored.y;
+    waypoint.speed = stored.speed;
+  }
+  else
+  {
+    const DELTA_WAYPOINT &stored = m_deltas[m_cursor];
+    m_lastTime += stored.dt;
+    m_lastX += stored.dx;
+    m_lastY += stored.dy;
+    waypoint.time = m_lastTime;
+    waypoint.x = m_lastX;
+    waypoint.y = m_lastY;
+    waypoint.speed = stored.speed;
+  }
+  m_cursor++;
+  return waypoint;
+}
+
+unsigned long WaypointStore::bytes() const
+{
+  return m_events.capacity() * sizeof(WAYPOINT) + m_floats.capacity() * sizeof(FLOAT_WAYPOINT) +
+         m_deltas.capacity() * sizeof(DELTA_WAYPOINT);
+}
+
+unsigned int WaypointStore::waypointBytes( WAYPOINT_ENCODING encoding )
+{
+  if ( encoding == DoubleEncoding )
+    return sizeof(WAYPOINT);
+  if ( encoding == FloatEncoding )
+    return sizeof(FLOAT_WAYPOINT);
+  return sizeof(DELTA_WAYPOINT);
+}
+
+ContactStore::ContactStore()
+{
+  m_cursor = 0;
+}
+
+void ContactStore::assign( const contactEventsVector &contacts )
+{
+  m_contacts = contacts;
+  m_cursor = 0;
+}
+
+void ContactStore::adopt( contactEventsVector &contacts )
+{
+  clear();
+  m_contacts.swap( contacts );
+}
+
+void ContactStore::clear()
+{
+  contactEventsVector().swap( m_contacts );
+  m_cursor = 0;
+}
@@ -0,0 +1,165 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __COMPACT_TRACE_INCLUDED__
+#define __COMPACT_TRACE_INCLUDED__
+
+#include <string>
+#include <vector>
+#include "TraceTypes.h"
+
+/**
+ * @brief Encodings of the waypoints held by a WaypointStore
+ */
+enum WAYPOINT_ENCODING
+{
+  /** @brief The waypoints as read from the trace. Exact, and adopted without a copy. */
+  DoubleEncoding,
+  /** @brief Times as doubles, locations and speeds as floats */
+  FloatEncoding,
+  /** @brief Differences from the previous waypoint, and speeds, as floats */
+  DeltaEncoding
+};
+
+/**
+ * @brief The waypoints of a node in contiguous storage, read in order with a cursor.
+ *
+ * The waypoints are stored in one of three encodings, none of which keeps the node id
+ * with each waypoint. The double encoding keeps them exactly, as read from the trace,
+ * in 32 bytes each. A list of waypoints is adopted by the double encoding without
+ * copying it, so handing a list over takes the same time whatever its length. The
+ * float encoding keeps the times as doubles and the locations and speeds as floats,
+ * in 24 bytes. The delta encoding keeps the differences of the time and location from
+ * those of the previous waypoint, and the speed, as floats, in 16 bytes. Each
+ * difference is taken from the previous waypoint as it is decoded, so the rounding
+ * errors do not add up along the list.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class WaypointStore
+{
+  private:
+    struct FLOAT_WAYPOINT
+    {
+      double time;
+      float  x;
+      float  y;
+      float  speed;
+    };
+    struct DELTA_WAYPOINT
+    {
+      float dt;
+      float dx;
+      float dy;
+      float speed;
+    };
+
+    WAYPOINT_ENCODING            m_encoding;
+    waypointEventsVector         m_events;
+    std::vector<FLOAT_WAYPOINT>  m_floats;
+    std::vector<DELTA_WAYPOINT>  m_deltas;
+    unsigned int                 m_size;
+    unsigned int                 m_cursor;
+    /** @brief The last waypoint decoded in the delta encoding, and the first one before
+               any is decoded */
+    double                       m_lastTime;
+    double                       m_lastX;
+    double                       m_lastY;
+
+  public:
+    /** @brief Constructor */
+    WaypointStore( WAYPOINT_ENCODING encoding = DoubleEncoding );
+
+    /** @brief Sets the encoding of the waypoints assigned from now on */
+    void setEncoding( WAYPOINT_ENCODING encoding ) { m_encoding = encoding; }
+    WAYPOINT_ENCODING encoding() const { return m_encoding; }
+    /** @brief Parses an encoding name, "double", "float" or "delta". Returns false if 
+               the name is unknown. */
+    static bool parseEncoding( const std::string &name, WAYPOINT_ENCODING &encoding );
+
+    /** @brief Replaces the waypoints with those of a list, all of the same node, and 
+               moves the cursor to the first */
+    void assign( const waypointEventsVector &waypoints );
+    /** @brief Replaces the waypoints with those of a list, all of the same node, taking
+               them from the list. The double encoding takes over the storage of the list
+               without a copy. The list is left empty. */
+    void adopt( waypointEventsVector &waypoints );
+    /** @brief Removes all waypoints and releases their storage */
+    void clear();
+
+    /** @brief Returns true if all waypoints have been read */
+    bool empty() const { return m_cursor >= m_size; }
+    /** @brief Returns the number of waypoints not yet read */
+    unsigned int remaining() const { return m_size - m_cursor; }
+    /** @brief Returns the waypoint at the cursor and moves the cursor to the next */
+    WAYPOINT next();
+
+    /** @brief Returns the bytes of the waypoint storage */
+    unsigned long bytes() const;
+    /** @brief Returns the bytes taken by one waypoint in an encoding */
+    static unsigned int waypointBytes( WAYPOINT_ENCODING encoding );
+};
+
+/**
+ * @brief The contacts of a node in contiguous storage, read in order with a cursor.
+ *
+ * The contacts are kept as read from the trace, without the node id, in 16 bytes each.
+ * A list of contacts is adopted without copying it.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class ContactStore
+{
+  private:
+    contactEventsVector m_contacts;
+    unsigned int        m_cursor;
+
+  public:
+    /** @brief Constructor */
+    ContactStore();
+
+    /** @brief Replaces the contacts with those of a list, all of the same node, and 
+               moves the cursor to the first */
+    void assign( const contactEventsVector &contacts );
+    /** @brief Replaces the contacts with those of a list, taking over the storage of the
+               list without a copy. The list is left empty. */
+    void adopt( contactEventsVector &contacts );
+    /** @brief Removes all contacts and releases their storage */
+    void clear();
+
+    /** @brief Returns true if all contacts have been read */
+    bool empty() const { return m_cursor >= m_contacts.size(); }
+    /** @brief Returns the number of contacts not yet read */
+    unsigned int remaining() const { return m_contacts.size() - m_cursor; }
+    /** @brief Returns the contact at the cursor and moves the cursor to the next */
+    const CONTACT &next() { return m_contacts[m_cursor++]; }
+    /** @brief Returns the contact at the cursor without moving the cursor */
+    const CONTACT &peek() const { return m_contacts[m_cursor]; }
+    /** @brief Returns the bytes of the contact storage */
+    unsigned long bytes() const { return m_contacts.capacity() * sizeof(CONTACT); }
+};
+
+#endif /* __COMPACT_TRACE_INCLUDED__ */
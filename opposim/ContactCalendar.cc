@@ -0,0 +1,198 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "ContactCalendar.h"
+#include <math.h>
+#include <algorithm>
+
+// The entries sampled when estimating the bucket width
+#define CONTACT_CALENDAR_WIDTH_SAMPLES 64
+// Removed entries at the head of a bucket are erased when there are more than this
+// many and they are most of the bucket
+#define CONTACT_CALENDAR_COMPACT_HEAD 32
+
+static bool earlierEntry( const CONTACT_CALENDAR_ENTRY &a, const CONTACT_CALENDAR_ENTRY &b )
+{
+  return a.time < b.time;
+}
+
+ContactCalendar::ContactCalendar()
+{
+  configure( 1.0, 64 );
+  m_resizes = 0;
+}
+
+void ContactCalendar::configure( double bucketWidth, unsigned int buckets )
+{
+  m_bucketWidth = bucketWidth > 0.0 ? bucketWidth : 1.0;
+  m_minBuckets = buckets > 0 ? buckets : 1;
+  m_buckets.clear();
+  m_buckets.resize( m_minBuckets );
+  m_size = 0;
+  m_current = 0;
+  m_earliest = -1;
+}
+
+long long ContactCalendar::_bucketNumber( double time ) const
+{
+  return (long long)floor( time / m_bucketWidth );
+}
+
+void ContactCalendar::insert( double time, unsigned int slot, unsigned int stamp )
+{
+  CONTACT_CALENDAR_ENTRY entry;
+  entry.time = time;
+  entry.slot = slot;
+  entry.stamp = stamp;
+  _insertEntry( entry );
+  m_size++;
+
+  if ( m_size > 2 * m_buckets.size() )
+    _resize( 2 * m_buckets.size() );
+}
+
+void ContactCalendar::_insertEntry( const CONTACT_CALENDAR_ENTRY &entry )
+{
+  long long number = _bucketNumber( entry.time );
+  // An entry before the search start moves the start back
+  if ( number < m_current )
+    m_current = number;
+  if ( m_earliest >= 0 && earlierEntry( entry, m_buckets[m_earliest].front() ) )
+    m_earliest = -1;
+
+  CONTACT_CALENDAR_BUCKET &bucket = m_buckets[number % m_buckets.size()];
+  // Contacts are mostly inserted after the entries already in their bucket, so
+  // the place of the entry is searched from the back
+  std::vector<CONTACT_CALENDAR_ENTRY>::iterator i = bucket.entries.end();
+  std::vector<CONTACT_CALENDAR_ENTRY>::iterator head = bucket.entries.begin() + bucket.head;
+  while ( i != head && (i-1)->time > entry.time )
+    i--;
+  bucket.entries.insert( i, entry );
+}
+
+const CONTACT_CALENDAR_ENTRY &ContactCalendar::top()
+{
+  return m_buckets[_findEarliest()].front();
+}
+
+void ContactCalendar::pop()
+{
+  if ( m_size == 0 )
+    return;
+  CONTACT_CALENDAR_BUCKET &bucket = m_buckets[_findEarliest()];
+  bucket.head++;
+  if ( bucket.empty() )
+  {
+    // Keep the storage of the bucket for later entries
+    bucket.entries.clear();
+    bucket.head = 0;
+  }
+  else if ( bucket.head > CONTACT_CALENDAR_COMPACT_HEAD && 2 * bucket.head > bucket.entries.size() )
+  {
+    bucket.entries.erase( bucket.entries.begin(), bucket.entries.begin() + bucket.head );
+    bucket.head = 0;
+  }
+  m_size--;
+  m_earliest = -1;
+
+  if ( m_buckets.size() > m_minBuckets && m_size < m_buckets.size() / 2 )
+    _resize( m_buckets.size() / 2 );
+}
+
+unsigned int ContactCalendar::_findEarliest()
+{
+  if ( m_earliest >= 0 )
+    return m_earliest;
+
+  unsigned int count = m_buckets.size();
+  // Walk one year of buckets from the search start. The earliest entry is the first
+  // one found in the year of the bucket being visited.
+  for ( unsigned int i=0; i < count; i++ )
+  {
+    long long number = m_current + i;
+    unsigned int index = number % count;
+    const CONTACT_CALENDAR_BUCKET &bucket = m_buckets[index];
+    if ( !bucket.empty() && _bucketNumber( bucket.front().time ) == number )
+    {
+      m_current = number;
+      m_earliest = index;
+      return index;
+    }
+  }
+
+  // All entries are more than a year ahead. Search the earliest directly.
+  unsigned int earliest = 0;
+  bool found = false;
+  for ( unsigned int index=0; index < count; index++ )
+  {
+    const CONTACT_CALENDAR_BUCKET &bucket = m_buckets[index];
+    if ( bucket.empty() )
+      continue;
+    if ( !found || earlierEntry( bucket.front(), m_buckets[earliest].front() ) )
+    {
+      earliest = index;
+      found = true;
+    }
+  }
+  m_current = _bucketNumber( m_buckets[earliest].front().time );
+  m_earliest = earliest;
+  return earliest;
+}
+
+void ContactCalendar::_resize( unsigned int buckets )
+{
+  std::vector<CONTACT_CALENDAR_ENTRY> entries;
+  entries.reserve( m_size );
+  for ( unsigned int i=0; i < m_buckets.size(); i++ )
+    entries.insert( entries.end(), m_buckets[i].entries.begin() + m_buckets[i].head, m_buckets[i].entries.end() );
+
+  // Estimate the width from the spacing of the earliest entries, three times their
+  // mean separation
+  std::vector<double> times;
+  times.reserve( entries.size() );
+  for ( unsigned int i=0; i < entries.size(); i++ )
+    times.push_back( entries[i].time );
+  unsigned int samples = std::min( (unsigned int)times.size(), (unsigned int)CONTACT_CALENDAR_WIDTH_SAMPLES );
+  if ( samples > 1 )
+  {
+    std::nth_element( times.begin(), times.begin() + ( samples - 1 ), times.end() );
+    double last = times[samples-1];
+    double first = *std::min_element( times.begin(), times.begin() + samples );
+    if ( last > first )
+      m_bucketWidth = 3.0 * ( last - first ) / ( samples - 1 );
+  }
+
+  // The entries are redistributed in order, so each bucket is sorted. Entries of the
+  // same time were in the same bucket, in order of insertion, and stay in that order.
+  std::stable_sort( entries.begin(), entries.end(), earlierEntry );
+  m_buckets.clear();
+  m_buckets.resize( buckets );
+  m_current = entries.empty() ? 0 : _bucketNumber( entries[0].time );
+  for ( unsigned int i=0; i < entries.size(); i++ )
+    m_buckets[_bucketNumber( entries[i].time ) % buckets].entries.push_back( entries[i] );
+  m_earliest = -1;
+  m_resizes++;
+}
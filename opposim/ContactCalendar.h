@@ -0,0 +1,128 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __CONTACT_CALENDAR_INCLUDED__
+#define __CONTACT_CALENDAR_INCLUDED__
+
+#include <vector>
+
+/**
+ * @brief An entry of the contact calendar, the next contact of an endpoint.
+ */
+struct CONTACT_CALENDAR_ENTRY
+{
+  /** @brief The absolute time of the contact */
+  double       time;
+  /** @brief The slot of the endpoint */
+  unsigned int slot;
+  /** @brief The stamp of the slot when the entry was inserted */
+  unsigned int stamp;
+};
+
+/**
+ * @brief A bucket of the contact calendar. The entries are sorted by time, and entries
+ *        of the same time by order of insertion. Those before the head have been removed.
+ */
+struct CONTACT_CALENDAR_BUCKET
+{
+  std::vector<CONTACT_CALENDAR_ENTRY> entries;
+  unsigned int head;
+
+  CONTACT_CALENDAR_BUCKET() { head = 0; }
+  bool empty() const { return head >= entries.size(); }
+  const CONTACT_CALENDAR_ENTRY &front() const { return entries[head]; }
+};
+
+/**
+ * @brief Calendar queue of contact events, keyed by absolute time.
+ *
+ * The entries are kept in a ring of buckets, each covering bucketWidth seconds of a
+ * year of buckets. An entry is inserted into the bucket of its time, sorted by time and
+ * insertion order. The earliest entry is found by walking the buckets from the bucket
+ * of the last entry removed, so inserting and removing take constant time on average
+ * when the width matches the spacing of the entries. The number of buckets is doubled
+ * or halved as the calendar grows or shrinks, and the width is then estimated again
+ * from the spacing of the earliest entries.
+ *
+ * Entries of the same time are removed in the order they were inserted, as events
+ * of the same time and priority are taken from the future event set of OMNeT++. They
+ * are always in the same bucket, where a new entry is placed after those of its time.
+ *
+ * The calendar does not depend on OMNeT++ and is used by the ContactScheduler module.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class ContactCalendar
+{
+  private:
+    std::vector<CONTACT_CALENDAR_BUCKET> m_buckets;
+    double         m_bucketWidth;
+    unsigned int   m_minBuckets;
+    unsigned int   m_size;
+    /** @brief The bucket number, counted from time zero, where the search starts */
+    long long      m_current;
+    /** @brief The bucket of the earliest entry, or -1 if it has to be searched */
+    int            m_earliest;
+    unsigned long  m_resizes;
+
+  public:
+    /** @brief Constructor */
+    ContactCalendar();
+
+    /** @brief Sets the initial bucket width in seconds and number of buckets. Removes
+               all entries. */
+    void configure( double bucketWidth, unsigned int buckets );
+    /** @brief Inserts the contact of an endpoint at an absolute time */
+    void insert( double time, unsigned int slot, unsigned int stamp );
+    /** @brief Returns the earliest entry. The calendar must not be empty. */
+    const CONTACT_CALENDAR_ENTRY &top();
+    /** @brief Removes the earliest entry */
+    void pop();
+
+    /** @brief Returns true if the calendar holds no entries */
+    bool empty() const { return m_size == 0; }
+    /** @brief Returns the number of entries */
+    unsigned int size() const { return m_size; }
+    /** @brief Returns the current number of buckets */
+    unsigned int buckets() const { return m_buckets.size(); }
+    /** @brief Returns the current bucket width in seconds */
+    double bucketWidth() const { return m_bucketWidth; }
+    /** @brief Returns the number of times the buckets were resized */
+    unsigned long resizes() const { return m_resizes; }
+
+  private:
+    /** @brief Returns the bucket number of a time, counted from time zero */
+    long long _bucketNumber( double time ) const;
+    /** @brief Inserts an entry into its bucket */
+    void _insertEntry( const CONTACT_CALENDAR_ENTRY &entry );
+    /** @brief Finds the earliest entry and moves the search start to its bucket. 
+               Returns the index of its bucket. */
+    unsigned int _findEarliest();
+    /** @brief Rebuilds the calendar with a number of buckets */
+    void _resize( unsigned int buckets );
+};
+
+#endif /* __CONTACT_CALENDAR_INCLUDED__ */
@@ -0,0 +1,186 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "ContactGraph.h"
+
+// The neighbors of nodes not in the graph
+static const std::vector<int> noNeighbors;
+
+ContactGraph::ContactGraph()
+{
+  m_maxDegree = 0;
+}
+
+unsigned long long ContactGraph::_edgeKey( int id, int peerId )
+{
+  unsigned int low = id < peerId ? id : peerId;
+  unsigned int high = id < peerId ? peerId : id;
+  return ( (unsigned long long)low << 32 ) | high;
+}
+
+bool ContactGraph::addContact( int id, int peerId )
+{
+  if ( id < 0 || peerId < 0 || id == peerId )
+    return false;
+  _addNode( id );
+  _addNode( peerId );
+
+  unsigned long long key = _edgeKey( id, peerId );
+  unsigned char report = id < peerId ? 1 : 2;
+  EDGE_MAP_TYPE::iterator edge = m_edges.find( key );
+  if ( edge != m_edges.end() )
+  {
+    // Already in contact, possibly reported by the peer
+    edge->second.reports |= report;
+    return false;
+  }
+
+  int low = id < peerId ? id : peerId;
+  int high = id < peerId ? peerId : id;
+  CONTACT_GRAPH_EDGE newEdge;
+  newEdge.reports = report;
+  newEdge.lowPosition = _addNeighbor( low, high );
+  newEdge.highPosition = _addNeighbor( high, low );
+  m_edges.insert( EDGE_MAP_TYPE::value_type( key, newEdge ) );
+  return true;
+}
+
+bool ContactGraph::breakContact( int id, int peerId )
+{
+  if ( id < 0 || peerId < 0 || id == peerId )
+    return false;
+  EDGE_MAP_TYPE::iterator edge = m_edges.find( _edgeKey( id, peerId ) );
+  if ( edge == m_edges.end() )
+    return false;
+
+  edge->second.reports &= id < peerId ? ~1 : ~2;
+  // The peer still reports the contact
+  if ( edge->second.reports != 0 )
+    return false;
+  _removeEdge( edge );
+  return true;
+}
+
+void ContactGraph::removeNode( int id )
+{
+  if ( id < 0 || id >= (int)m_neighbors.size() )
+    return;
+  while ( !m_neighbors[id].empty() )
+    _removeEdge( m_edges.find( _edgeKey( id, m_neighbors[id].back() ) ) );
+}
+
+void ContactGraph::clear()
+{
+  m_edges.clear();
+  m_neighbors.clear();
+  m_known.clear();
+  m_degreeCounts.clear();
+  m_maxDegree = 0;
+}
+
+bool ContactGraph::inContact( int id, int peerId ) const
+{
+  if ( id < 0 || peerId < 0 || id == peerId )
+    return false;
+  return m_edges.find( _edgeKey( id, peerId ) ) != m_edges.end();
+}
+
+const std::vector<int> &ContactGraph::neighbors( int id ) const
+{
+  if ( id < 0 || id >= (int)m_neighbors.size() )
+    return noNeighbors;
+  return m_neighbors[id];
+}
+
+unsigned int ContactGraph::degree( int id ) const
+{
+  return neighbors( id ).size();
+}
+
+void ContactGraph::_addNode( int id )
+{
+  if ( id >= (int)m_neighbors.size() )
+  {
+    m_neighbors.resize( id + 1 );
+    m_known.resize( id + 1, 0 );
+  }
+  if ( m_known[id] )
+    return;
+  m_known[id] = 1;
+  if ( m_degreeCounts.empty() )
+    m_degreeCounts.resize( 1, 0 );
+  m_degreeCounts[0]++;
+}
+
+unsigned int ContactGraph::_addNeighbor( int id, int neighbor )
+{
+  std::vector<int> &neighbors = m_neighbors[id];
+  unsigned int position = neighbors.size();
+  neighbors.push_back( neighbor );
+  _changeDegree( position, position + 1 );
+  return position;
+}
+
+void ContactGraph::_removeNeighbor( int id, unsigned int position )
+{
+  std::vector<int> &neighbors = m_neighbors[id];
+  unsigned int degree = neighbors.size();
+  int last = neighbors.back();
+  neighbors[position] = last;
+  neighbors.pop_back();
+  if ( position < neighbors.size() )
+  {
+    // The last neighbor was moved. Update its position in its edge.
+    CONTACT_GRAPH_EDGE &moved = m_edges.find( _edgeKey( id, last ) )->second;
+    if ( id < last )
+      moved.lowPosition = position;
+    else
+      moved.highPosition = position;
+  }
+  _changeDegree( degree, degree - 1 );
+}
+
+void ContactGraph::_changeDegree( unsigned int from, unsigned int to )
+{
+  m_degreeCounts[from]--;
+  if ( to >= m_degreeCounts.size() )
+    m_degreeCounts.resize( to + 1, 0 );
+  m_degreeCounts[to]++;
+  if ( to > m_maxDegree )
+    m_maxDegree = to;
+}
+
+void ContactGraph::_removeEdge( EDGE_MAP_TYPE::iterator edge )
+{
+  int low = (int)( edge->first >> 32 );
+  int high = (int)( edge->first & 0xffffffff );
+  unsigned int lowPosition = edge->second.lowPosition;
+  unsigned int highPosition = edge->second.highPosition;
+  // The edge is erased first, so that it is not taken for a moved neighbor
+  m_edges.erase( edge );
+  _removeNeighbor( low, lowPosition );
+  _removeNeighbor( high, highPosition );
+}
@@ -0,0 +1,124 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __CONTACT_GRAPH_INCLUDED__
+#define __CONTACT_GRAPH_INCLUDED__
+
+#include <vector>
+#include <tr1/unordered_map>
+
+/**
+ * @brief An edge of the contact graph, a pair of nodes in contact
+ */
+struct CONTACT_GRAPH_EDGE
+{
+  /** @brief The nodes reporting the contact, bit 0 for the node of the lower id and
+             bit 1 for the other */
+  unsigned char reports;
+  /** @brief The position of the higher id in the neighbors of the lower id */
+  unsigned int  lowPosition;
+  /** @brief The position of the lower id in the neighbors of the higher id */
+  unsigned int  highPosition;
+};
+
+/**
+ * @brief Live graph of the nodes in contact.
+ *
+ * The graph is updated with the contact and break events of the nodes, and answers
+ * whether two nodes are in contact in constant time, the neighbors of a node in time
+ * linear in their number, and the number of nodes of each degree without a pass over
+ * the nodes. The edges are kept in a hash table keyed by the pair of nodes, and the
+ * neighbors of each node in an array, from which an edge is removed by moving the last
+ * neighbor into its place.
+ *
+ * Either node of a pair may report their contact, or both. The nodes are in contact
+ * while at least one of them reports it, and a break only withdraws the report of the
+ * node breaking the contact. Repeated reports are ignored.
+ *
+ * Node ids are the non-negative ids of the trace. The graph does not depend on
+ * OMNeT++ and is used by the ContactIndex module.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class ContactGraph
+{
+  private:
+    typedef std::tr1::unordered_map<unsigned long long,CONTACT_GRAPH_EDGE> EDGE_MAP_TYPE;
+
+    EDGE_MAP_TYPE                  m_edges;
+    /** @brief The neighbors of each node, indexed by node id */
+    std::vector<std::vector<int> > m_neighbors;
+    /** @brief Set for the nodes which have been in a contact */
+    std::vector<char>              m_known;
+    /** @brief The number of known nodes of each degree */
+    std::vector<unsigned int>      m_degreeCounts;
+    unsigned int                   m_maxDegree;
+
+  public:
+    /** @brief Constructor */
+    ContactGraph();
+
+    /** @brief Adds the report of a node of its contact with a peer. Returns true if the
+               nodes were not in contact before. */
+    bool addContact( int id, int peerId );
+    /** @brief Withdraws the report of a node of its contact with a peer. Returns true
+               if the nodes are no longer in contact. */
+    bool breakContact( int id, int peerId );
+    /** @brief Removes all contacts of a node, whoever reported them */
+    void removeNode( int id );
+    /** @brief Removes all nodes and contacts */
+    void clear();
+
+    /** @brief Returns true if two nodes are in contact */
+    bool inContact( int id, int peerId ) const;
+    /** @brief Returns the nodes in contact with a node, in no particular order */
+    const std::vector<int> &neighbors( int id ) const;
+    /** @brief Returns the number of nodes in contact with a node */
+    unsigned int degree( int id ) const;
+    /** @brief Returns the number of nodes of each degree, indexed by degree, among the
+               nodes which have been in a contact */
+    const std::vector<unsigned int> &degreeHistogram() const { return m_degreeCounts; }
+    /** @brief Returns the highest degree of a node so far */
+    unsigned int maxDegree() const { return m_maxDegree; }
+    /** @brief Returns the number of pairs of nodes in contact */
+    unsigned int edges() const { return m_edges.size(); }
+
+  private:
+    /** @brief Returns the key of the edge of two nodes */
+    static unsigned long long _edgeKey( int id, int peerId );
+    /** @brief Makes room for a node and counts it as known */
+    void _addNode( int id );
+    /** @brief Adds a neighbor to a node, returning its position */
+    unsigned int _addNeighbor( int id, int neighbor );
+    /** @brief Removes the neighbor at a position of a node */
+    void _removeNeighbor( int id, unsigned int position );
+    /** @brief Moves a node from the count of one degree to another */
+    void _changeDegree( unsigned int from, unsigned int to );
+    /** @brief Removes an edge from the table and both neighbor lists */
+    void _removeEdge( EDGE_MAP_TYPE::iterator edge );
+};
+
+#endif /* __CONTACT_GRAPH_INCLUDED__ */
@@ -0,0 +1,116 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "ContactIndex.h"
+#include "TraceTypes.h"
+
+Define_Module(ContactIndex);
+
+ContactIndex::ContactIndex()
+{
+  m_contacts = 0;
+  m_breaks = 0;
+  m_maxEdges = 0;
+}
+
+void ContactIndex::initialize()
+{
+  ev << fullPath() << ": initializing ContactIndex module." << endl;
+  m_graph.clear();
+
+  if ( ev.isGUI() )
+  {
+    WATCH(m_contacts);
+    WATCH(m_breaks);
+  }
+}
+
+void ContactIndex::finish()
+{
+  ev << fullPath() << ": Finishing run at " << simTime() << endl;
+  ev << "    Contacts:          " << m_contacts << endl;
+  ev << "    Breaks:            " << m_breaks << endl;
+  ev << "    Max contacts:      " << m_maxEdges << endl;
+  ev << "    Max degree:        " << m_graph.maxDegree() << endl;
+  recordScalar("index.contacts", m_contacts);
+  recordScalar("index.breaks", m_breaks);
+  recordScalar("index.edges.max", m_maxEdges);
+  recordScalar("index.degree.max", m_graph.maxDegree());
+}
+
+void ContactIndex::handleMessage( cMessage *msg )
+{
+  ev << fullPath() << ": Unexpected message " << msg->name() << endl;
+  delete msg;
+}
+
+void ContactIndex::update( int id, int peerId, int type )
+{
+  Enter_Method_Silent();
+
+  if ( type == Contact )
+  {
+    if ( m_graph.addContact( id, peerId ) )
+      m_contacts++;
+    if ( m_graph.edges() > m_maxEdges )
+      m_maxEdges = m_graph.edges();
+  }
+  else if ( type == Break )
+  {
+    if ( m_graph.breakContact( id, peerId ) )
+      m_breaks++;
+  }
+}
+
+void ContactIndex::removeNode( int id )
+{
+  Enter_Method_Silent();
+  m_graph.removeNode( id );
+}
+
+bool ContactIndex::inContact( int id, int peerId )
+{
+  Enter_Method_Silent();
+  return m_graph.inContact( id, peerId );
+}
+
+const std::vector<int> &ContactIndex::neighbors( int id )
+{
+  Enter_Method_Silent();
+  return m_graph.neighbors( id );
+}
+
+unsigned int ContactIndex::degree( int id )
+{
+  Enter_Method_Silent();
+  return m_graph.degree( id );
+}
+
+const std::vector<unsigned int> &ContactIndex::degreeHistogram()
+{
+  Enter_Method_Silent();
+  return m_graph.degreeHistogram();
+}
@@ -0,0 +1,81 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __CONTACT_INDEX_INCLUDED__
+#define __CONTACT_INDEX_INCLUDED__
+
+#include <omnetpp.h>
+#include <vector>
+#include "ContactGraph.h"
+
+/**
+ * @brief Global contact graph module.
+ *
+ * Keeps a ContactGraph of the nodes in contact, updated by every ContactNotifier of
+ * the network as it publishes the contact and break events of its node. Forwarding
+ * protocols and statistics modules query the graph instead of tracking the HostContact
+ * notifications of the nodes themselves: whether two nodes are in contact, the 
+ * neighbors and degree of a node, and the number of nodes of each degree.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class ContactIndex : public cSimpleModule
+{
+  private:
+    ContactGraph  m_graph;
+
+    unsigned long m_contacts;
+    unsigned long m_breaks;
+    unsigned int  m_maxEdges;
+
+  public:
+    /** @brief Constructor */
+    ContactIndex();
+
+    /** @brief Updates the graph with a contact or break event reported by a node */
+    void update( int id, int peerId, int type );
+    /** @brief Removes all contacts of a node, when it is destroyed */
+    void removeNode( int id );
+
+    /** @brief Returns true if two nodes are in contact */
+    bool inContact( int id, int peerId );
+    /** @brief Returns the nodes in contact with a node */
+    const std::vector<int> &neighbors( int id );
+    /** @brief Returns the number of nodes in contact with a node */
+    unsigned int degree( int id );
+    /** @brief Returns the number of nodes of each degree, indexed by degree, among the
+               nodes which have been in a contact */
+    const std::vector<unsigned int> &degreeHistogram();
+    /** @brief Returns the graph */
+    const ContactGraph &graph() const { return m_graph; }
+
+  protected:
+    virtual void initialize();
+    virtual void finish();
+    virtual void handleMessage( cMessage *msg );
+};
+
+#endif /* __CONTACT_INDEX_INCLUDED__ */
@@ -2,7 +2,8 @@
 // ***************************************************************************
 // 
 // OppoNet Project
-//// This file is a part of the opponet project, jointly managed by the 
+//
+// This file is a part of the opponet project, jointly managed by the 
 // Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden 
 // and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
 // University, Iceland.
@@ -25,6 +26,8 @@
 // ***************************************************************************
   
 #include "ContactNotifier.h"
+#include "ContactScheduler.h"
+#include "ContactIndex.h"
 #include <FWMath.h>
 
 Define_Module(ContactNotifier);
@@ -39,7 +42,37 @@ void ContactNotifier::initialize(int stage)
     
     // Create a contact event and register with the blackboard
     contactEvent = new ContactEvent("contact");  	    	
+    // A recycled module may hold contacts of its previous node
+    m_eventList.clear();
+    m_nodeId = -1;
     hostContactCategory = bb->getCategory(&hostContact);    	
+    hostContactBatchCategory = bb->getCategory(&hostContactBatch);
+
+    // Subscribers register in stage 1
+    hasPar("skipUnsubscribed") ? m_skipUnsubscribed = par("skipUnsubscribed") : m_skipUnsubscribed = false;
+    m_contactSubscribers = 0;
+    m_batchSubscribers = 0;
+    m_contactCount = 0;
+    m_publishCount = 0;
+    m_batchPublishCount = 0;
+
+    // Scheduled nodes get their contacts from the contact scheduler of the network
+    bool scheduled;
+    hasPar("scheduled") ? scheduled = par("scheduled") : scheduled = false;
+    m_scheduler = NULL;
+    m_schedulerSlot = CONTACT_SCHEDULER_NO_SLOT;
+    if ( scheduled )
+    {
+      cModule *scheduler = findHost()->parentModule()->submodule("contactScheduler");
+      if ( scheduler == NULL )
+        error("Contact scheduler not found");
+      m_scheduler = check_and_cast<ContactScheduler*>(scheduler);
+    }
+
+    // The contact index of the network is optional
+    cModule *index = findHost()->parentModule()->submodule("contactIndex");
+    m_contactIndex = index != NULL ? check_and_cast<ContactIndex*>(index) : NULL;
+    m_indexedId = -1;
   }
   else if ( stage == 1 )
   {
@@ -49,7 +82,21 @@ void ContactNotifier::initialize(int stage)
 
 void ContactNotifier::finish()
 {
+  if ( m_contactCount > 0 )
+  {
+    recordScalar("contact.publishes", m_publishCount);
+    recordScalar("contact.batchPublishes", m_batchPublishCount);
+    recordScalar("contact.publishes.saved", (double)m_contactCount - (double)m_publishCount);
+  }
+  if ( m_scheduler != NULL && m_schedulerSlot != CONTACT_SCHEDULER_NO_SLOT )
+    m_scheduler->removeEndpoint( m_schedulerSlot );
+  m_schedulerSlot = CONTACT_SCHEDULER_NO_SLOT;
+  // A destroyed node is no longer in contact with anyone
+  if ( m_contactIndex != NULL && m_indexedId >= 0 )
+    m_contactIndex->removeNode( m_indexedId );
+  m_indexedId = -1;
   cancelAndDelete(contactEvent);
+  contactEvent = NULL;
 }
 
 void ContactNotifier::handleMessage(cMessage *msg)
@@ -66,27 +113,24 @@ void ContactNotifier::handleMessage(cMessage *msg)
 }
 
 
-void ContactNotifier::initializeTrace( const contactEventsList *eventList )
+void ContactNotifier::initializeTrace( contactEventsVector *eventList, int nodeId )
 {
   Enter_Method("initializeTrace");
      
   ev << fullPath() << ": Initializing contact and break events" << endl;
   
+  m_nodeId = nodeId;
   if ( eventList == NULL )
     return;
     
-  // Copy the given event list to the internal list.
-  m_eventList.resize(eventList->size());
-  std::copy(eventList->begin(),eventList->end(),m_eventList.begin());
-
-  CONTACT_EVENT ce;
+  CONTACT ce;
   
   #ifdef __CONTACT_NOTIFIER_DEBUG__  
-  contactEventsList::iterator i = m_eventList.begin();
-  for(; i != m_eventList.end();i++)
+  contactEventsVector::const_iterator i = eventList->begin();
+  for(; i != eventList->end();i++)
   {
     ce = (*i);
-    ev << "event: id=" << ce.id << " time=" << ce.time << " peer=" << ce.peerId;
+    ev << "event: id=" << m_nodeId << " time=" << ce.time << " peer=" << ce.peerId;
     ev << " ct=";
     if ( ce.type == Contact )
       ev << "Contact";
@@ -95,14 +139,22 @@ void ContactNotifier::initializeTrace( const contactEventsList *eventList )
     ev << endl;
   }  
   #endif
-      
-  if ( m_eventList.size() > 0 )
+
+  // Take over the given events without a copy
+  m_eventList.adopt(*eventList);
+  if ( !m_eventList.empty() && m_scheduler != NULL )
+  {
+    // Leave the first contact to the scheduler
+    m_nextContact = m_eventList.next();
+    m_schedulerSlot = m_scheduler->addEndpoint( this );
+    m_scheduler->schedule( m_schedulerSlot, simTime()+m_nextContact.time );
+  }
+  else if ( !m_eventList.empty() )
   {
     // Schedule the first contact event in the list
-    ce = m_eventList.front();
-    m_eventList.pop_front();   
+    ce = m_eventList.next();
     
-    contactEvent->setId(ce.id);
+    contactEvent->setId(m_nodeId);
     contactEvent->setPeerId(ce.peerId);
     contactEvent->setType(ce.type);
     scheduleAt(simTime()+ce.time,contactEvent);
@@ -118,18 +170,14 @@ void ContactNotifier::notifyContact()
                    << " Type=" << contactEvent->getType() << endl;
   #endif
     
-  hostContact.id = contactEvent->getId();
-  hostContact.peerId = contactEvent->getPeerId();
-  hostContact.type = contactEvent->getType();               
-  bb->publishBBItem(hostContactCategory, &hostContact, hostId);                   
+  publishInstant(contactEvent->getId(), contactEvent->getPeerId(), contactEvent->getType());
 
-  if ( m_eventList.size() > 0 )
+  if ( !m_eventList.empty() )
   {
     // Scheduling the next contact in the list
-    CONTACT_EVENT ce = m_eventList.front();
-    m_eventList.pop_front();   
+    CONTACT ce = m_eventList.next();
     
-    contactEvent->setId(ce.id);
+    contactEvent->setId(m_nodeId);
     contactEvent->setPeerId(ce.peerId);
     contactEvent->setType(ce.type);
     #ifdef __CONTACT_NOTIFIER_DEBUG__
@@ -139,3 +187,96 @@ void ContactNotifier::notifyContact()
   }   
 }
 
+double ContactNotifier::deliverContact()
+{
+  Enter_Method_Silent();
+
+  #ifdef __CONTACT_NOTIFIER_DEBUG__
+  ev << fullPath() << ": Notifying scheduled contact. "
+                   << " Id= " << m_nodeId << " PeerId=" << m_nextContact.peerId
+                   << " Type=" << m_nextContact.type << endl;
+  #endif
+
+  publishInstant(m_nodeId, m_nextContact.peerId, m_nextContact.type);
+
+  if ( m_eventList.empty() )
+  {
+    // The scheduler releases the slot of the node
+    m_schedulerSlot = CONTACT_SCHEDULER_NO_SLOT;
+    return -1.0;
+  }
+  m_nextContact = m_eventList.next();
+  return m_nextContact.time;
+}
+
+void ContactNotifier::publishContact( int id, int peerId, int type )
+{
+  // The index is updated first, so that subscribers querying it see the contact
+  if ( m_contactIndex != NULL )
+  {
+    m_contactIndex->update(id, peerId, type);
+    m_indexedId = id;
+  }
+
+  m_contactCount++;
+  if ( !m_skipUnsubscribed || m_contactSubscribers > 0 )
+  {
+    hostContact.id = id;
+    hostContact.peerId = peerId;
+    hostContact.type = type;
+    bb->publishBBItem(hostContactCategory, &hostContact, hostId);
+    m_publishCount++;
+  }
+
+  if ( m_batchSubscribers > 0 )
+  {
+    HOST_CONTACT_CHANGE change;
+    change.peerId = peerId;
+    change.type = type;
+    hostContactBatch.changes.push_back(change);
+  }
+}
+
+void ContactNotifier::publishInstant( int id, int peerId, int type )
+{
+  hostContactBatch.changes.clear();
+  publishContact(id, peerId, type);
+  if ( m_batchSubscribers == 0 )
+    return;
+
+  // The following contacts of the node at the same instant are published with it,
+  // without events of their own
+  while ( !m_eventList.empty() && m_eventList.peek().time == 0.0 )
+  {
+    const CONTACT &ce = m_eventList.next();
+    publishContact(id, ce.peerId, ce.type);
+  }
+  hostContactBatch.id = id;
+  bb->publishBBItem(hostContactBatchCategory, &hostContactBatch, hostId);
+  m_batchPublishCount++;
+}
+
+ContactNotifier *ContactNotifier::notifierOf( cModule *host )
+{
+  if ( host == NULL )
+    return NULL;
+  cModule *navigator = host->submodule("navigator");
+  return navigator != NULL ? dynamic_cast<ContactNotifier*>(navigator) : NULL;
+}
+
+bool ContactNotifier::registerSubscriber( cModule *host, bool batch )
+{
+  ContactNotifier *notifier = notifierOf( host );
+  if ( notifier == NULL )
+    return false;
+  batch ? notifier->m_batchSubscribers++ : notifier->m_contactSubscribers++;
+  return true;
+}
+
+void ContactNotifier::unregisterSubscriber( cModule *host, bool batch )
+{
+  ContactNotifier *notifier = notifierOf( host );
+  if ( notifier == NULL )
+    return;
+  batch ? notifier->m_batchSubscribers-- : notifier->m_contactSubscribers--;
+}
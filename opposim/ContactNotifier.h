@@ -2,7 +2,8 @@
 // ***************************************************************************
 // 
 // OppoNet Project
-//// This file is a part of the opponet project, jointly managed by the 
+//
+// This file is a part of the opponet project, jointly managed by the 
 // Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden 
 // and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
 // University, Iceland.
@@ -30,9 +31,13 @@
 #include <omnetpp.h>
 #include <BasicMobility.h>
 #include "TraceTypes.h"
+#include "CompactTrace.h"
 #include "TraceEvents_m.h"
 #include "HostContact.h"
 
+class ContactScheduler;
+class ContactIndex;
+
 /**
  * @brief ContactNotifier module 
  *
@@ -47,6 +52,21 @@
  * The events are made available as notifications through the Blackboard using a HostContact
  * structure. See the simple ContactSubscriber implementation as an example.
  *
+ * With the scheduled parameter set, the module is an endpoint of the ContactScheduler
+ * of the network. The scheduler keeps the next contact of the node along with those of
+ * all other scheduled nodes and calls deliverContact() at its time, which publishes it.
+ *
+ * Each contact change of the node is published as a HostContact item. With a registered
+ * batch subscriber, all changes of the node at an instant are handled together and are
+ * also published as a single HostContactBatch item. Without one, each change has an
+ * event of its own, so the order of events at an instant is not affected. Subscribers
+ * register with registerSubscriber(), as the Blackboard does not tell whether an item
+ * has subscribers. With the skipUnsubscribed parameter set, HostContact items are only
+ * published to hosts with a registered subscriber of them.
+ *
+ * If the network has a ContactIndex module, every contact and break published by the
+ * module also updates the global contact graph kept by the index.
+ *
  * Note that ContactNotifier inherits from BasicMobility. It can thus be substituted for
  * BasicMobility-derived mobility modules in host node modules although it is not
  * strictly a mobility module.
@@ -58,15 +78,42 @@
 class ContactNotifier : public BasicMobility
 {
   private:    
-    /** @brief The contact events list */
-    contactEventsList m_eventList;
+    /** @brief The contact events not yet scheduled */
+    ContactStore m_eventList;
+    /** @brief The id of the node, given with its contact events */
+    int m_nodeId;
     
     /** @brief The HostContact data structure. Used for Blackboard notifications. */
     HostContact hostContact;
     int hostContactCategory;
+    /** @brief The HostContactBatch data structure, the contact changes of an instant */
+    HostContactBatch hostContactBatch;
+    int hostContactBatchCategory;
+
+    /** @brief Skip HostContact items when no subscriber of the host is registered */
+    bool m_skipUnsubscribed;
+    /** @brief The registered subscribers of HostContact and HostContactBatch items */
+    int m_contactSubscribers;
+    int m_batchSubscribers;
+    /** @brief The contact changes of the node and the HostContact and HostContactBatch
+               items published */
+    unsigned long m_contactCount;
+    unsigned long m_publishCount;
+    unsigned long m_batchPublishCount;
     
     /** @brief The contactEvent fires when a contact is established or broken. */
     ContactEvent *contactEvent;
+
+    /** @brief The scheduler delivering the contacts in scheduled mode, NULL otherwise */
+    ContactScheduler *m_scheduler;
+    unsigned int      m_schedulerSlot;
+    /** @brief The next contact to deliver in scheduled mode */
+    CONTACT           m_nextContact;
+
+    /** @brief The contact index of the network, NULL if there is none */
+    ContactIndex     *m_contactIndex;
+    /** @brief The id of the node in the contact index, -1 before its first contact */
+    int               m_indexedId;
       
   public:
     Module_Class_Members( ContactNotifier, BasicMobility, 0 );
@@ -78,13 +125,32 @@ class ContactNotifier : public BasicMobility
     /** @brief The message handler. */
     virtual void handleMessage(cMessage *msg);
     
-    /** @brief Initialize the waypoint event list. Called by the 
+    /** @brief Initialize the contact event list of a node. Called by the 
                trace factory object upon creation of the node */    
-    void initializeTrace( const contactEventsList *eventList );
+    void initializeTrace( contactEventsVector *eventList, int nodeId );
+    /** @brief Publishes the next contact in scheduled mode. Returns the time to the
+               following contact, or a negative time if there are no more contacts.
+               Called by the contact scheduler. */
+    double deliverContact();
+
+    /** @brief Registers a subscriber of the HostContact items of a host or, with batch
+               set, of its HostContactBatch items. Subscribers register in initialization
+               stage 1 or later. Returns false if the host has no ContactNotifier. */
+    static bool registerSubscriber( cModule *host, bool batch );
+    /** @brief Removes a subscriber registered with registerSubscriber() */
+    static void unregisterSubscriber( cModule *host, bool batch );
     
   private:
     /** @brief Handles a contact event. */
     void notifyContact();
+    /** @brief Publishes a contact or break on the Blackboard and updates the contact
+               index */
+    void publishContact( int id, int peerId, int type );
+    /** @brief Publishes a contact or break and, with batch subscribers, the following
+               ones at the same instant and the batch of them */
+    void publishInstant( int id, int peerId, int type );
+    /** @brief Returns the ContactNotifier of a host, NULL if there is none */
+    static ContactNotifier *notifierOf( cModule *host );
 };
 
 #endif /* __CONTACT_NOTIFIER_INCLUDED__ */
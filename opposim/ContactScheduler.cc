@@ -0,0 +1,183 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "ContactScheduler.h"
+#include "ContactNotifier.h"
+
+Define_Module(ContactScheduler);
+
+ContactScheduler::ContactScheduler()
+{
+  m_dispatchEvent = NULL;
+  m_dispatches = 0;
+  m_deliveries = 0;
+  m_discarded = 0;
+  m_endpointCount = 0;
+  m_maxEndpoints = 0;
+}
+
+void ContactScheduler::initialize()
+{
+  double bucketWidth;
+  int buckets;
+  hasPar("bucketWidth") ? bucketWidth = par("bucketWidth") : bucketWidth = 1.0;
+  hasPar("buckets") ? buckets = par("buckets") : buckets = 64;
+  if ( bucketWidth <= 0.0 || buckets <= 0 )
+    error("The contact scheduler bucket width and number of buckets must be positive");
+  m_calendar.configure( bucketWidth, buckets );
+
+  ev << fullPath() << ": initializing ContactScheduler module." << endl;
+  ev << "    bucket width: " << bucketWidth << endl;
+  ev << "    buckets:      " << buckets << endl;
+
+  m_dispatchEvent = new cMessage("contactDispatch");
+
+  if ( ev.isGUI() )
+  {
+    WATCH(m_dispatches);
+    WATCH(m_deliveries);
+  }
+}
+
+void ContactScheduler::finish()
+{
+  ev << fullPath() << ": Finishing run at " << simTime() << endl;
+  ev << "    Dispatches:        " << m_dispatches << endl;
+  ev << "    Deliveries:        " << m_deliveries << endl;
+  ev << "    Calendar resizes:  " << m_calendar.resizes() << endl;
+  recordScalar("scheduler.dispatches", m_dispatches);
+  recordScalar("scheduler.deliveries", m_deliveries);
+  recordScalar("scheduler.discarded", m_discarded);
+  recordScalar("scheduler.endpoints.max", m_maxEndpoints);
+  recordScalar("scheduler.resizes", m_calendar.resizes());
+
+  if ( m_dispatchEvent != NULL )
+    cancelAndDelete(m_dispatchEvent);
+  m_dispatchEvent = NULL;
+}
+
+void ContactScheduler::handleMessage( cMessage *msg )
+{
+  if ( msg == m_dispatchEvent )
+  {
+    m_dispatches++;
+    _dispatch();
+    _scheduleDispatch();
+  }
+  else
+  {
+    ev << fullPath() << ": Unexpected message " << msg->name() << endl;
+    delete msg;
+  }
+}
+
+unsigned int ContactScheduler::addEndpoint( ContactNotifier *endpoint )
+{
+  Enter_Method_Silent();
+
+  unsigned int slot;
+  if ( !m_freeSlots.empty() )
+  {
+    slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+    m_endpoints[slot] = endpoint;
+  }
+  else
+  {
+    slot = m_endpoints.size();
+    m_endpoints.push_back( endpoint );
+    m_stamps.push_back( 0 );
+  }
+  m_endpointCount++;
+  if ( m_endpointCount > m_maxEndpoints )
+    m_maxEndpoints = m_endpointCount;
+  return slot;
+}
+
+void ContactScheduler::removeEndpoint( unsigned int slot )
+{
+  Enter_Method_Silent();
+
+  // The contact of the endpoint stays in the calendar until its time, and is then 
+  // discarded by its stamp
+  _releaseSlot( slot );
+}
+
+void ContactScheduler::schedule( unsigned int slot, double time )
+{
+  Enter_Method_Silent();
+
+  m_calendar.insert( time, slot, m_stamps[slot] );
+  _scheduleDispatch();
+}
+
+void ContactScheduler::_dispatch()
+{
+  simtime_t now = simTime();
+  while ( !m_calendar.empty() && m_calendar.top().time <= now )
+  {
+    CONTACT_CALENDAR_ENTRY entry = m_calendar.top();
+    m_calendar.pop();
+    if ( entry.stamp != m_stamps[entry.slot] )
+    {
+      m_discarded++;
+      continue;
+    }
+
+    m_deliveries++;
+    double delay = m_endpoints[entry.slot]->deliverContact();
+    if ( delay >= 0.0 )
+      m_calendar.insert( now + delay, entry.slot, entry.stamp );
+    else
+      _releaseSlot( entry.slot );
+  }
+}
+
+void ContactScheduler::_releaseSlot( unsigned int slot )
+{
+  m_endpoints[slot] = NULL;
+  m_stamps[slot]++;
+  m_freeSlots.push_back( slot );
+  m_endpointCount--;
+}
+
+void ContactScheduler::_scheduleDispatch()
+{
+  if ( m_calendar.empty() )
+  {
+    if ( m_dispatchEvent->isScheduled() )
+      cancelEvent( m_dispatchEvent );
+    return;
+  }
+  double next = m_calendar.top().time;
+  if ( m_dispatchEvent->isScheduled() )
+  {
+    if ( m_dispatchEvent->arrivalTime() <= next )
+      return;
+    cancelEvent( m_dispatchEvent );
+  }
+  scheduleAt( next, m_dispatchEvent );
+}
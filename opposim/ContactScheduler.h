@@ -0,0 +1,97 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __CONTACT_SCHEDULER_INCLUDED__
+#define __CONTACT_SCHEDULER_INCLUDED__
+
+#include <omnetpp.h>
+#include <vector>
+#include "ContactCalendar.h"
+
+// Slot of an endpoint which is not registered with the scheduler
+#define CONTACT_SCHEDULER_NO_SLOT 0xffffffff
+
+class ContactNotifier;
+
+/**
+ * @brief Central contact scheduler module.
+ *
+ * Schedules the contacts of all ContactNotifier modules with the scheduled parameter
+ * set, instead of each of them keeping its own contact event in the future event set.
+ * The next contact of every endpoint is kept in a ContactCalendar, keyed by absolute
+ * time, and the scheduler has a single event in the future event set, at the time of
+ * the earliest contact. When it fires, all contacts of that time are delivered in
+ * one pass, each endpoint publishing its contacts of the time on the Blackboard of its
+ * host and returning the time to its next contact.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class ContactScheduler : public cSimpleModule
+{
+  private:
+    ContactCalendar m_calendar;
+    /** @brief The endpoint in each slot, NULL for free slots */
+    std::vector<ContactNotifier*> m_endpoints;
+    /** @brief The stamp of each slot, changed when the slot is freed. Calendar entries
+               of an earlier stamp are of a removed endpoint and are discarded. */
+    std::vector<unsigned int>     m_stamps;
+    std::vector<unsigned int>     m_freeSlots;
+    cMessage      *m_dispatchEvent;
+
+    unsigned long  m_dispatches;
+    /** @brief The number of deliveries to endpoints, each of all contacts of the
+               endpoint at the time */
+    unsigned long  m_deliveries;
+    unsigned long  m_discarded;
+    unsigned int   m_endpointCount;
+    unsigned int   m_maxEndpoints;
+
+  public:
+    /** @brief Constructor */
+    ContactScheduler();
+
+    /** @brief Registers an endpoint. Returns the slot of the endpoint. */
+    unsigned int addEndpoint( ContactNotifier *endpoint );
+    /** @brief Removes the endpoint in a slot, along with its scheduled contact */
+    void removeEndpoint( unsigned int slot );
+    /** @brief Schedules the next contact of the endpoint in a slot at an absolute time */
+    void schedule( unsigned int slot, double time );
+
+  protected:
+    virtual void initialize();
+    virtual void finish();
+    virtual void handleMessage( cMessage *msg );
+
+  private:
+    /** @brief Delivers all contacts of the current time */
+    void _dispatch();
+    /** @brief Frees a slot */
+    void _releaseSlot( unsigned int slot );
+    /** @brief Schedules the dispatch event at the earliest contact, if any */
+    void _scheduleDispatch();
+};
+
+#endif /* __CONTACT_SCHEDULER_INCLUDED__ */
@@ -26,6 +26,7 @@
 // ***************************************************************************
 
 #include "ContactSubscriber.h"
+#include "ContactNotifier.h"
 
 // The module class needs to be registered with OMNeT++
 Define_Module(ContactSubscriber);
@@ -43,9 +44,29 @@ void ContactSubscriber::initialize(int stage)
 	  cModule *parent = parentModule();
 	  if ( parent == NULL )
       error("Parent not found");
-	  HostContact contact;
-	  catHostContact = bb->subscribe(this, &contact, parent->id());	
+	  hasPar("batched") ? batched = par("batched") : batched = false;
+	  if ( batched )
+	  {
+	    HostContactBatch batch;
+	    catHostContact = bb->subscribe(this, &batch, parent->id());
+	  }
+	  else
+	  {
+	    HostContact contact;
+	    catHostContact = bb->subscribe(this, &contact, parent->id());	
+	  }
 	}
+	else if ( stage == 1 )
+	{
+	  // The notifier of the host is initialized in stage 0
+	  ContactNotifier::registerSubscriber(parentModule(), batched);
+	}
+}
+
+void ContactSubscriber::finish()
+{
+  ContactNotifier::unregisterSubscriber(parentModule(), batched);
+  bb->unsubscribe(this, catHostContact);
 }
 
 void ContactSubscriber::receiveBBItem(int category, const BBItem *details, int scopeModuleId)
@@ -53,13 +74,20 @@ void ContactSubscriber::receiveBBItem(int category, const BBItem *details, int s
 	Enter_Method_Silent();
 	
 	BasicModule::receiveBBItem(category, details, scopeModuleId);
-  if( category == catHostContact ) 
+  if( category == catHostContact && !batched ) 
   {
   	// Get the move information and update the display
   	const HostContact *contact = static_cast<const HostContact *>(details);
   	ev << fullPath() << ": Receving BB update: Contact: " << "id=" << contact->id 
   	                 << ", peer=" << contact->peerId << ", type=" << contact->type << endl;  	
   } 
+  else if ( category == catHostContact && batched )
+  {
+    const HostContactBatch *batch = static_cast<const HostContactBatch *>(details);
+    for ( unsigned int i=0; i < batch->changes.size(); i++ )
+      ev << fullPath() << ": Receving BB update: Contact: " << "id=" << batch->id 
+                       << ", peer=" << batch->changes[i].peerId << ", type=" << batch->changes[i].type << endl;
+  }
 }
 
 
@@ -37,6 +37,10 @@
  * The module subscribes to the HostContact event through the Blackboard.
  * A simple trace is printed upon reception of a HostContact. A real implementation
  * would of course put this information to a better use.
+ * With the batched parameter set, the module instead subscribes to the HostContactBatch
+ * items of its host, all contact changes of an instant in one notification. The module
+ * registers with the ContactNotifier of its host, so that items it does not subscribe
+ * to need not be published.
  *
  * @author Kristjan V. Jonsson
  * @author Olafur R. Helgason
@@ -47,10 +51,15 @@ class ContactSubscriber : public BasicModule
   private:
     /** @brief The blackboard subscription handle. */
 		int catHostContact;		
+    /** @brief Subscribed to HostContactBatch rather than HostContact items */
+    bool batched;
 
   protected:
     /** @brief Initialization of the module. Override of default method. */
     virtual void initialize(int stage);  
+    /** @brief Cancels the subscription, so the module can be initialized again when 
+               recycled by the node factory. */
+    virtual void finish();
     /** @brief Handling of Blackboard notifications. */
     virtual void receiveBBItem(int category, const BBItem *details, int scopeModuleId);  
 };
@@ -28,6 +28,7 @@
 #ifndef __HOST_CONTACT_INCLUDED__
 #define __HOST_CONTACT_INCLUDED__
 
+#include <vector>
 #include "Blackboard.h"
 
 /**
@@ -56,4 +57,40 @@ public:
     }
 };
 
+/**
+ * @brief A contact change of a node, in a HostContactBatch
+ **/
+struct HOST_CONTACT_CHANGE
+{
+  /** @brief The peer id */
+  int peerId;
+  /** @brief Event type. See ContactEventType enum. */
+  int type;
+};
+
+/**
+ * @brief Data structure for notification of all contact changes of a node at an
+ *        instant in a single publish through the blackboard. Only published to hosts
+ *        with a subscriber registered with ContactNotifier::registerSubscriber().
+ **/
+class HostContactBatch : public BBItem 
+{
+  BBITEM_METAINFO(BBItem);
+
+  public:
+    /** @brief The node (module host) id */
+    int id;
+    /** @brief The contact changes, in the order of the trace */
+    std::vector<HOST_CONTACT_CHANGE> changes;
+        
+public:
+    
+    std::string info() {
+        std::ostringstream ost;
+        ost << " HostContactBatch "
+            << " changes: " << changes.size();
+        return ost.str();
+    }
+};
+
 #endif
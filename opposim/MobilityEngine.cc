@@ -0,0 +1,256 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "MobilityEngine.h"
+#include <math.h>
+
+MobilityEngine::MobilityEngine( double updateInterval )
+{
+  m_updateInterval = updateInterval;
+  m_moving = 0;
+  m_nodeSteps = 0;
+}
+
+unsigned int MobilityEngine::addNode( double time, double x, double y, waypointEventsVector &waypoints )
+{
+  unsigned int slot = m_x.size();
+  m_x.push_back( x );
+  m_y.push_back( y );
+  m_dx.push_back( 0.0 );
+  m_dy.push_back( 0.0 );
+  m_steps.push_back( 0 );
+  m_targetX.push_back( x );
+  m_targetY.push_back( y );
+  m_speed.push_back( 0.0 );
+  m_activate.push_back( time );
+  m_waiting.push_back( 0 );
+  m_nextWaypoint.push_back( 0 );
+  // Take over the storage of the waypoints
+  m_waypoints.push_back( waypointEventsVector() );
+  m_waypoints.back().swap( waypoints );
+  m_changedMark.push_back( 0 );
+
+  // The node starts out at its target, ready for its first waypoint
+  _arrive( slot, time );
+  return slot;
+}
+
+unsigned int MobilityEngine::removeNode( unsigned int slot )
+{
+  if ( m_steps[slot] > 0 )
+    m_moving--;
+
+  unsigned int last = m_x.size() - 1;
+  if ( slot != last )
+  {
+    m_x[slot] = m_x[last];
+    m_y[slot] = m_y[last];
+    m_dx[slot] = m_dx[last];
+    m_dy[slot] = m_dy[last];
+    m_steps[slot] = m_steps[last];
+    m_targetX[slot] = m_targetX[last];
+    m_targetY[slot] = m_targetY[last];
+    m_speed[slot] = m_speed[last];
+    m_activate[slot] = m_activate[last];
+    m_waiting[slot] = m_waiting[last];
+    m_nextWaypoint[slot] = m_nextWaypoint[last];
+    m_waypoints[slot].swap( m_waypoints[last] );
+    m_changedMark[slot] = m_changedMark[last];
+  }
+  m_x.pop_back();
+  m_y.pop_back();
+  m_dx.pop_back();
+  m_dy.pop_back();
+  m_steps.pop_back();
+  m_targetX.pop_back();
+  m_targetY.pop_back();
+  m_speed.pop_back();
+  m_activate.pop_back();
+  m_waiting.pop_back();
+  m_nextWaypoint.pop_back();
+  m_waypoints.pop_back();
+  m_changedMark.pop_back();
+
+  // Changes are drained before nodes are removed, so the changed list only needs to
+  // drop the removed node and follow the moved one
+  for ( unsigned int i=0; i < m_changed.size(); )
+  {
+    if ( m_changed[i] == slot )
+    {
+      m_changed[i] = m_changed.back();
+      m_changed.pop_back();
+    }
+    else
+    {
+      if ( m_changed[i] == last )
+        m_changed[i] = slot;
+      i++;
+    }
+  }
+  return slot != last ? last : MOBILITY_ENGINE_NO_SLOT;
+}
+
+void MobilityEngine::clear()
+{
+  m_x.clear();
+  m_y.clear();
+  m_dx.clear();
+  m_dy.clear();
+  m_steps.clear();
+  m_targetX.clear();
+  m_targetY.clear();
+  m_speed.clear();
+  m_activate.clear();
+  m_waiting.clear();
+  m_nextWaypoint.clear();
+  m_waypoints.clear();
+  m_changedMark.clear();
+  m_changed.clear();
+  m_moving = 0;
+}
+
+void MobilityEngine::step( double time )
+{
+  unsigned int n = m_x.size();
+  if ( n == 0 )
+    return;
+
+  // Advance every node by its step. The step of a node which is not moving is zero,
+  // so the pass has no branches and is vectorized.
+  double *x = &m_x[0];
+  double *y = &m_y[0];
+  const double *dx = &m_dx[0];
+  const double *dy = &m_dy[0];
+  for ( unsigned int i=0; i < n; i++ )
+  {
+    x[i] += dx[i];
+    y[i] += dy[i];
+  }
+
+  // Count down the steps of the moving nodes and activate due waypoints
+  for ( unsigned int i=0; i < n; i++ )
+  {
+    if ( m_steps[i] > 0 )
+    {
+      m_nodeSteps++;
+      _markChanged( i );
+      if ( --m_steps[i] == 0 )
+      {
+        m_moving--;
+        _arrive( i, time );
+      }
+    }
+    else if ( m_waiting[i] && m_activate[i] <= time )
+      _start( i, time );
+  }
+}
+
+double MobilityEngine::nextTime( double time ) const
+{
+  if ( m_moving > 0 )
+    return time + m_updateInterval;
+
+  // No node is moving. The next tick is at the earliest waypoint activation.
+  double next = -1.0;
+  for ( unsigned int i=0; i < m_x.size(); i++ )
+    if ( m_waiting[i] && ( next < 0.0 || m_activate[i] < next ) )
+      next = m_activate[i];
+  if ( next >= 0.0 && next < time )
+    next = time;
+  return next;
+}
+
+void MobilityEngine::clearChanged()
+{
+  for ( unsigned int i=0; i < m_changed.size(); i++ )
+    m_changedMark[m_changed[i]] = 0;
+  m_changed.clear();
+}
+
+void MobilityEngine::_arrive( unsigned int slot, double time )
+{
+  // Waypoints reached at once, jumps and waypoints at the present location, are 
+  // handled in turn without waiting for a tick
+  while ( true )
+  {
+    m_x[slot] = m_targetX[slot];
+    m_y[slot] = m_targetY[slot];
+    m_dx[slot] = 0.0;
+    m_dy[slot] = 0.0;
+    m_steps[slot] = 0;
+    m_waiting[slot] = 0;
+    _markChanged( slot );
+
+    waypointEventsVector &waypoints = m_waypoints[slot];
+    if ( m_nextWaypoint[slot] >= waypoints.size() )
+      return;
+    const WAYPOINT &waypoint = waypoints[m_nextWaypoint[slot]++];
+    m_targetX[slot] = waypoint.x;
+    m_targetY[slot] = waypoint.y;
+    m_speed[slot] = waypoint.speed;
+    m_activate[slot] = waypoint.time > time ? waypoint.time : time;
+    m_waiting[slot] = 1;
+    if ( m_activate[slot] > time )
+      return;
+
+    double distance = sqrt( ( m_targetX[slot] - m_x[slot] ) * ( m_targetX[slot] - m_x[slot] ) +
+                            ( m_targetY[slot] - m_y[slot] ) * ( m_targetY[slot] - m_y[slot] ) );
+    if ( distance > 0.0 && m_speed[slot] > 0.0 )
+    {
+      _start( slot, time );
+      return;
+    }
+  }
+}
+
+void MobilityEngine::_start( unsigned int slot, double time )
+{
+  double distance = sqrt( ( m_targetX[slot] - m_x[slot] ) * ( m_targetX[slot] - m_x[slot] ) +
+                          ( m_targetY[slot] - m_y[slot] ) * ( m_targetY[slot] - m_y[slot] ) );
+  if ( distance == 0.0 || m_speed[slot] <= 0.0 )
+  {
+    _arrive( slot, time );
+    return;
+  }
+
+  int steps = static_cast<int>( ceil( distance / m_speed[slot] / m_updateInterval ) );
+  if ( steps < 1 )
+    steps = 1;
+  m_steps[slot] = steps;
+  m_dx[slot] = ( m_targetX[slot] - m_x[slot] ) / steps;
+  m_dy[slot] = ( m_targetY[slot] - m_y[slot] ) / steps;
+  m_waiting[slot] = 0;
+  m_moving++;
+  _markChanged( slot );
+}
+
+void MobilityEngine::_markChanged( unsigned int slot )
+{
+  if ( m_changedMark[slot] )
+    return;
+  m_changedMark[slot] = 1;
+  m_changed.push_back( slot );
+}
@@ -0,0 +1,133 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __MOBILITY_ENGINE_INCLUDED__
+#define __MOBILITY_ENGINE_INCLUDED__
+
+#include <string>
+#include <list>
+#include <vector>
+#include "TraceTypes.h"
+
+// Slot of a node which is not in the engine
+#define MOBILITY_ENGINE_NO_SLOT 0xffffffff
+
+/**
+ * @brief Steps the trace driven movement of many nodes at once.
+ *
+ * The state of the nodes is kept in structure-of-arrays form, one array per field,
+ * indexed by the slot of the node. All nodes are stepped at the same ticks, one
+ * update interval apart. A tick first advances the location of every node by its 
+ * step in a single pass over the location and step arrays, which the compiler turns
+ * into vector instructions, and then handles the nodes arriving at their target.
+ *
+ * The movement follows the stepped mode of TraceMobility, on the shared ticks. A
+ * waypoint is activated at the first tick at or after its time, or when the previous
+ * one is reached if that is later. The node then moves to it in whole steps of the
+ * update interval, starting at the next tick. While a node is moving the ticks are
+ * one update interval apart, so a waypoint time or node creation between ticks is
+ * rounded to a tick, unlike in the stepped mode of TraceMobility. Otherwise the next
+ * tick is at the earliest waypoint activation. A waypoint
+ * with no speed is jumped to. The slots of the nodes whose location, speed or target
+ * changed in a tick are listed by changed().
+ *
+ * The engine does not depend on OMNeT++ and is used by the MobilityManager module.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class MobilityEngine
+{
+  private:
+    double m_updateInterval;
+
+    // The state of the nodes, indexed by slot. The step of a node is zero unless it
+    // is moving.
+    std::vector<double>       m_x;
+    std::vector<double>       m_y;
+    std::vector<double>       m_dx;
+    std::vector<double>       m_dy;
+    std::vector<int>          m_steps;
+    std::vector<double>       m_targetX;
+    std::vector<double>       m_targetY;
+    std::vector<double>       m_speed;
+    /** @brief The activation time of the target waypoint of a waiting node */
+    std::vector<double>       m_activate;
+    std::vector<char>         m_waiting;
+    /** @brief The index of the next waypoint of each node in its waypoint list */
+    std::vector<unsigned int> m_nextWaypoint;
+    std::vector<waypointEventsVector> m_waypoints;
+
+    /** @brief The number of nodes moving */
+    unsigned int m_moving;
+    std::vector<unsigned int> m_changed;
+    std::vector<char>         m_changedMark;
+    unsigned long m_nodeSteps;
+
+  public:
+    /** @brief Constructor */
+    MobilityEngine( double updateInterval = 1.0 );
+
+    /** @brief Sets the interval between ticks in seconds */
+    void setUpdateInterval( double updateInterval ) { m_updateInterval = updateInterval; }
+    double updateInterval() const { return m_updateInterval; }
+
+    /** @brief Adds a node at a location and activates its first waypoint. Returns its slot.
+               The engine takes over the waypoints and leaves the list empty. */
+    unsigned int addNode( double time, double x, double y, waypointEventsVector &waypoints );
+    /** @brief Removes the node in a slot. The last node is moved into the slot. Returns 
+               the former slot of the moved node, or MOBILITY_ENGINE_NO_SLOT if none. */
+    unsigned int removeNode( unsigned int slot );
+    /** @brief Removes all nodes */
+    void clear();
+
+    /** @brief Advances all nodes by one tick at a time */
+    void step( double time );
+    /** @brief Returns the time of the next tick after a time, or a negative time if no
+               node is moving or waiting for a waypoint */
+    double nextTime( double time ) const;
+
+    /** @brief Returns the slots of the nodes changed since clearChanged() */
+    const std::vector<unsigned int> &changed() const { return m_changed; }
+    void clearChanged();
+
+    unsigned int size() const { return m_x.size(); }
+    double x( unsigned int slot ) const { return m_x[slot]; }
+    double y( unsigned int slot ) const { return m_y[slot]; }
+    double speed( unsigned int slot ) const { return m_steps[slot] > 0 ? m_speed[slot] : 0.0; }
+    double targetX( unsigned int slot ) const { return m_targetX[slot]; }
+    double targetY( unsigned int slot ) const { return m_targetY[slot]; }
+    /** @brief Returns the number of node steps taken */
+    unsigned long nodeSteps() const { return m_nodeSteps; }
+
+  private:
+    /** @brief Moves a node to its target and activates its next waypoint, if any */
+    void _arrive( unsigned int slot, double time );
+    /** @brief Starts the movement of a node to its target */
+    void _start( unsigned int slot, double time );
+    void _markChanged( unsigned int slot );
+};
+
+#endif /* __MOBILITY_ENGINE_INCLUDED__ */
@@ -0,0 +1,152 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "MobilityManager.h"
+#include "TraceMobility.h"
+
+// Ticks are handled before the events of the nodes at the same time
+#define MOBILITY_TICK_PRIORITY -1
+
+Define_Module(MobilityManager);
+
+MobilityManager::MobilityManager()
+{
+  m_updateInterval = 1.0;
+  m_tickEvent = NULL;
+  m_ticks = 0;
+  m_publishes = 0;
+  m_maxNodes = 0;
+}
+
+void MobilityManager::initialize()
+{
+  hasPar("updateInterval") ? m_updateInterval = par("updateInterval") : m_updateInterval = 1.0;
+  if ( m_updateInterval <= 0.0 )
+    error("The mobility manager update interval must be positive");
+  m_engine.setUpdateInterval( m_updateInterval );
+
+  ev << fullPath() << ": initializing MobilityManager module." << endl;
+  ev << "    update interval: " << m_updateInterval << endl;
+
+  m_tickEvent = new cMessage("mobilityTick");
+  m_tickEvent->setPriority(MOBILITY_TICK_PRIORITY);
+
+  if ( ev.isGUI() )
+  {
+    WATCH(m_ticks);
+    WATCH(m_publishes);
+  }
+}
+
+void MobilityManager::finish()
+{
+  ev << fullPath() << ": Finishing run at " << simTime() << endl;
+  ev << "    Ticks:             " << m_ticks << endl;
+  ev << "    Node steps:        " << m_engine.nodeSteps() << endl;
+  ev << "    Move publishes:    " << m_publishes << endl;
+  recordScalar("manager.ticks", m_ticks);
+  recordScalar("manager.steps", m_engine.nodeSteps());
+  recordScalar("manager.publishes", m_publishes);
+  recordScalar("manager.nodes.max", m_maxNodes);
+
+  if ( m_tickEvent != NULL )
+    cancelAndDelete(m_tickEvent);
+  m_tickEvent = NULL;
+}
+
+void MobilityManager::handleMessage( cMessage *msg )
+{
+  if ( msg == m_tickEvent )
+  {
+    m_ticks++;
+    m_engine.step( simTime() );
+    _publishChanges();
+    _scheduleTick();
+  }
+  else
+  {
+    ev << fullPath() << ": Unexpected message " << msg->name() << endl;
+    delete msg;
+  }
+}
+
+unsigned int MobilityManager::addNode( TraceMobility *proxy, const Coord &position, waypointEventsVector &waypoints )
+{
+  Enter_Method_Silent();
+
+  unsigned int slot = m_engine.addNode( simTime(), position.x, position.y, waypoints );
+  m_proxies.push_back( proxy );
+  if ( m_proxies.size() > m_maxNodes )
+    m_maxNodes = m_proxies.size();
+  // The first waypoint may have been activated already
+  _publishChanges();
+  _scheduleTick();
+  return slot;
+}
+
+void MobilityManager::removeNode( unsigned int slot )
+{
+  Enter_Method_Silent();
+
+  unsigned int moved = m_engine.removeNode( slot );
+  if ( moved != MOBILITY_ENGINE_NO_SLOT )
+  {
+    m_proxies[slot] = m_proxies[moved];
+    m_proxies[slot]->setManagerSlot( slot );
+  }
+  m_proxies.pop_back();
+}
+
+void MobilityManager::_publishChanges()
+{
+  const std::vector<unsigned int> &changed = m_engine.changed();
+  for ( unsigned int i=0; i < changed.size(); i++ )
+  {
+    unsigned int slot = changed[i];
+    m_proxies[slot]->managedMove( Coord( m_engine.x(slot), m_engine.y(slot) ), m_engine.speed(slot),
+                                  Coord( m_engine.targetX(slot), m_engine.targetY(slot) ) );
+  }
+  m_publishes += changed.size();
+  m_engine.clearChanged();
+}
+
+void MobilityManager::_scheduleTick()
+{
+  double next = m_engine.nextTime( simTime() );
+  if ( next < 0.0 )
+  {
+    if ( m_tickEvent->isScheduled() )
+      cancelEvent( m_tickEvent );
+    return;
+  }
+  if ( m_tickEvent->isScheduled() )
+  {
+    if ( m_tickEvent->arrivalTime() <= next )
+      return;
+    cancelEvent( m_tickEvent );
+  }
+  scheduleAt( next, m_tickEvent );
+}
@@ -0,0 +1,84 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __MOBILITY_MANAGER_INCLUDED__
+#define __MOBILITY_MANAGER_INCLUDED__
+
+#include <omnetpp.h>
+#include <vector>
+#include <Coord.h>
+#include "MobilityEngine.h"
+
+class TraceMobility;
+
+/**
+ * @brief Central mobility manager module.
+ *
+ * Moves all TraceMobility modules with the managed parameter set, instead of each
+ * of them scheduling its own updates. The nodes are kept in a MobilityEngine, which
+ * holds their state in structure-of-arrays form and steps all of them in one pass at
+ * each tick. Only the navigators of the nodes whose movement changed in a tick are
+ * told to publish their new position, so the navigators are thin proxies and the 
+ * manager schedules a single event per tick for all nodes.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class MobilityManager : public cSimpleModule
+{
+  private:
+    double         m_updateInterval;
+    MobilityEngine m_engine;
+    /** @brief The navigator of the node in each slot of the engine */
+    std::vector<TraceMobility*> m_proxies;
+    cMessage      *m_tickEvent;
+
+    unsigned long  m_ticks;
+    unsigned long  m_publishes;
+    unsigned long  m_maxNodes;
+
+  public:
+    /** @brief Constructor */
+    MobilityManager();
+
+    /** @brief Adds the node of a navigator at its location with its waypoints. Returns
+               the slot of the node. The waypoints are taken over, leaving the list empty. */
+    unsigned int addNode( TraceMobility *proxy, const Coord &position, waypointEventsVector &waypoints );
+    /** @brief Removes the node in a slot */
+    void removeNode( unsigned int slot );
+
+  protected:
+    virtual void initialize();
+    virtual void finish();
+    virtual void handleMessage( cMessage *msg );
+
+  private:
+    /** @brief Tells the navigators of the changed nodes to publish their movement */
+    void _publishChanges();
+    /** @brief Schedules the next tick, if any node is moving or waiting */
+    void _scheduleTick();
+};
+
+#endif /* __MOBILITY_MANAGER_INCLUDED__ */
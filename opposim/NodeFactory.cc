@@ -25,6 +25,53 @@
 // ***************************************************************************
 
 #include "NodeFactory.h"
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <set>
+
+/**
+ * @brief Orders trace events by their scheduled time. Used with a stable sort so that
+ *        events with equal times keep the order they appear in the trace file.
+ */
+struct TraceEventTimeLess
+{
+  bool operator()( const TraceEvent *a, const TraceEvent *b ) const
+  {
+    return a->getTime() < b->getTime();
+  }
+};
+
+/**
+ * @brief Returns the wall clock time in seconds. Used to measure trace parsing throughput.
+ */
+static double wallClock()
+{
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/**
+ * @brief Returns the resident memory of the process, split into private memory and 
+ *        memory shared with other processes, such as a shared trace image. Returns 
+ *        false if the memory use is not available.
+ */
+static bool processMemory( unsigned long &privateBytes, unsigned long &sharedBytes )
+{
+  FILE *f = fopen( "/proc/self/statm", "r" );
+  if ( f == NULL )
+    return false;
+  unsigned long size, resident, shared;
+  int n = fscanf( f, "%lu %lu %lu", &size, &resident, &shared );
+  fclose(f);
+  if ( n != 3 )
+    return false;
+  unsigned long pageSize = sysconf( _SC_PAGESIZE );
+  sharedBytes = shared * pageSize;
+  privateBytes = ( resident - shared ) * pageSize;
+  return true;
+}
 
 //#define __NODE_FACTORY_DEBUG__
 
@@ -44,6 +91,51 @@ NodeFactory::NodeFactory()
   m_destroyedCount = 0;
   m_totalLifetime = 0.0;
   m_traceType = None;
+  m_traceCursor = 0;
+  m_traceCursorEvent = NULL;
+  m_lastNodeId = -1;
+  m_lastNodeIndex = -1;
+  m_recordsPerNodeHint = 0;
+  m_parsedRecords = 0;
+  m_lazyTraceLoading = false;
+  m_lazyLoads = 0;
+  m_traceCacheShared = false;
+  m_loadedTraceBinary = false;
+  m_sharedTraceImage = false;
+  m_useTraceImage = false;
+  m_traceTolerance = 1.0;
+  m_simplifyWaypoints = false;
+  m_simplifyMaxError = 0.0;
+  m_simplifiedWaypoints = 0;
+  m_useTrajectoryService = false;
+  m_contactIndex = NULL;
+  m_poolHits = 0;
+  m_poolMisses = 0;
+  m_poolDiscards = 0;
+  m_createBatches = 0;
+  m_batchedCreates = 0;
+  m_useRegion = false;
+  m_regionX1 = m_regionY1 = m_regionX2 = m_regionY2 = 0.0;
+  m_regionCheckInterval = 1.0;
+  m_regionCheckEvent = NULL;
+  m_materializedNodes = 0;
+  m_materializations = 0;
+  m_dematerializations = 0;
+  m_maxVirtualNodes = 0;
+  m_maxMaterializedNodes = 0;
+  m_virtualNodeTime = 0.0;
+  m_materializedNodeTime = 0.0;
+  m_regionCountTime = 0.0;
+  m_instrumentInterval = 0.0;
+  m_readWallTime = 0.0;
+  m_createWallTime = 0.0;
+  m_destroyWallTime = 0.0;
+  m_runWallStart = 0.0;
+  m_sampleWallTime = 0.0;
+  m_sampleEventNumber = 0;
+  m_maxPendingBytes = 0;
+  m_maxAliveNodes = 0;
+  m_instrumentEvent = NULL;
 }
 
 //
@@ -58,44 +150,247 @@ void NodeFactory::initialize()
 	hasPar("scenarioSizeX") ? m_scenarioSizeX = par("scenarioSizeX") : m_scenarioSizeX = 1000;
 	hasPar("scenarioSizeY") ? m_scenarioSizeY = par("scenarioSizeY") : m_scenarioSizeY = 1000;
   hasPar("traceFile") ? m_traceFile = (const char *)par("traceFile") : m_traceFile = "";
+  hasPar("traceFormat") ? m_traceFormat = (const char *)par("traceFormat") : m_traceFormat = "xml";
+  hasPar("traceLookahead") ? m_traceLookahead = par("traceLookahead") : m_traceLookahead = 60.0;
+  hasPar("traceParserThreads") ? m_traceParserThreads = par("traceParserThreads") : m_traceParserThreads = 1;
+  hasPar("lazyTraceLoading") ? m_lazyTraceLoading = par("lazyTraceLoading") : m_lazyTraceLoading = false;
+  hasPar("traceCacheDir") ? m_traceCacheDir = (const char *)par("traceCacheDir") : m_traceCacheDir = "";
+  hasPar("traceCacheShared") ? m_traceCacheShared = par("traceCacheShared") : m_traceCacheShared = false;
+  hasPar("sharedTraceImage") ? m_sharedTraceImage = par("sharedTraceImage") : m_sharedTraceImage = false;
+  hasPar("traceTolerance") ? m_traceTolerance = par("traceTolerance") : m_traceTolerance = 1.0;
+  hasPar("simplifyWaypoints") ? m_simplifyWaypoints = par("simplifyWaypoints") : m_simplifyWaypoints = false;
+  hasPar("trajectoryService") ? m_useTrajectoryService = par("trajectoryService") : m_useTrajectoryService = false;
+  hasPar("simplifyMaxError") ? m_simplifyMaxError = par("simplifyMaxError") : m_simplifyMaxError = 0.0;
+  hasPar("recyclePool") ? m_recyclePool = (const char *)par("recyclePool") : m_recyclePool = "";
+  hasPar("regionOfInterest") ? m_regionOfInterest = (const char *)par("regionOfInterest") : m_regionOfInterest = "";
+  hasPar("regionCheckInterval") ? m_regionCheckInterval = par("regionCheckInterval") : m_regionCheckInterval = 1.0;
+  hasPar("instrumentInterval") ? m_instrumentInterval = par("instrumentInterval") : m_instrumentInterval = 0.0;
+  if ( m_traceLookahead <= 0.0 )
+    error("The trace lookahead must be positive");
+  if ( m_traceTolerance < 0.0 )
+    error("The trace tolerance must not be negative");
+  if ( m_simplifyMaxError < 0.0 )
+    error("The simplification error must not be negative");
+  if ( m_lazyTraceLoading && m_traceFormat != "xml" && m_traceFormat != "binary" )
+    error("Lazy trace loading is only supported for xml and binary traces");
+  if ( !_parseRecyclePool( m_recyclePool.c_str() ) )
+    error("Malformed recycle pool %s. Use e.g. SimpleNode=100,SimpleContactNode=100.", m_recyclePool.c_str());
+  if ( !_parseRegion( m_regionOfInterest.c_str() ) )
+    error("Malformed region of interest %s. Use x1,y1,x2,y2.", m_regionOfInterest.c_str());
+  if ( m_useRegion && m_regionCheckInterval <= 0.0 )
+    error("The region check interval must be positive");
+
+  // The contact index of the network is optional
+  cModule *index = parentModule()->submodule("contactIndex");
+  m_contactIndex = index != NULL ? check_and_cast<ContactIndex*>(index) : NULL;
 
   // Display initial message
 	ev << fullPath() << ": Initializing object factory" << endl;
 	ev << "    Scenario size:   (" << m_scenarioSizeX << "," << m_scenarioSizeY << ") m" << endl;
   ev << "    Trace file:      " << m_traceFile << endl;
+  ev << "    Trace format:    " << m_traceFormat << endl;
+  ev << "    Trace lookahead: " << m_traceLookahead << " s" << endl;
+  ev << "    Parser threads:  " << m_traceParserThreads << endl;
+  ev << "    Lazy loading:    " << ( m_lazyTraceLoading ? "yes" : "no" ) << endl;
+  if ( m_simplifyWaypoints )
+    ev << "    Simplification:  " << m_simplifyMaxError << " m" << endl;
+  if ( m_traceCacheDir != "" )
+    ev << "    Trace cache:     " << m_traceCacheDir << ( m_traceCacheShared ? " (shared)" : "" ) << endl;
+  if ( m_recyclePool != "" )
+    ev << "    Recycle pool:    " << m_recyclePool << endl;
+  if ( m_useRegion )
+    ev << "    Region:          (" << m_regionX1 << "," << m_regionY1 << ")-(" << m_regionX2 << "," 
+       << m_regionY2 << ") m, checked every " << m_regionCheckInterval << " s" << endl;
 
   // Trace file must be defined. Display error if not.
   if ( m_traceFile == "" )
     error("Trace file is undefined. Cannot initialize trace based mobility or contacts.");
   else       
   {
-    readXmlTrace();
+    double parseStart = wallClock();
+    if ( m_traceFormat == "xml" )
+      readXmlTrace();
+    else if ( m_traceFormat == "binary" )
+      readBinaryTrace( m_traceFile.c_str() );
+    else
+      readSourceTrace();
+
+    // Only the create and destroy commands have been read in lazy mode. Open the 
+    // index used to read the records of each node when it is created.
+    if ( m_lazyTraceLoading )
+    {
+      if ( !m_traceIndex.open( m_loadedTraceFile.c_str(), m_loadedTraceBinary ) )
+        error("Unable to index trace file %s: %s", m_loadedTraceFile.c_str(), m_traceIndex.lastError().c_str());
+      ev << "    Trace index:     " << m_traceIndex.records() << " records, " 
+         << ( m_traceIndex.fromSidecar() ? "read from " : "saved to " ) 
+         << m_loadedTraceFile << TRACE_INDEX_SUFFIX << endl;
+    }
+    double parseTime = wallClock() - parseStart;
+    double parseRate = parseTime > 0.0 ? m_parsedRecords / parseTime : 0.0;
+    m_readWallTime = parseTime;
+
+    ev << "    Trace nodes:     " << ( m_lazyTraceLoading ? m_traceIndex.nodes() : m_nodeIds.size() ) << endl;
+    ev << "    Trace records:   " << m_parsedRecords << endl;
+    ev << "    Parse rate:      " << parseRate << " records/s" << endl;
+
     recordScalar("factory.initialized", m_initializedCount);
+    recordScalar("factory.parse.records", m_parsedRecords);
+    recordScalar("factory.parse.rate", parseRate);
+
+    // Order the create and destroy events by time and start the trace cursor. The 
+    // sort is stable so events with equal times are handled in trace file order.
+    std::stable_sort( m_traceSchedule.begin(), m_traceSchedule.end(), TraceEventTimeLess() );
+
+    // Waypoints loaded on node creation are simplified as they are loaded
+    if ( m_simplifyWaypoints && m_traceType == MobilityTrace && !m_lazyTraceLoading && !m_useTraceImage )
+      _simplifyPendingWaypoints();
+
+    if ( m_useTrajectoryService )
+      _buildTrajectoryService();
+
+    // The pending lists only shrink from here on, except in lazy and image mode where
+    // the records of each node are loaded when it is created
+    m_maxPendingBytes = _pendingBytes();
+
+    if ( m_useRegion && m_traceType != MobilityTrace )
+      error("The region of interest is only supported for mobility traces");
+
+    m_traceCursorEvent = new cMessage("traceCursor", TRACE_CURSOR_EVENT_KIND);
+    m_traceCursorEvent->setPriority(TRACE_CURSOR_PRIORITY);
+    advanceTraceCursor();
+    if ( m_useRegion )
+    {
+      m_regionCheckEvent = new cMessage("regionCheck", REGION_CHECK_EVENT_KIND);
+      m_regionCheckEvent->setPriority(TRACE_EVENT_PRIORITY);
+    }
+    if ( m_instrumentInterval > 0.0 )
+    {
+      m_aliveVector.setName("factory.alive");
+      m_pendingBytesVector.setName("factory.pending.bytes");
+      m_eventRateVector.setName("factory.event.rate");
+      m_memoryVector.setName("factory.memory.private");
+      m_instrumentEvent = new cMessage("instrument", INSTRUMENT_EVENT_KIND);
+      m_instrumentEvent->setPriority(TRACE_CURSOR_PRIORITY);
+      scheduleAt( simTime() + m_instrumentInterval, m_instrumentEvent );
+    }
   }
+  m_runWallStart = m_sampleWallTime = wallClock();
+  m_sampleEventNumber = simulation.eventNumber();
  	
 	if ( ev.isGUI() )
 	{
 	  WATCH(m_initializedCount);
     WATCH(m_generateCount);
     WATCH(m_destroyedCount);
+    WATCH(m_materializedNodes);
 	}		
 }
 
 
 void NodeFactory::finish()
 {
+  double finishStart = wallClock();
+  double runWallTime = finishStart - m_runWallStart;
+  long events = simulation.eventNumber();
+  if ( m_instrumentEvent != NULL )
+    cancelAndDelete(m_instrumentEvent);
+  m_instrumentEvent = NULL;
+
   // Dispose of any remaining dynamically created modules.
+  // Dispose of the region nodes, along with the modules of the materialized ones. The
+  // lifetime of a region node runs from its creation whether it is materialized or not.
+  if ( m_useRegion )
+    _updateRegionCounts();
+  for ( unsigned int i=0; i < m_regionNodes.size(); i++ )
+  {
+    REGION_NODE *node = m_regionNodes[i];
+    NodeFactoryItem *item = NULL;
+    if ( NodeSlotMap::isValid( node->handle ) )
+      item = m_createdItems.remove( node->handle );
+    if ( item != NULL )
+    {
+      item->getModule()->callFinish();
+      item->getModule()->deleteModule();
+      delete item;
+    }
+    m_totalLifetime += simTime() - node->createTime;
+    m_destroyedCount++;
+    delete node->createEvent;
+    delete node;
+  }
+  unsigned long regionNodes = m_regionNodes.size();
+  m_regionNodes.clear();
+  m_regionIndex.clear();
+  if ( m_regionCheckEvent != NULL )
+    cancelAndDelete(m_regionCheckEvent);
+  m_regionCheckEvent = NULL;
+
   NodeFactoryItem *item;
 	for( unsigned int i=0; i < m_createdItems.size(); i++ )
 	{
-		item = (NodeFactoryItem*)m_createdItems[i];
-		if ( item == NULL )
-			continue;
+		item = m_createdItems.at(i);
 		m_totalLifetime += simTime() - item->getCreateTime();
 		item->getModule()->callFinish();
 		item->getModule()->deleteModule();
+		delete item;
 		m_destroyedCount++;
 	}    
+  m_createdItems.clear();
+
+  // Dispose of the parked modules. They have been finished when parked.
+  MODULE_POOL_MAP_TYPE::iterator poolIter;
+  for ( poolIter = m_modulePools.begin(); poolIter != m_modulePools.end(); poolIter++ )
+  {
+    MODULE_POOL &pool = poolIter->second;
+    for ( unsigned int i=0; i < pool.parked.size(); i++ )
+      pool.parked[i]->deleteModule();
+    pool.parked.clear();
+  }
+
+  // Dispose of trace events which were never scheduled
+  for ( unsigned long i=m_traceCursor; i < m_traceSchedule.size(); i++ )
+    delete m_traceSchedule[i];
+  m_traceSchedule.clear();
+  m_traceCursor = 0;
+  if ( m_traceCursorEvent != NULL )
+    cancelAndDelete(m_traceCursorEvent);
+  m_traceCursorEvent = NULL;
+  if ( m_lazyTraceLoading )
+  {
+    m_traceIndex.close();
+    if ( m_traceFormat == "xml" )
+      xmlCleanupParser();
+  }
+
+  // Report the memory use of the process before the trace image is unmapped
+  unsigned long privateBytes, sharedBytes;
+  if ( processMemory( privateBytes, sharedBytes ) )
+  {
+    ev << "    Private memory:    " << privateBytes << " bytes" << endl;
+    ev << "    Shared memory:     " << sharedBytes << " bytes" << endl;
+    recordScalar("factory.memory.private", privateBytes);
+    recordScalar("factory.memory.shared", sharedBytes);
+  }
+  m_traceImage.close();
+  m_useTraceImage = false;
+
+  if ( m_recyclePool != "" )
+  {
+    ev << "    Pool hits:       " << m_poolHits << endl;
+    ev << "    Pool misses:     " << m_poolMisses << endl;
+    ev << "    Pool discards:   " << m_poolDiscards << endl;
+    recordScalar("factory.pool.hits", m_poolHits);
+    recordScalar("factory.pool.misses", m_poolMisses);
+    recordScalar("factory.pool.discards", m_poolDiscards);
+    for ( poolIter = m_modulePools.begin(); poolIter != m_modulePools.end(); poolIter++ )
+    {
+      const MODULE_POOL &pool = poolIter->second;
+      string prefix = "factory.pool." + poolIter->first;
+      recordScalar((prefix + ".hits").c_str(), pool.hits);
+      recordScalar((prefix + ".misses").c_str(), pool.misses);
+      recordScalar((prefix + ".discards").c_str(), pool.discards);
+    }
+  }
 
   //
   // Some final reporting
@@ -114,6 +409,47 @@ void NodeFactory::finish()
   recordScalar("factory.created", m_generateCount );
   recordScalar("factory.destroyed", m_destroyedCount );
   recordScalar("factory.ave.lifetime", aveLifetime );  
+  if ( m_useRegion )
+  {
+    double duration = simTime();
+    ev << "    Region nodes:      " << regionNodes << " (" << m_materializedNodes << " materialized)" << endl;
+    ev << "    Materializations:  " << m_materializations << endl;
+    recordScalar("factory.region.virtual.max", m_maxVirtualNodes );
+    recordScalar("factory.region.virtual.mean", duration > 0.0 ? m_virtualNodeTime / duration : 0.0 );
+    recordScalar("factory.region.materialized.max", m_maxMaterializedNodes );
+    recordScalar("factory.region.materialized.mean", duration > 0.0 ? m_materializedNodeTime / duration : 0.0 );
+    recordScalar("factory.region.materializations", m_materializations );
+    recordScalar("factory.region.dematerializations", m_dematerializations );
+  }
+  ev << "    Create batches:    " << m_createBatches << " (" << m_batchedCreates << " nodes)" << endl;
+  recordScalar("factory.batch.count", m_createBatches );
+  recordScalar("factory.batch.nodes", m_batchedCreates );
+  if ( m_lazyTraceLoading )
+    recordScalar("factory.lazy.loads", m_lazyLoads );
+  if ( m_simplifyWaypoints )
+  {
+    ev << "    Waypoints removed: " << m_simplifiedWaypoints << endl;
+    recordScalar("factory.simplify.removed", m_simplifiedWaypoints );
+  }
+  if ( m_useTrajectoryService )
+  {
+    recordScalar("factory.trajectory.nodes", m_trajectories.nodes() );
+    recordScalar("factory.trajectory.segments", m_trajectories.segments() );
+    m_trajectories.clear();
+  }
+
+  double eventRate = runWallTime > 0.0 ? events / runWallTime : 0.0;
+  ev << "    Max alive nodes:   " << m_maxAliveNodes << endl;
+  ev << "    Max pending lists: " << m_maxPendingBytes << " bytes" << endl;
+  ev << "    Event rate:        " << eventRate << " events/s" << endl;
+  recordScalar("factory.alive.max", m_maxAliveNodes );
+  recordScalar("factory.pending.bytes.max", m_maxPendingBytes );
+  recordScalar("factory.event.rate", eventRate );
+  recordScalar("factory.time.read", m_readWallTime );
+  recordScalar("factory.time.create", m_createWallTime );
+  recordScalar("factory.time.destroy", m_destroyWallTime );
+  recordScalar("factory.time.run", runWallTime );
+  recordScalar("factory.time.finish", wallClock() - finishStart );
 }
 
 /**
@@ -125,13 +461,38 @@ void NodeFactory::finish()
  */
 void NodeFactory::handleMessage(cMessage *msg)
 {
-  if ( msg->kind() == CREATE_EVENT_KIND )
+  if ( msg == m_traceCursorEvent )
+  {
+    advanceTraceCursor();
+  }
+  else if ( msg == m_instrumentEvent )
+  {
+    _sampleInstrumentation();
+  }
+  else if ( msg == m_regionCheckEvent )
+  {
+    for ( unsigned int i=0; i < m_regionNodes.size(); i++ )
+      _updateRegionNode( m_regionNodes[i] );
+    if ( !m_regionNodes.empty() )
+      scheduleAt( simTime() + m_regionCheckInterval, m_regionCheckEvent );
+  }
+  else if ( msg->kind() == CREATE_BATCH_EVENT_KIND )
+  {
+    CreateBatchEvent *batch = check_and_cast<CreateBatchEvent*>(msg);
+    double start = wallClock();
+    createNodes(batch);
+    m_createWallTime += wallClock() - start;
+    delete msg;
+  }
+  else if ( msg->kind() == CREATE_EVENT_KIND )
   {      
     #ifdef __NODE_FACTORY_DEBUG__
     ev << fullPath() << ": Create event handled" << endl;
     #endif
     CreateEvent *te = check_and_cast<CreateEvent*>(msg);
+    double start = wallClock();
     createNode(te);
+    m_createWallTime += wallClock() - start;
     delete msg;
   }
   else if ( msg->kind() == DESTROY_EVENT_KIND )
@@ -141,7 +502,10 @@ void NodeFactory::handleMessage(cMessage *msg)
     #endif
     DestroyEvent *te = check_and_cast<DestroyEvent*>(msg);
     // Destroy node returns the number of nodes left to instantiate in the simulation.
-    if ( destroyNode(te) < 1 ) 
+    double start = wallClock();
+    int remaining = destroyNode(te);
+    m_destroyWallTime += wallClock() - start;
+    if ( remaining < 1 ) 
     {
       #ifdef __NODE_FACTORY_DEBUG__
       ev << fullPath() << ": Objectfactory terminating simulation. "
@@ -158,16 +522,58 @@ void NodeFactory::handleMessage(cMessage *msg)
 }
 
 void NodeFactory::createNode( CreateEvent *event )
+{
+  int nodeIndex = _acquireNodeRecords( event );
+  if ( nodeIndex >= 0 && _pendingBytes( nodeIndex ) > m_maxPendingBytes )
+    m_maxPendingBytes = _pendingBytes( nodeIndex );
+  // Trace mobility nodes are handled by the region of interest, if one is set
+  if ( m_useRegion && ( strcmp( event->getMobilityModel(), "" ) == 0 ||
+                        strcmp( event->getMobilityModel(), "TraceMobility" ) == 0 ) )
+    _createRegionNode( event, nodeIndex );
+  else
+    _buildNode( event, nodeIndex );
+  // Update the count of generated nodes. A region node counts once, however many
+  // times it is materialized.
+  m_generateCount++;
+}
+
+/**
+ * Get the records of a node ready in its pending lists when it is created. In lazy mode
+ * the records of the node are read from the trace file now. Returns the dense index of
+ * the node, or -1 if it has no records.
+ */
+int NodeFactory::_acquireNodeRecords( CreateEvent *event )
+{
+  int nodeIndex;
+  if ( m_lazyTraceLoading )
+    nodeIndex = _loadNodeTrace( event->getNodeID() );
+  else
+    nodeIndex = _findNode( event->getNodeID() );
+  if ( m_useTraceImage && nodeIndex >= 0 )
+    _loadImageRecords( nodeIndex );
+  if ( m_simplifyWaypoints && ( m_lazyTraceLoading || m_useTraceImage ) && nodeIndex >= 0 )
+  {
+    WaypointSimplifier simplifier( m_simplifyMaxError );
+    m_simplifiedWaypoints += simplifier.simplify( _pendingWaypointsLists[nodeIndex], simTime(),
+                                                  event->getX(), event->getY() );
+  }
+  return nodeIndex;
+}
+
+/**
+ * Build the module of a node and hand it the pending records of the node.
+ */
+NODE_HANDLE NodeFactory::_buildNode( CreateEvent *event, int nodeIndex )
 {
 	ev << fullPath() << ": Creating a dynamic scenario object" << endl;
 
 	// Get the module type object from the given class name
-	cModuleType *moduleType = findModuleType( event->getType() );
+	cModuleType *moduleType = _findModuleType( event->getType() );
 	if ( moduleType == NULL )
 	{
 		ev << fullPath() << ": The module type " << event->getType() << " is not found. "
 		                 << "Using default SimpleNode" << endl;
-		cModuleType *moduleType = findModuleType( "SimpleNode" );
+		moduleType = _findModuleType( "SimpleNode" );
 		if ( moduleType == NULL )
 		{
 		  error("Default node type not found");
@@ -181,18 +587,6 @@ void NodeFactory::createNode( CreateEvent *event )
   else
     sprintf( szModuleName, (const char *)event->getName() );	
 
-	// create module
-	cModule *module = moduleType->create( szModuleName, this->parentModule() );
-	ev << fullPath() << ": Creating module " << szModuleName << endl;
-
-	// Set the icon to use
-	char szDisplayString[100];
-	if ( event->getIconPath() == "" )
-  	sprintf( szDisplayString, "i=%s", "device/palm2_s" );
-  else
-    sprintf( szDisplayString, "i=%s", event->getIconPath() );
-	module->setDisplayString( szDisplayString );
-
   // Set the mobility module to use. Note that ContactTrace is included here although not
   // strictly a mobility module.
   string mobilityModel = "";
@@ -211,6 +605,28 @@ void NodeFactory::createNode( CreateEvent *event )
     error("Unspecified or unsupported trace");
   }
 
+	// Reuse a parked module of the same type if there is one, otherwise create a module
+	cModule *module = _takePooledModule( moduleType->name(), mobilityModel );
+	bool recycled = module != NULL;
+	if ( recycled )
+	{
+	  module->setName( szModuleName );
+	  ev << fullPath() << ": Recycling module " << szModuleName << endl;
+	}
+	else
+	{
+	  module = moduleType->create( szModuleName, this->parentModule() );
+	  ev << fullPath() << ": Creating module " << szModuleName << endl;
+	}
+
+	// Set the icon to use
+	char szDisplayString[100];
+	if ( event->getIconPath() == "" )
+  	sprintf( szDisplayString, "i=%s", "device/palm2_s" );
+  else
+    sprintf( szDisplayString, "i=%s", event->getIconPath() );
+	module->setDisplayString( szDisplayString );
+
 	// Set the object parameters. Parameters for submodules can be set in ini file.
 	if ( module->hasPar("x") )
 		module->par("x") = event->getX();
@@ -222,16 +638,28 @@ void NodeFactory::createNode( CreateEvent *event )
   if ( module->hasPar("mobilityModel") )
     module->par("mobilityModel") = mobilityModel.c_str();
 
-	// Call buildInside to create the module.
-	module->buildInside();
+  if ( recycled )
+  {
+    // The navigator parameters were copied from the node when it was built
+    cModule *navigator = module->submodule("navigator");
+    if ( navigator != NULL && navigator->hasPar("x") )
+      navigator->par("x") = event->getX();
+    if ( navigator != NULL && navigator->hasPar("y") )
+      navigator->par("y") = event->getY();
+  }
+  else
+  {
+	  // Call buildInside to create the module.
+	  module->buildInside();
 
-	// create activation message
-	module->scheduleStart( simTime() );
+	  // create activation message
+	  module->scheduleStart( simTime() );
+	}
 	module->callInitialize();
     
   // Populate the navigation modules of the created nodes with the cached events read from
-  // the initial trace file.
-  if ( mobilityModel == "TraceMobility" && _pendingWaypointsLists[event->getNodeID()].size() != 0 )
+  // the initial trace file. The navigator takes over the pending list without a copy.
+  if ( mobilityModel == "TraceMobility" && nodeIndex >= 0 && _pendingWaypointsLists[nodeIndex].size() != 0 )
   {
     #ifdef __NODE_FACTORY_DEBUG__
     ev << fullPath() << ": Starting to set move events in created navigator object" << endl;
@@ -239,13 +667,12 @@ void NodeFactory::createNode( CreateEvent *event )
     cModule *submodule = module->submodule("navigator");
     if ( submodule != NULL )
     {
-      waypointEventsList waypointList = _pendingWaypointsLists[event->getNodeID()];          
+      waypointEventsVector &pending = _pendingWaypointsLists[nodeIndex];
       TraceMobility *mobility = check_and_cast<TraceMobility*>(submodule);   
-      mobility->initializeTrace( &waypointList );
-      _pendingWaypointsLists.erase( event->getNodeID() ); 
+      mobility->initializeTrace( &pending );
     }
   }
-  else if ( mobilityModel == "ContactNotifier" && _pendingContactsLists[event->getNodeID()].size() != 0 )
+  else if ( mobilityModel == "ContactNotifier" && nodeIndex >= 0 && _pendingContactsLists[nodeIndex].size() != 0 )
   {
     #ifdef __NODE_FACTORY_DEBUG__
     ev << fullPath() << ": Starting to set contact events in created notifier object" << endl;
@@ -253,16 +680,17 @@ void NodeFactory::createNode( CreateEvent *event )
     cModule *submodule = module->submodule("navigator");
     if ( submodule != NULL )
     {
-      contactEventsList contactsList = _pendingContactsLists[event->getNodeID()];          
+      contactEventsVector &pending = _pendingContactsLists[nodeIndex];
       ContactNotifier *mobility = check_and_cast<ContactNotifier*>(submodule);   
-      mobility->initializeTrace( &contactsList );
-      _pendingContactsLists.erase( event->getNodeID() ); 
+      mobility->initializeTrace( &pending, event->getNodeID() );
     }
   }
   
   // Store the created module in our dynamic objects list.
 	NodeFactoryItem *item = new NodeFactoryItem( module, event->getNodeID(), simTime() );
-	m_createdItems.push_back( item );
+	NODE_HANDLE handle = m_createdItems.insert( item );
+  if ( m_createdItems.size() > m_maxAliveNodes )
+    m_maxAliveNodes = m_createdItems.size();
 
   #ifdef __NODE_FACTORY_DEBUG__
   ev << fullPath() << ": Creating and storing dynamic object " << szModuleName << " at " << simTime() << " s" << endl;
@@ -270,37 +698,58 @@ void NodeFactory::createNode( CreateEvent *event )
   ev << fullPath() << ": Total created objects are " << m_moduleCount << endl;
   #endif
   
-  // Update the count of generated modules
-  m_generateCount++;
+  return handle;
 }
 
 /**
- * Search through the createdItems list and destroy the node in our dynamic collection
- * whose id matches that of the DestroyEvent.
- *
- * @todo This search could be more elegant.
+ * Create the nodes of a batch of create events with the same time. The nodes are created
+ * in trace order, exactly as if each create event had been handled on its own.
+ */
+void NodeFactory::createNodes( CreateBatchEvent *batch )
+{
+  if ( m_lazyTraceLoading )
+  {
+    _loadBatchTraces( batch->events );
+    // The records of the whole batch are held until its nodes are built
+    unsigned long batchBytes = 0;
+    for ( unsigned int i=0; i < batch->events.size(); i++ )
+    {
+      int nodeIndex = _findNode( batch->events[i]->getNodeID() );
+      if ( nodeIndex >= 0 )
+        batchBytes += _pendingBytes( nodeIndex );
+    }
+    if ( batchBytes > m_maxPendingBytes )
+      m_maxPendingBytes = batchBytes;
+  }
+
+  for ( unsigned int i=0; i < batch->events.size(); i++ )
+  {
+    createNode( batch->events[i] );
+    delete batch->events[i];
+  }
+  m_createBatches++;
+  m_batchedCreates += batch->events.size();
+  batch->events.clear();
+}
+
+/**
+ * Look up the node in our dynamic collection whose id matches that of the DestroyEvent
+ * and destroy it. If several nodes with the id are alive, the oldest one is destroyed.
  */
 int NodeFactory::destroyNode( DestroyEvent *event )
 {
-  cModule *module;
-	NodeFactoryItem *item;
-  CREATED_ITEMS_VECTOR_TYPE::iterator iter;
-  for( iter = m_createdItems.begin(); iter != m_createdItems.end(); iter++ )
-	{
-		item = (*iter);
-    if ( item == NULL )
-      continue;
-		if ( item->getId() == event->getNodeID() )
-		{          
-		  m_totalLifetime += simTime() - item->getCreateTime();
-			module = item->getModule();
-      module->callFinish();
-      module->deleteModule();
-			delete item;
-      m_createdItems.erase(iter);
-      break;
-		}
+  if ( !_destroyRegionNode( event->getNodeID() ) )
+  {
+    NodeFactoryItem *item = m_createdItems.remove( m_createdItems.find( event->getNodeID() ) );
+    if ( item != NULL )
+    {
+      m_totalLifetime += simTime() - item->getCreateTime();
+      _teardownNode( item );
+    }
   }
+  // A node without contacts of its own may still be the peer of others in the index
+  if ( m_contactIndex != NULL )
+    m_contactIndex->removeNode( event->getNodeID() );
   m_destroyedCount++;
   
   // Return the number of node which are active or yet to be activated. 
@@ -308,383 +757,950 @@ int NodeFactory::destroyNode( DestroyEvent *event )
 }
 
 /**
- * Parse the XML trace file supplied at startup.
+ * Build the trajectory of each node life from its create command and waypoints. The 
+ * waypoints of a node go to its first life, as when the node is created.
+ */
+void NodeFactory::_buildTrajectoryService()
+{
+  if ( m_lazyTraceLoading || m_useTraceImage )
+    error("The trajectory service requires the waypoints in memory. Disable lazyTraceLoading and sharedTraceImage.");
+
+  set<int> createdNodes;
+  waypointEventsVector noWaypoints;
+  for ( unsigned long i=0; i < m_traceSchedule.size(); i++ )
+  {
+    TraceEvent *event = m_traceSchedule[i];
+    if ( event->kind() == CREATE_EVENT_KIND )
+    {
+      CreateEvent *createEvent = check_and_cast<CreateEvent*>(event);
+      int nodeId = createEvent->getNodeID();
+      int nodeIndex = _findNode( nodeId );
+      bool first = createdNodes.insert( nodeId ).second;
+      m_trajectories.addNode( nodeId, createEvent->getTime(), createEvent->getX(), createEvent->getY(),
+                              first && nodeIndex >= 0 ? _pendingWaypointsLists[nodeIndex] : noWaypoints );
+    }
+    else if ( event->kind() == DESTROY_EVENT_KIND )
+    {
+      DestroyEvent *destroyEvent = check_and_cast<DestroyEvent*>(event);
+      m_trajectories.destroyNode( destroyEvent->getNodeID(), destroyEvent->getTime() );
+    }
+  }
+  ev << "    Trajectories:    " << m_trajectories.nodes() << " nodes, " << m_trajectories.segments()
+     << " movements up to " << m_trajectories.horizon() << " s" << endl;
+}
+
+bool NodeFactory::positionAt( int nodeId, double time, double &x, double &y )
+{
+  Enter_Method_Silent();
+  if ( !m_useTrajectoryService )
+    error("The trajectory service is disabled. Set trajectoryService to query node locations.");
+  return m_trajectories.positionAt( nodeId, time, x, y );
+}
+
+void NodeFactory::positionsAt( double time, vector<NODE_POSITION> &positions )
+{
+  Enter_Method_Silent();
+  if ( !m_useTrajectoryService )
+    error("The trajectory service is disabled. Set trajectoryService to query node locations.");
+  m_trajectories.positionsAt( time, positions );
+}
+
+unsigned long NodeFactory::_pendingBytes( int nodeIndex ) const
+{
+  return _pendingWaypointsLists[nodeIndex].capacity() * sizeof(WAYPOINT) +
+         _pendingContactsLists[nodeIndex].capacity() * sizeof(CONTACT);
+}
+
+unsigned long NodeFactory::_pendingBytes() const
+{
+  unsigned long bytes = 0;
+  for ( unsigned int i=0; i < _pendingWaypointsLists.size(); i++ )
+    bytes += _pendingWaypointsLists[i].capacity() * sizeof(WAYPOINT);
+  for ( unsigned int i=0; i < _pendingContactsLists.size(); i++ )
+    bytes += _pendingContactsLists[i].capacity() * sizeof(CONTACT);
+  return bytes;
+}
+
+/**
+ * Record a sample of the instrumentation vectors. The event rate is that since the 
+ * previous sample. Samples are taken while nodes remain to be created or destroyed.
+ */
+void NodeFactory::_sampleInstrumentation()
+{
+  double now = wallClock();
+  long eventNumber = simulation.eventNumber();
+  if ( now > m_sampleWallTime )
+    m_eventRateVector.record( ( eventNumber - m_sampleEventNumber ) / ( now - m_sampleWallTime ) );
+  m_sampleWallTime = now;
+  m_sampleEventNumber = eventNumber;
+
+  m_aliveVector.record( m_createdItems.size() );
+  m_pendingBytesVector.record( _pendingBytes() );
+  unsigned long privateBytes, sharedBytes;
+  if ( processMemory( privateBytes, sharedBytes ) )
+    m_memoryVector.record( privateBytes );
+
+  if ( m_destroyedCount < m_initializedCount || m_createdItems.size() > 0 )
+    scheduleAt( simTime() + m_instrumentInterval, m_instrumentEvent );
+}
+
+void NodeFactory::_teardownNode( NodeFactoryItem *item )
+{
+  cModule *module = item->getModule();
+  module->callFinish();
+  if ( !_parkModule( module ) )
+    module->deleteModule();
+  delete item;
+}
+
+/**
+ * Parse the region of interest parameter, the corners of the region as "x1,y1,x2,y2".
+ * An empty parameter disables the region.
+ */
+bool NodeFactory::_parseRegion( const char *spec )
+{
+  string region = spec;
+  for ( string::size_type i=0; i < region.size(); i++ )
+    if ( region[i] == ',' )
+      region[i] = ' ';
+  char trailing;
+  int count = sscanf( region.c_str(), "%lf %lf %lf %lf %c", &m_regionX1, &m_regionY1, &m_regionX2, &m_regionY2, &trailing );
+  if ( count == EOF )
+  {
+    m_useRegion = false;
+    return true;
+  }
+  m_useRegion = true;
+  return count == 4 && m_regionX1 < m_regionX2 && m_regionY1 < m_regionY2;
+}
+
+/**
+ * Add a created node to the region nodes. The node starts out virtual, with only its 
+ * trajectory computed from its waypoints, and is materialized at once if it is created
+ * inside the region.
+ */
+void NodeFactory::_createRegionNode( CreateEvent *event, int nodeIndex )
+{
+  REGION_NODE *node = new REGION_NODE;
+  node->createEvent = new CreateEvent( *event );
+  node->createTime = simTime();
+  // The node keeps one module name for all its materializations
+  if ( strcmp( event->getName(), "" ) == 0 )
+  {
+    char szModuleName[100];
+    sprintf( szModuleName, "%s%.4lu", event->getPrefix(), ++m_moduleCount );
+    node->createEvent->setName( szModuleName );
+  }
+  if ( nodeIndex >= 0 )
+  {
+    node->trajectory.build( simTime(), event->getX(), event->getY(), _pendingWaypointsLists[nodeIndex] );
+    waypointEventsVector().swap( _pendingWaypointsLists[nodeIndex] );
+  }
+  else
+    node->trajectory.build( simTime(), event->getX(), event->getY(), waypointEventsVector() );
+  node->handle.slot = NODE_HANDLE_INVALID_SLOT;
+  node->handle.generation = 0;
+  node->position = m_regionNodes.size();
+
+  _updateRegionCounts();
+  m_regionNodes.push_back( node );
+  m_regionIndex.insert( std::make_pair( event->getNodeID(), node ) );
+  _updateRegionNode( node );
+  if ( !m_regionCheckEvent->isScheduled() )
+    scheduleAt( simTime() + m_regionCheckInterval, m_regionCheckEvent );
+}
+
+/**
+ * Materialize a virtual node inside the region at its present location, with the rest
+ * of its trajectory as waypoints. Dematerialize a materialized node outside the region.
+ */
+void NodeFactory::_updateRegionNode( REGION_NODE *node )
+{
+  double x, y;
+  node->trajectory.positionAt( simTime(), x, y );
+  bool inside = x >= m_regionX1 && x <= m_regionX2 && y >= m_regionY1 && y <= m_regionY2;
+  bool materialized = NodeSlotMap::isValid( node->handle );
+  if ( inside == materialized )
+    return;
+
+  _updateRegionCounts();
+  if ( inside )
+  {
+    int nodeIndex = _internNode( node->createEvent->getNodeID() );
+    node->trajectory.remainingWaypoints( simTime(), _pendingWaypointsLists[nodeIndex] );
+    node->createEvent->setX( x );
+    node->createEvent->setY( y );
+    node->handle = _buildNode( node->createEvent, nodeIndex );
+    m_materializedNodes++;
+    m_materializations++;
+  }
+  else
+  {
+    NodeFactoryItem *item = m_createdItems.remove( node->handle );
+    if ( item != NULL )
+      _teardownNode( item );
+    node->handle.slot = NODE_HANDLE_INVALID_SLOT;
+    m_materializedNodes--;
+    m_dematerializations++;
+  }
+}
+
+/**
+ * Remove the oldest region node with a node id, destroying its module if materialized.
+ */
+bool NodeFactory::_destroyRegionNode( int nodeId )
+{
+  REGION_NODE_MAP_TYPE::iterator iter = m_regionIndex.lower_bound( nodeId );
+  if ( iter == m_regionIndex.end() || iter->first != nodeId )
+    return false;
+  REGION_NODE *node = iter->second;
+  m_regionIndex.erase( iter );
+
+  _updateRegionCounts();
+  if ( NodeSlotMap::isValid( node->handle ) )
+  {
+    NodeFactoryItem *item = m_createdItems.remove( node->handle );
+    if ( item != NULL )
+      _teardownNode( item );
+    m_materializedNodes--;
+  }
+  m_totalLifetime += simTime() - node->createTime;
+
+  // Move the last region node into the place of the removed one
+  REGION_NODE *last = m_regionNodes.back();
+  m_regionNodes[node->position] = last;
+  last->position = node->position;
+  m_regionNodes.pop_back();
+  delete node->createEvent;
+  delete node;
+  return true;
+}
+
+/**
+ * Account for the node counts since the last update. Called before every change of
+ * the counts, and at the end of a run.
+ */
+void NodeFactory::_updateRegionCounts()
+{
+  unsigned long virtualNodes = m_regionNodes.size() - m_materializedNodes;
+  if ( virtualNodes > m_maxVirtualNodes )
+    m_maxVirtualNodes = virtualNodes;
+  if ( m_materializedNodes > m_maxMaterializedNodes )
+    m_maxMaterializedNodes = m_materializedNodes;
+  double elapsed = simTime() - m_regionCountTime;
+  m_virtualNodeTime += elapsed * virtualNodes;
+  m_materializedNodeTime += elapsed * m_materializedNodes;
+  m_regionCountTime = simTime();
+}
+
+cModule *NodeFactory::nodeModule( NODE_HANDLE handle ) const
+{
+  NodeFactoryItem *item = m_createdItems.get( handle );
+  return item != NULL ? item->getModule() : NULL;
+}
+
+/**
+ * Read the XML trace file supplied at startup. If a trace cache directory is set, the
+ * trace is read from its compiled cache entry if there is one. Otherwise the trace is
+ * parsed and the cache entry written as the records are read.
+ */
+void NodeFactory::readXmlTrace()
+{
+  if ( m_traceCacheDir == "" )
+  {
+    _parseXmlTrace( this, m_lazyTraceLoading );
+    return;
+  }
+
+  TraceCache cache( m_traceCacheDir.c_str(), m_traceCacheShared );
+  if ( !cache.lookup( m_traceFile.c_str(), m_scenarioSizeX, m_scenarioSizeY ) )
+    error( "%s", cache.lastError().c_str() );
+  ev << "    Cache entry:     " << cache.path() << ( cache.hit() ? " (hit)" : " (miss)" ) << endl;
+  recordScalar("factory.cache.hit", cache.hit() ? 1 : 0);
+
+  if ( cache.hit() )
+  {
+    cache.release();
+    readBinaryTrace( cache.path().c_str() );
+    return;
+  }
+
+  // All records are needed for the cache entry, also in lazy mode.
+  BinaryTraceWriter writer( BINARY_MOBILITY_TRACE );
+  TeeTraceSink sink( this, &writer );
+  _parseXmlTrace( &sink, false );
+  writer.setValidated( m_scenarioSizeX, m_scenarioSizeY );
+  writer.groupRecords();
+  if ( !cache.store( writer ) )
+    ev << fullPath() << ": Unable to store trace cache entry: " << cache.lastError() << endl;
+}
+
+/**
+ * Parse the XML trace file supplied at startup. Large traces are split on record
+ * boundaries and parsed on several threads. The records are passed to the sink
+ * in file order, whichever parser is used.
  *
  * @todo Add validation of creation, destroy and waypoint event times when parsed.
  *       Display warnings if times invalid.
  */
-void NodeFactory::readXmlTrace()
+void NodeFactory::_parseXmlTrace( TraceSink *sink, bool commandsOnly )
 {
-  xmlTextReaderPtr reader = xmlReaderForFile( m_traceFile.c_str(), NULL, 0 );
-  if ( reader == NULL )
+  bool ok;
+  string lastError;
+  if ( m_traceParserThreads == 1 )
   {
-    error("Unable to open config file");
+    XmlTraceParser parser( m_scenarioSizeX, m_scenarioSizeY );
+    ok = parser.parseFile( m_traceFile.c_str(), sink );
+    lastError = parser.lastError();
   }
   else
   {
-    const xmlChar *namestr;
-    int depth;
-    string name;
-    
-    int ret = xmlTextReaderRead(reader); 
-    while ( ret == 1)
-    {
-      namestr = xmlTextReaderConstName(reader);
-      depth = xmlTextReaderDepth(reader);
-      name = (const char *)namestr;
-      std::transform(name.begin(),name.end(),name.begin(),::tolower);
-      
-      if ( xmlTextReaderNodeType(reader) == 1 )
-      {
-        if ( xmlTextReaderDepth(reader) == 0 )
-        {
-          if ( name == "mobility-trace" )
-            readXmlMobilityTrace(reader);
-          else if ( name == "contact-trace" )
-            readXmlContactTrace(reader);
-        }
-      }
-      ret = xmlTextReaderRead(reader);
- 		}
+    ParallelTraceParser parser( m_scenarioSizeX, m_scenarioSizeY, m_traceParserThreads );
+    parser.setCommandsOnly( commandsOnly );
+    ok = parser.parseFile( m_traceFile.c_str(), sink );
+    lastError = parser.lastError();
+    m_parsedRecords += parser.skippedRecords();
+    ev << "    Parser chunks:   " << parser.chunks() << endl;
+    recordScalar("factory.parse.chunks", parser.chunks());
+  }
+  // The parser is still needed to load node records in lazy mode
+  if ( !m_lazyTraceLoading )
+    xmlCleanupParser();
+
+  if ( !ok )
+    error( "%s", lastError.c_str() );
+  m_loadedTraceFile = m_traceFile;
+  m_loadedTraceBinary = false;
+}
 
-		xmlCleanupParser();
-		xmlFreeTextReader(reader);
+void NodeFactory::beginTrace( TRACE_TYPE traceType, unsigned long nodesHint, unsigned long recordsHint )
+{
+  #ifdef __NODE_FACTORY_DEBUG__
+  ev << fullPath() << ": Reading " << ( traceType == ContactTrace ? "contact" : "mobility" ) 
+                   << " trace file" << endl;
+  #endif
+  m_traceType = traceType;
+  _reserveNodes( nodesHint, recordsHint );
+}
+
+void NodeFactory::addCommand( const TRACE_COMMAND &command )
+{
+  TraceEvent *curEvent;
+  if ( command.kind == CREATE_EVENT_KIND )
+  {
+    CreateEvent *createEvent = new CreateEvent();
+    createEvent->setX( command.x );
+    createEvent->setY( command.y );
+    createEvent->setType( command.type.c_str() );
+    createEvent->setName( command.name.c_str() );
+    createEvent->setPrefix( command.prefix.c_str() );
+    createEvent->setIconPath( command.icon.c_str() );
+    createEvent->setMobilityModel( command.mobilityModel.c_str() );
+    curEvent = createEvent;
+    m_initializedCount++;
   }
+  else
+  {
+    curEvent = new DestroyEvent();
+  }
+  curEvent->setKind( command.kind );
+  curEvent->setTime( command.time );
+  curEvent->setNodeID( command.nodeId );
+  _queueTraceEvent( curEvent );
+  m_parsedRecords++;
+}
+
+/**
+ * In lazy mode the waypoint has been validated by the parser but is not stored. It is 
+ * read again from the trace file when the node is created.
+ */
+void NodeFactory::addWaypoint( const WAYPOINT_EVENT &waypoint )
+{
+  if ( !m_lazyTraceLoading )
+    _pendingWaypointsLists[_internNode(waypoint.id)].push_back(waypointOf(waypoint));
+  m_parsedRecords++;
 }
 
-void NodeFactory::readXmlMobilityTrace( xmlTextReaderPtr reader )
+void NodeFactory::addContact( const CONTACT_EVENT &contact )
+{
+  if ( !m_lazyTraceLoading )
+    _pendingContactsLists[_internNode(contact.id)].push_back(contactOf(contact));
+  m_parsedRecords++;
+}
+
+/**
+ * Read a trace in a foreign mobility format, streamed straight into the node lists by 
+ * the trace source of the format. UDel samples are merged into linear segments within 
+ * the trace tolerance, see UdelTraceParser.
+ */
+void NodeFactory::readSourceTrace()
+{
+  TraceSource *source = TraceSource::create( m_traceFormat, m_scenarioSizeX, m_scenarioSizeY, m_traceTolerance );
+  if ( source == NULL )
+    error("Unknown trace format %s. Use xml, binary, udel, ns2, bonnmotion or one.", m_traceFormat.c_str());
+  if ( !source->parseFile( m_traceFile.c_str(), this ) )
+  {
+    std::string message = source->lastError();
+    delete source;
+    error( "%s", message.c_str() );
+  }
+
+  if ( m_traceFormat == "udel" )
+    ev << "    Trace tolerance: " << m_traceTolerance << " m" << endl;
+  ev << "    Source samples:  " << source->samples() << endl;
+  ev << "    Waypoints made:  " << source->waypoints() << endl;
+  recordScalar("factory.source.samples", source->samples());
+  recordScalar("factory.source.waypoints", source->waypoints());
+  delete source;
+  m_loadedTraceFile = m_traceFile;
+  m_loadedTraceBinary = false;
+}
+
+/**
+ * Read a binary trace file. The file is memory mapped and the fixed width records
+ * read in place. Create and destroy commands are scheduled in file order, and the 
+ * waypoint and contact records are appended to the pending lists exactly as the 
+ * XML readers do, so both formats result in identical runs.
+ *
+ * In lazy mode only the commands are read. The waypoint and contact records are read
+ * and validated when their node is created.
+ *
+ * With a shared trace image the waypoints and contacts of a trace grouped by node are
+ * not copied. They are read from the mapped file, which is shared by all processes
+ * using the same trace, when their node is created.
+ */
+void NodeFactory::readBinaryTrace( const char *filename )
 {
   #ifdef __NODE_FACTORY_DEBUG__
-  ev << fullPath() << ": Reading mobility trace file" << endl;
+  ev << fullPath() << ": Reading binary trace file" << endl;
   #endif
- 
-  m_traceType = MobilityTrace;
-  
-  const xmlChar *namestr;
-  const xmlChar *value;
-  const char* valueStr;
-
-  int curEventKind = NO_EVENT_KIND;
-  TraceEvent *curEvent = NULL;
-  WAYPOINT_EVENT curWaypointEvent;
-  string curValueLbl;    
-  string curSubValueLbl;
-  string ccurSubValueLbl;
-  int depth;
-  double x,y;
-
-  string name, cname;
-
-  int ret = xmlTextReaderRead(reader); 
-  while ( ret == 1)
-  {
-    namestr = xmlTextReaderConstName(reader);
-    depth = xmlTextReaderDepth(reader);
-    
-    cname = (const char *)namestr;
-    name = cname;
-    std::transform(name.begin(),name.end(),name.begin(),::tolower);
-    	        		  
-    if ( xmlTextReaderNodeType(reader) == 1 )
+
+  BinaryTraceReader reader;
+  if ( !reader.open( filename ) )
+    error("Unable to read binary trace file %s: %s", filename, reader.lastError().c_str());
+  m_loadedTraceFile = filename;
+  m_loadedTraceBinary = true;
+
+  const BINARY_TRACE_HEADER *header = reader.header();
+  if ( header->traceType == BINARY_MOBILITY_TRACE )
+    m_traceType = MobilityTrace;
+  else if ( header->traceType == BINARY_CONTACT_TRACE )
+    m_traceType = ContactTrace;
+  else
+    error("Unspecified or unsupported trace");
+
+  ev << "    Nodes in trace:  " << header->nodeCount << endl;
+  ev << "    Trace period:    " << header->startTime << " - " << header->endTime << " s" << endl;
+  ev << "    Pre-validated:   " << ( _binaryTraceValidated( header ) ? "yes" : "no" ) << endl;
+
+  if ( m_lazyTraceLoading )
+  {
+    _readBinaryCommands( reader );
+    m_parsedRecords += header->waypointCount + header->contactCount;
+    return;
+  }
+
+  if ( m_sharedTraceImage )
+  {
+    if ( header->flags & BINARY_TRACE_GROUPED )
     {
-      if ( xmlTextReaderDepth(reader) == 1 )
-      {
-        // Handle element
-        if ( name == "create" )
-        {
-          #ifdef __NODE_FACTORY_DEBUG__
-          ev << "  CREATE" << endl;
-          #endif
-          curEvent = new CreateEvent();
-          curEvent->setKind(CREATE_EVENT_KIND);
-          curEventKind = CREATE_EVENT_KIND;
-        }
-        else if ( name == "destroy" )          
-        {
-          #ifdef __NODE_FACTORY_DEBUG__
-          ev << "  DESTROY" << endl;
-          #endif 
-          curEvent = new DestroyEvent();
-          curEvent->setKind(DESTROY_EVENT_KIND);
-          curEventKind = DESTROY_EVENT_KIND;
-        }
-        else if ( name == "waypoint" )
-        {
-          #ifdef __NODE_FACTORY_DEBUG__
-          ev << "  WAYPOINT" << endl;
-          #endif
-          curEventKind = WAYPOINT_EVENT_KIND;
-          curWaypointEvent.id = -1;
-          curWaypointEvent.time = 0.0;
-          curWaypointEvent.x = 0.0;
-          curWaypointEvent.y = 0.0;
-          curWaypointEvent.speed = 0.0;
-        }
-      }
-      else if ( xmlTextReaderDepth(reader) == 2 )
-      {
-        curValueLbl = name;          
-      }
-      else if ( xmlTextReaderDepth(reader) == 3 )
-      {
-        curSubValueLbl = name; 
-        ccurSubValueLbl = cname;   
-      }
+      if ( !m_traceImage.open( filename ) )
+        error("Unable to map trace image %s: %s", filename, m_traceImage.lastError().c_str());
+      _readBinaryCommands( reader );
+      _mapTraceImage();
+      return;
     }
-    if ( xmlTextReaderNodeType(reader) == 15 )
+    ev << "    Trace image:     not grouped by node, using private lists" << endl;
+  }
+
+  // Intern the node ids and count the records of each node in a first pass over the
+  // mapped records, so that the per-node lists can be allocated at their final size.
+  _reserveNodes( header->nodeCount, 0 );
+  vector<unsigned long> recordCounts;
+  const BINARY_WAYPOINT_RECORD *waypoint = reader.waypoints();
+  for ( uint32_t i=0; i < header->waypointCount; i++, waypoint++ )
+  {
+    unsigned int index = _internNode( waypoint->nodeId );
+    if ( index >= recordCounts.size() )
+      recordCounts.resize( index+1, 0 );
+    recordCounts[index]++;
+  }
+  const BINARY_CONTACT_RECORD *contact = reader.contacts();
+  for ( uint32_t i=0; i < header->contactCount; i++, contact++ )
+  {
+    unsigned int index = _internNode( contact->nodeId );
+    if ( index >= recordCounts.size() )
+      recordCounts.resize( index+1, 0 );
+    recordCounts[index]++;
+  }
+  for ( unsigned int i=0; i < recordCounts.size(); i++ )
+  {
+    if ( header->waypointCount > 0 )
+      _pendingWaypointsLists[i].reserve( recordCounts[i] );
+    if ( header->contactCount > 0 )
+      _pendingContactsLists[i].reserve( recordCounts[i] );
+  }
+
+  _readBinaryCommands( reader );
+
+  // Locations of compiled traces were validated when the trace was compiled
+  bool validated = _binaryTraceValidated( header );
+  WAYPOINT curWaypointEvent;
+  waypoint = reader.waypoints();
+  for ( uint32_t i=0; i < header->waypointCount; i++, waypoint++ )
+  {
+    curWaypointEvent.time = waypoint->time;
+    curWaypointEvent.x = validated || _validateLocation( waypoint->x, xCoordinate ) ? waypoint->x : 0.0;
+    curWaypointEvent.y = validated || _validateLocation( waypoint->y, yCoordinate ) ? waypoint->y : 0.0;
+    curWaypointEvent.speed = waypoint->speed;
+    _pendingWaypointsLists[_internNode(waypoint->nodeId)].push_back(curWaypointEvent);
+  }
+  m_parsedRecords += header->waypointCount;
+
+  CONTACT curContactEvent;
+  contact = reader.contacts();
+  for ( uint32_t i=0; i < header->contactCount; i++, contact++ )
+  {
+    curContactEvent.type = (ContactEventType)contact->type;
+    curContactEvent.time = contact->time;
+    curContactEvent.peerId = contact->peerId;
+    _pendingContactsLists[_internNode(contact->nodeId)].push_back(curContactEvent);
+  }
+  m_parsedRecords += header->contactCount;
+}
+
+/**
+ * Find the range of records of each node in the trace image and validate the locations
+ * of the waypoints, unless the trace is already validated.
+ */
+void NodeFactory::_mapTraceImage()
+{
+  const BINARY_TRACE_HEADER *header = m_traceImage.header();
+  bool validated = _binaryTraceValidated( header );
+  _reserveNodes( header->nodeCount, 0 );
+
+  TRACE_IMAGE_RANGE range;
+  int nodeId = 0;
+  range.first = 0;
+  range.count = 0;
+  const BINARY_WAYPOINT_RECORD *waypoint = m_traceImage.waypoints();
+  const BINARY_CONTACT_RECORD *contact = m_traceImage.contacts();
+  uint32_t records = m_traceType == ContactTrace ? header->contactCount : header->waypointCount;
+  for ( uint32_t i=0; i <= records; i++ )
+  {
+    int recordNodeId = 0;
+    if ( i < records )
+      recordNodeId = m_traceType == ContactTrace ? contact[i].nodeId : waypoint[i].nodeId;
+    if ( range.count > 0 && ( i == records || recordNodeId != nodeId ) )
     {
-      // Handle end element
-      if ( depth == 1 )
+      unsigned int index = _internNode( nodeId );
+      if ( index >= m_imageRanges.size() )
       {
-        if ( curEventKind == CREATE_EVENT_KIND )
-          m_initializedCount++;
-          
-        if ( curEventKind == CREATE_EVENT_KIND || curEventKind == DESTROY_EVENT_KIND )
-        {
-          scheduleAt(curEvent->getTime(), curEvent);
-          curEventKind = NO_EVENT_KIND;
-        }
-        else if ( curEventKind == WAYPOINT_EVENT_KIND )
-        {
-          waypointEventsList el;
-          if(_pendingWaypointsLists.count(curWaypointEvent.id) != 0)
-            el = _pendingWaypointsLists[curWaypointEvent.id];                            
-          el.push_back(curWaypointEvent);
-          _pendingWaypointsLists[curWaypointEvent.id] = el;                            
-          curEventKind = NO_EVENT_KIND;
-        }
+        TRACE_IMAGE_RANGE empty;
+        empty.first = 0;
+        empty.count = 0;
+        m_imageRanges.resize( index+1, empty );
       }
+      if ( m_imageRanges[index].count != 0 )
+        error("Binary trace %s is not grouped by node", m_loadedTraceFile.c_str());
+      m_imageRanges[index] = range;
+      range.count = 0;
     }
-    if ( xmlTextReaderNodeType(reader) == 3 )
+    if ( i == records )
+      break;
+    if ( range.count == 0 )
     {
-      // Handle a value. Use the curValueLbl and curSubValueLbl to
-      // identify the property which the value corresponds to.
-  	  if ( xmlTextReaderHasValue(reader) )
-      {
-  			value = xmlTextReaderConstValue(reader);
-        valueStr = (const char *)value;       
-        #ifdef __NODE_FACTORY_DEBUG__  
-        ev << "    " << curValueLbl << " = " << value << endl;
-        #endif
-      }
-                                      
-      if ( curEventKind == CREATE_EVENT_KIND )
-      {
-        if ( curValueLbl == "time" )
-          curEvent->setTime( atof(valueStr) );          
-        else if ( curValueLbl == "nodeid" )
-          curEvent->setNodeID( atoi(valueStr) );           
-        else if ( curValueLbl == "type" )
-          ((CreateEvent*)curEvent)->setType( valueStr );
-        else if ( curValueLbl == "name" )
-          ((CreateEvent*)curEvent)->setName( valueStr );
-        else if ( curValueLbl == "prefix" )
-          ((CreateEvent*)curEvent)->setPrefix( valueStr );
-        else if ( curValueLbl == "icon" )
-          ((CreateEvent*)curEvent)->setIconPath( valueStr );            
-        else if ( curValueLbl == "mobilitymodel" )
-          ((CreateEvent*)curEvent)->setMobilityModel( valueStr ); 
-        else if ( curValueLbl == "location" && curSubValueLbl == "xpos" )
-        {
-          if ( _validateLocation( atof(valueStr), xCoordinate ) )
-            ((CreateEvent*)curEvent)->setX( atof(valueStr) );                                
-        }
-        else if ( curValueLbl == "location" && curSubValueLbl == "ypos" )
-        {
-          if ( _validateLocation( atof(valueStr), yCoordinate ) )
-            ((CreateEvent*)curEvent)->setY( atof(valueStr) );                                
-        }
-      }
-      else if ( curEventKind == DESTROY_EVENT_KIND )
-      {
-        if ( curValueLbl == "time" )
-          curEvent->setTime( atof(valueStr) );          
-        else if ( curValueLbl == "nodeid" )
-          curEvent->setNodeID( atoi(valueStr) );           
-      }
-      else if ( curEventKind == WAYPOINT_EVENT_KIND )
-      {
-        if ( curValueLbl == "time" )
-          curWaypointEvent.time = atof(valueStr);          
-        else if ( curValueLbl == "nodeid" )
-          curWaypointEvent.id = atoi(valueStr);           
-        else if ( curValueLbl == "speed" )
-          curWaypointEvent.speed = atof(valueStr);
-        else if ( curValueLbl == "destination" && curSubValueLbl == "xpos" )
-        {
-          if ( _validateLocation( atof(valueStr), xCoordinate ) )
-            curWaypointEvent.x = atof(valueStr);                                
-        }
-        else if ( curValueLbl == "destination" && curSubValueLbl == "ypos" )
-        {
-          if ( _validateLocation( atof(valueStr), yCoordinate ) )
-            curWaypointEvent.y = atof(valueStr);  
-        }
-      }
-    } 	    		  
-    
-    ret = xmlTextReaderRead(reader);
+      nodeId = recordNodeId;
+      range.first = i;
+    }
+    range.count++;
+    if ( m_traceType == MobilityTrace && !validated )
+    {
+      _validateLocation( waypoint[i].x, xCoordinate );
+      _validateLocation( waypoint[i].y, yCoordinate );
+    }
   }
+  m_parsedRecords += header->waypointCount + header->contactCount;
+  m_useTraceImage = true;
+
+  // Nodes are created in no particular order
+  madvise( (void *)header, m_traceImage.size(), MADV_RANDOM );
+  ev << "    Trace image:     " << m_traceImage.size() << " bytes, shared" << endl;
+  recordScalar("factory.image.bytes", m_traceImage.size());
 }
 
-void NodeFactory::readXmlContactTrace( xmlTextReaderPtr reader )
+/**
+ * Copy the records of a node from the trace image to its pending list. The records
+ * are only handed out once, as with the pending lists.
+ */
+void NodeFactory::_loadImageRecords( int nodeIndex )
 {
-  #ifdef __NODE_FACTORY_DEBUG__
-  ev << fullPath() << ": Reading contact trace file" << endl;
-  #endif
+  if ( (unsigned int)nodeIndex >= m_imageRanges.size() || m_imageRanges[nodeIndex].count == 0 )
+    return;
+  TRACE_IMAGE_RANGE &range = m_imageRanges[nodeIndex];
+  if ( m_traceType == ContactTrace )
+  {
+    contactEventsVector &pending = _pendingContactsLists[nodeIndex];
+    pending.resize( range.count );
+    const BINARY_CONTACT_RECORD *contact = m_traceImage.contacts() + range.first;
+    for ( uint32_t i=0; i < range.count; i++, contact++ )
+    {
+      pending[i].type = (ContactEventType)contact->type;
+      pending[i].time = contact->time;
+      pending[i].peerId = contact->peerId;
+    }
+  }
+  else
+  {
+    waypointEventsVector &pending = _pendingWaypointsLists[nodeIndex];
+    pending.resize( range.count );
+    const BINARY_WAYPOINT_RECORD *waypoint = m_traceImage.waypoints() + range.first;
+    for ( uint32_t i=0; i < range.count; i++, waypoint++ )
+    {
+      pending[i].time = waypoint->time;
+      pending[i].x = waypoint->x;
+      pending[i].y = waypoint->y;
+      pending[i].speed = waypoint->speed;
+    }
+  }
+  range.count = 0;
+}
 
-  m_traceType = ContactTrace;
-  
-  const xmlChar *namestr;
-  const xmlChar *value;
-  const char* valueStr;
-
-  int curEventKind = NO_EVENT_KIND;
-  TraceEvent *curEvent = NULL;
-  CONTACT_EVENT curContactEvent;
-  string curValueLbl;    
-  string curSubValueLbl;
-  string ccurSubValueLbl;
-  int depth;
-  double x,y;
-
-  string name, cname;
-
-  int ret = xmlTextReaderRead(reader); 
-  while ( ret == 1)
-  {
-    namestr = xmlTextReaderConstName(reader);
-    depth = xmlTextReaderDepth(reader);
-    
-    cname = (const char *)namestr;
-    name = cname;
-    std::transform(name.begin(),name.end(),name.begin(),::tolower);
-    	        		  
-    if ( xmlTextReaderNodeType(reader) == 1 )
+void NodeFactory::_readBinaryCommands( BinaryTraceReader &reader )
+{
+  const BINARY_TRACE_HEADER *header = reader.header();
+  bool validated = _binaryTraceValidated( header );
+  const BINARY_COMMAND_RECORD *command = reader.commands();
+  for ( uint32_t i=0; i < header->commandCount; i++, command++ )
+  {
+    TraceEvent *curEvent = NULL;
+    if ( command->kind == CREATE_EVENT_KIND )
     {
-      if ( xmlTextReaderDepth(reader) == 1 )
-      {
-        // Handle element
-        if ( name == "create" )
-        {
-          curEvent = new CreateEvent();
-          curEvent->setKind(CREATE_EVENT_KIND);
-          curEventKind = CREATE_EVENT_KIND;
-        }
-        else if ( name == "destroy" )          
-        {
-          curEvent = new DestroyEvent();
-          curEvent->setKind(DESTROY_EVENT_KIND);
-          curEventKind = DESTROY_EVENT_KIND;
-        }
-        else if ( name == "contact" )
-        {
-          curEventKind = CONTACT_EVENT_KIND;
-          curContactEvent.type = Contact;
-          curContactEvent.time = 0.0;
-          curContactEvent.id = -1;
-          curContactEvent.peerId = -1;
-        }
-        else if ( name == "break" )
-        {
-          curEventKind = CONTACT_EVENT_KIND;
-          curContactEvent.type = Break;
-          curContactEvent.time = 0.0;
-          curContactEvent.id = -1;
-          curContactEvent.peerId = -1;
-        }
-      }
-      else if ( xmlTextReaderDepth(reader) == 2 )
-      {
-        curValueLbl = name;          
-      }
-      else if ( xmlTextReaderDepth(reader) == 3 )
-      {
-        curSubValueLbl = name; 
-        ccurSubValueLbl = cname;   
-      }
+      CreateEvent *createEvent = new CreateEvent();
+      if ( validated || _validateLocation( command->x, xCoordinate ) )
+        createEvent->setX( command->x );
+      if ( validated || _validateLocation( command->y, yCoordinate ) )
+        createEvent->setY( command->y );
+      createEvent->setType( reader.string(command->type) );
+      createEvent->setName( reader.string(command->name) );
+      createEvent->setPrefix( reader.string(command->prefix) );
+      createEvent->setIconPath( reader.string(command->icon) );
+      if ( m_traceType == MobilityTrace )
+        createEvent->setMobilityModel( reader.string(command->mobilityModel) );
+      curEvent = createEvent;
+      m_initializedCount++;
     }
-    if ( xmlTextReaderNodeType(reader) == 15 )
+    else if ( command->kind == DESTROY_EVENT_KIND )
     {
-      // Handle end element      
-      if ( depth == 1 )
-      {
-        if ( curEventKind == CREATE_EVENT_KIND )
-          m_initializedCount++;
-          
-        if ( curEventKind == CREATE_EVENT_KIND || curEventKind == DESTROY_EVENT_KIND )
-        {
-          scheduleAt(curEvent->getTime(), curEvent);
-          curEventKind = NO_EVENT_KIND;
-        }
-        else if ( curEventKind == CONTACT_EVENT_KIND )
-        {
-          contactEventsList el;
-          if(_pendingContactsLists.count(curContactEvent.id) != 0)
-            el = _pendingContactsLists[curContactEvent.id];                            
-          el.push_back(curContactEvent);
-          _pendingContactsLists[curContactEvent.id] = el;
-          curEventKind = NO_EVENT_KIND;
-        }
-      }
+      curEvent = new DestroyEvent();
     }
-    if ( xmlTextReaderNodeType(reader) == 3 )
+    else
     {
-      // Handle value. Use curValueLbl and curSubValueLbl to assign values
-      // parsed to the correct attribute.
-  	  if ( xmlTextReaderHasValue(reader) )
-      {
-  			value = xmlTextReaderConstValue(reader);
-        valueStr = (const char *)value;         
-      }
-                                      
-      if ( curEventKind == CREATE_EVENT_KIND )
-      {
-        if ( curValueLbl == "time" )
-          curEvent->setTime( atof(valueStr) );          
-        else if ( curValueLbl == "nodeid" )
-          curEvent->setNodeID( atoi(valueStr) );           
-        else if ( curValueLbl == "type" )
-          ((CreateEvent*)curEvent)->setType( valueStr );
-        else if ( curValueLbl == "name" )
-          ((CreateEvent*)curEvent)->setName( valueStr );
-        else if ( curValueLbl == "prefix" )
-          ((CreateEvent*)curEvent)->setPrefix( valueStr );
-        else if ( curValueLbl == "icon" )
-          ((CreateEvent*)curEvent)->setIconPath( valueStr );            
-        else if ( curValueLbl == "location" && curSubValueLbl == "xpos" )
-        {
-          if ( _validateLocation( atof(valueStr), xCoordinate ) )
-            ((CreateEvent*)curEvent)->setX( atof(valueStr) );                                
-        }
-        else if ( curValueLbl == "location" && curSubValueLbl == "ypos" )
-        {
-          if ( _validateLocation( atof(valueStr), yCoordinate ) )
-            ((CreateEvent*)curEvent)->setY( atof(valueStr) );                                
-        } 
-      }
-      else if ( curEventKind == DESTROY_EVENT_KIND )
-      {
-        if ( curValueLbl == "time" )
-          curEvent->setTime( atof(valueStr) );          
-        else if ( curValueLbl == "nodeid" )
-          curEvent->setNodeID( atoi(valueStr) );           
-      }
-      else if ( curEventKind == CONTACT_EVENT_KIND )
+      error("Invalid command record in binary trace file");
+    }
+    curEvent->setKind( command->kind );
+    curEvent->setTime( command->time );
+    curEvent->setNodeID( command->nodeId );
+    _queueTraceEvent( curEvent );
+  }
+  m_parsedRecords += header->commandCount;
+}
+
+/**
+ * Create and destroy events are not inserted into the future event set when the trace
+ * is read. They are kept in the time ordered trace schedule and handed to the simulation
+ * kernel a window at a time, which keeps the future event set small for long traces.
+ *
+ * The cursor schedules every pending event due before the end of the lookahead window 
+ * and then sleeps until the window preceding the next pending event. The cursor and the
+ * trace events have a higher priority than all other events, and trace events are 
+ * scheduled in trace order. Events with equal times are thus handled in the same order 
+ * as when the whole trace was scheduled at initialization.
+ */
+void NodeFactory::advanceTraceCursor()
+{
+  // The window includes its end, the time of the event the cursor was woken for
+  double windowEnd = simTime() + m_traceLookahead;
+  while ( m_traceCursor < m_traceSchedule.size() && 
+          m_traceSchedule[m_traceCursor]->getTime() <= windowEnd )
+  {
+    TraceEvent *event = m_traceSchedule[m_traceCursor];
+    m_traceSchedule[m_traceCursor++] = NULL;
+
+    // Adjacent create events with the same time are handled as a single batch
+    if ( event->kind() == CREATE_EVENT_KIND && m_traceCursor < m_traceSchedule.size() &&
+         m_traceSchedule[m_traceCursor]->kind() == CREATE_EVENT_KIND &&
+         m_traceSchedule[m_traceCursor]->getTime() == event->getTime() )
+    {
+      CreateBatchEvent *batch = new CreateBatchEvent();
+      batch->setPriority(TRACE_EVENT_PRIORITY);
+      batch->events.push_back( check_and_cast<CreateEvent*>(event) );
+      while ( m_traceCursor < m_traceSchedule.size() &&
+              m_traceSchedule[m_traceCursor]->kind() == CREATE_EVENT_KIND &&
+              m_traceSchedule[m_traceCursor]->getTime() == event->getTime() )
       {
-        if ( curValueLbl == "time" )
-          curContactEvent.time = atof(valueStr);          
-        else if ( curValueLbl == "nodeid" )
-          curContactEvent.id = atoi(valueStr);           
-        else if ( curValueLbl == "peerid" )
-          curContactEvent.peerId = atoi(valueStr);
+        batch->events.push_back( check_and_cast<CreateEvent*>(m_traceSchedule[m_traceCursor]) );
+        m_traceSchedule[m_traceCursor++] = NULL;
       }
-    } 	
-    		      
-    ret = xmlTextReaderRead(reader);
-  }  
+      scheduleAt( event->getTime(), batch );
+      continue;
+    }
+    scheduleAt( event->getTime(), event );
+  }
+
+  if ( m_traceCursor < m_traceSchedule.size() )
+  {
+    double nextTime = m_traceSchedule[m_traceCursor]->getTime() - m_traceLookahead;
+    if ( nextTime < windowEnd )
+      nextTime = windowEnd;
+    scheduleAt( nextTime, m_traceCursorEvent );
+  }
+  else
+  {
+    // All events have been scheduled. Release the schedule storage.
+    TRACE_SCHEDULE_VECTOR_TYPE().swap(m_traceSchedule);
+    m_traceCursor = 0;
+  }
+}
+
+/**
+ * Simplify the pending waypoints of every node. The movements of a node start from the
+ * location of its first create command, which is the first one in the time ordered
+ * trace schedule.
+ */
+void NodeFactory::_simplifyPendingWaypoints()
+{
+  WaypointSimplifier simplifier( m_simplifyMaxError );
+  vector<bool> simplified( m_nodeIds.size(), false );
+  for ( unsigned long i=m_traceCursor; i < m_traceSchedule.size(); i++ )
+  {
+    if ( m_traceSchedule[i]->kind() != CREATE_EVENT_KIND )
+      continue;
+    CreateEvent *createEvent = check_and_cast<CreateEvent*>( m_traceSchedule[i] );
+    int index = _findNode( createEvent->getNodeID() );
+    if ( index < 0 || simplified[index] )
+      continue;
+    simplified[index] = true;
+    m_simplifiedWaypoints += simplifier.simplify( _pendingWaypointsLists[index], createEvent->getTime(),
+                                                  createEvent->getX(), createEvent->getY() );
+  }
+  ev << "    Simplified:      " << m_simplifiedWaypoints << " waypoints removed" << endl;
+}
+
+int NodeFactory::_internNode( int nodeId )
+{
+  if ( nodeId == m_lastNodeId )
+    return m_lastNodeIndex;
+
+  NODE_INDEX_MAP_TYPE::iterator iter = m_nodeIndex.find( nodeId );
+  int index;
+  if ( iter != m_nodeIndex.end() )
+  {
+    index = iter->second;
+  }
+  else
+  {
+    index = m_nodeIds.size();
+    m_nodeIndex.insert( std::make_pair( nodeId, index ) );
+    m_nodeIds.push_back( nodeId );
+    _pendingWaypointsLists.resize( index+1 );
+    _pendingContactsLists.resize( index+1 );
+    if ( m_recordsPerNodeHint > 0 )
+    {
+      if ( m_traceType == ContactTrace )
+        _pendingContactsLists[index].reserve( m_recordsPerNodeHint );
+      else
+        _pendingWaypointsLists[index].reserve( m_recordsPerNodeHint );
+    }
+  }
+  m_lastNodeId = nodeId;
+  m_lastNodeIndex = index;
+  return index;
+}
+
+cModuleType *NodeFactory::_findModuleType( const char *name )
+{
+  map<string,cModuleType*>::iterator iter = m_moduleTypes.find( name );
+  if ( iter != m_moduleTypes.end() )
+    return iter->second;
+  cModuleType *moduleType = findModuleType( name );
+  m_moduleTypes[name] = moduleType;
+  return moduleType;
+}
+
+/**
+ * Load the records of the nodes of a create batch in lazy mode. The records of all nodes
+ * not loaded before are read with one pass over the trace index, which parses the XML
+ * records of the whole batch as one document. createNode() then finds them loaded.
+ */
+void NodeFactory::_loadBatchTraces( const vector<CreateEvent*> &events )
+{
+  vector<int> nodeIds;
+  for ( unsigned int i=0; i < events.size(); i++ )
+  {
+    int index = _internNode( events[i]->getNodeID() );
+    if ( (unsigned int)index >= m_nodeTraceLoaded.size() )
+      m_nodeTraceLoaded.resize( index+1, false );
+    if ( m_nodeTraceLoaded[index] )
+      continue;
+    m_nodeTraceLoaded[index] = true;
+    nodeIds.push_back( events[i]->getNodeID() );
+  }
+  if ( nodeIds.empty() )
+    return;
+
+  BufferedTraceSink records;
+  if ( !m_traceIndex.loadNodes( nodeIds, &records, m_scenarioSizeX, m_scenarioSizeY ) )
+    error( "%s", m_traceIndex.lastError().c_str() );
+  for ( unsigned long i=0; i < records.waypoints.size(); i++ )
+    _pendingWaypointsLists[_internNode(records.waypoints[i].id)].push_back( waypointOf( records.waypoints[i] ) );
+  for ( unsigned long i=0; i < records.contacts.size(); i++ )
+    _pendingContactsLists[_internNode(records.contacts[i].id)].push_back( contactOf( records.contacts[i] ) );
+  m_lazyLoads += nodeIds.size();
+}
+
+/**
+ * Parse the recycle pool parameter, a list of node types and the number of modules of
+ * each type kept for reuse, e.g. "SimpleNode=100,SimpleContactNode=50".
+ */
+bool NodeFactory::_parseRecyclePool( const char *spec )
+{
+  m_poolCapacity.clear();
+  string entry;
+  for ( const char *p = spec; ; p++ )
+  {
+    if ( *p != ',' && *p != ' ' && *p != '\0' )
+    {
+      entry += *p;
+      continue;
+    }
+    if ( entry != "" )
+    {
+      string::size_type separator = entry.find( '=' );
+      if ( separator == string::npos || separator == 0 )
+        return false;
+      char *end;
+      long capacity = strtol( entry.c_str() + separator + 1, &end, 10 );
+      if ( *end != '\0' || end == entry.c_str() + separator + 1 || capacity < 0 )
+        return false;
+      m_poolCapacity[entry.substr( 0, separator )] = capacity;
+      entry = "";
+    }
+    if ( *p == '\0' )
+      break;
+  }
+  return true;
+}
+
+/**
+ * Take a parked module of a node type and mobility model from its pool. Returns NULL if
+ * there is none, in which case the caller creates a new module.
+ */
+cModule *NodeFactory::_takePooledModule( const string &type, const string &mobilityModel )
+{
+  if ( m_poolCapacity.find( type ) == m_poolCapacity.end() )
+    return NULL;
+
+  MODULE_POOL &pool = m_modulePools[type + "." + mobilityModel];
+  if ( pool.parked.empty() )
+  {
+    pool.misses++;
+    m_poolMisses++;
+    return NULL;
+  }
+  cModule *module = pool.parked.back();
+  pool.parked.pop_back();
+  pool.hits++;
+  m_poolHits++;
+  return module;
+}
+
+/**
+ * Park a finished module for reuse. Only nodes navigated by TraceMobility or 
+ * ContactNotifier are parked, as those release all their events when finished. Returns
+ * false if the module is not parked, in which case the caller deletes it.
+ */
+bool NodeFactory::_parkModule( cModule *module )
+{
+  const char *type = module->moduleType()->name();
+  std::map<string,unsigned int>::iterator capacity = m_poolCapacity.find( type );
+  if ( capacity == m_poolCapacity.end() || !module->hasPar("mobilityModel") )
+    return false;
+  string mobilityModel = (const char *)module->par("mobilityModel");
+  if ( mobilityModel != "TraceMobility" && mobilityModel != "ContactNotifier" )
+    return false;
+
+  MODULE_POOL &pool = m_modulePools[string(type) + "." + mobilityModel];
+  if ( pool.parked.size() >= capacity->second )
+  {
+    pool.discards++;
+    m_poolDiscards++;
+    return false;
+  }
+  pool.parked.push_back( module );
+  return true;
+}
+
+int NodeFactory::_findNode( int nodeId )
+{
+  NODE_INDEX_MAP_TYPE::iterator iter = m_nodeIndex.find( nodeId );
+  if ( iter == m_nodeIndex.end() )
+    return -1;
+  return iter->second;
+}
+
+int NodeFactory::_loadNodeTrace( int nodeId )
+{
+  int index = _internNode( nodeId );
+  if ( (unsigned int)index >= m_nodeTraceLoaded.size() )
+    m_nodeTraceLoaded.resize( index+1, false );
+  if ( m_nodeTraceLoaded[index] )
+    return index;
+  m_nodeTraceLoaded[index] = true;
+
+  BufferedTraceSink records;
+  if ( !m_traceIndex.loadNode( nodeId, &records, m_scenarioSizeX, m_scenarioSizeY ) )
+    error( "%s", m_traceIndex.lastError().c_str() );
+  waypointEventsVector &pending = _pendingWaypointsLists[index];
+  pending.clear();
+  pending.reserve( records.waypoints.size() );
+  for ( unsigned long i=0; i < records.waypoints.size(); i++ )
+    pending.push_back( waypointOf( records.waypoints[i] ) );
+  contactEventsVector &contacts = _pendingContactsLists[index];
+  contacts.clear();
+  contacts.reserve( records.contacts.size() );
+  for ( unsigned long i=0; i < records.contacts.size(); i++ )
+    contacts.push_back( contactOf( records.contacts[i] ) );
+  m_lazyLoads++;
+  return index;
+}
+
+void NodeFactory::_reserveNodes( unsigned long nodes, unsigned long records )
+{
+  if ( nodes == 0 )
+    return;
+  m_nodeIds.reserve( nodes );
+  m_recordsPerNodeHint = records / nodes;
+}
+
+void NodeFactory::_queueTraceEvent( TraceEvent *event )
+{
+  event->setPriority(TRACE_EVENT_PRIORITY);
+  m_traceSchedule.push_back(event);
 }
 
+/**
+ * A compiled trace validated against a scenario no larger than the current one needs
+ * no further validation. A zero scenario size disables validation.
+ */
+bool NodeFactory::_binaryTraceValidated( const BINARY_TRACE_HEADER *header )
+{
+  if ( !( header->flags & BINARY_TRACE_VALIDATED ) )
+    return false;
+  bool xValid = m_scenarioSizeX == 0 || ( header->scenarioSizeX != 0 && header->scenarioSizeX <= m_scenarioSizeX );
+  bool yValid = m_scenarioSizeY == 0 || ( header->scenarioSizeY != 0 && header->scenarioSizeY <= m_scenarioSizeY );
+  return xValid && yValid;
+}
 
 /**
  * @todo Add the node id and location for easier debugging of traces.
@@ -29,21 +29,103 @@
 
 #include <omnetpp.h>
 #include <string>
-#include <libxml/xmlreader.h>
-#include <libxml/parser.h>
-#include <libxml/tree.h>
+#include <deque>
 #include "NodeFactoryItem.h"
+#include "NodeSlotMap.h"
 #include "TraceMobility.h"
 #include "ContactNotifier.h"
+#include "ContactIndex.h"
+#include "BinaryTrace.h"
+#include "XmlTraceParser.h"
+#include "ParallelTraceParser.h"
+#include "TraceIndex.h"
+#include "TraceCache.h"
+#include "TraceSource.h"
+#include "WaypointSimplifier.h"
+#include "NodeTrajectory.h"
+#include "TrajectoryService.h"
 #include "TraceEvents_m.h"
 
 using namespace std;
 
 typedef vector<cModule*> MODULE_VECTOR_TYPE;
-typedef vector<NodeFactoryItem*> CREATED_ITEMS_VECTOR_TYPE;
+typedef vector<TraceEvent*> TRACE_SCHEDULE_VECTOR_TYPE;
+typedef map<int,int> NODE_INDEX_MAP_TYPE;
 
-enum COORD_TYPE {xCoordinate,yCoordinate};
-enum TRACE_TYPE {None,MobilityTrace,ContactTrace};
+/**
+ * @brief The waypoint or contact records of a node in a trace image, as record indices
+ *        [first,first+count).
+ */
+struct TRACE_IMAGE_RANGE
+{
+  uint32_t first;
+  uint32_t count;
+};
+typedef vector<TRACE_IMAGE_RANGE> TRACE_IMAGE_RANGE_VECTOR_TYPE;
+
+/**
+ * @brief Finished node modules of one node type and mobility model, kept for reuse,
+ *        and the statistics of the pool.
+ */
+struct MODULE_POOL
+{
+  MODULE_VECTOR_TYPE parked;
+  unsigned long      hits;
+  unsigned long      misses;
+  unsigned long      discards;
+
+  MODULE_POOL() : hits(0), misses(0), discards(0) {}
+};
+typedef map<string,MODULE_POOL> MODULE_POOL_MAP_TYPE;
+
+/**
+ * @brief A node handled by the region of interest. Outside the region the node is
+ *        virtual, only its trajectory is kept. Inside it the node is materialized as a
+ *        module, built from the create event with the location and waypoints at the time.
+ */
+struct REGION_NODE
+{
+  CreateEvent   *createEvent;
+  NodeTrajectory trajectory;
+  /** @brief The handle of the module of the node. Invalid while the node is virtual. */
+  NODE_HANDLE    handle;
+  /** @brief The position of the node in the region node list */
+  unsigned int   position;
+  /** @brief The time the node was created by the trace */
+  simtime_t      createTime;
+};
+typedef vector<REGION_NODE*> REGION_NODE_VECTOR_TYPE;
+typedef multimap<int,REGION_NODE*> REGION_NODE_MAP_TYPE;
+
+// Message kind of the trace cursor self message
+#define TRACE_CURSOR_EVENT_KIND 100
+// Message kind of a batch of create events with the same time
+#define CREATE_BATCH_EVENT_KIND 101
+// Message kind of the region of interest check self message
+#define REGION_CHECK_EVENT_KIND 102
+// Message kind of the instrumentation sample self message
+#define INSTRUMENT_EVENT_KIND 103
+// Message priorities of the trace cursor and the create and destroy events. Both
+// are handled before any other event scheduled for the same time. 
+#define TRACE_CURSOR_PRIORITY -2
+#define TRACE_EVENT_PRIORITY  -1
+
+/**
+ * @brief Create events of the trace with the same time, adjacent in the trace schedule,
+ *        handled as a single event. The batch owns the create events.
+ */
+class CreateBatchEvent : public cMessage
+{
+  public:
+    vector<CreateEvent*> events;
+
+    CreateBatchEvent() : cMessage( "createBatch", CREATE_BATCH_EVENT_KIND ) {}
+    virtual ~CreateBatchEvent()
+    {
+      for ( unsigned int i=0; i < events.size(); i++ )
+        delete events[i];
+    }
+};
 
 /**
  *
@@ -52,7 +134,8 @@ enum TRACE_TYPE {None,MobilityTrace,ContactTrace};
  * The node factory instantiates nodes dynamically during a simulation run from definitions
  * in a XML trace file. A mobility trace defines create, destroy and waypoint events for
  * a collection of nodes. Such a trace is created using an external mobility generator, e.g.
- * UrbanMobility from the MobiTrace toolkit, or UDel (http://udelmodels.eecis.udel.edu).
+ * UrbanMobility from the MobiTrace toolkit, UDel (http://udelmodels.eecis.udel.edu), ns-2 setdest,
+ * BonnMotion or the ONE.
  * Contact traces can additionally be used. Such traces can e.g. be created from contact 
  * measurements conducted with mobile devices.
  *
@@ -60,12 +143,61 @@ enum TRACE_TYPE {None,MobilityTrace,ContactTrace};
  * @author Olafur R. Helgason
  * @version 1.0 
  */
-class NodeFactory : public cSimpleModule
+class NodeFactory : public cSimpleModule, public TraceSink
 {
 	private:
 		int 		      m_scenarioSizeX;      /**< @brief The width of the scenario */
 		int 		      m_scenarioSizeY;      /**< @brief The height of the scenario */
     string        m_traceFile;          /**< @brief Name of the tracefile */
+    string        m_traceFormat;        /**< @brief Format of the tracefile, xml, binary or a TraceSource format */
+    /** @brief The trace cursor lookahead in seconds. Create and destroy events are 
+               scheduled at most this far ahead of the simulation time. */
+    double        m_traceLookahead;
+    /** @brief The number of threads used to parse XML traces. Zero uses one thread 
+               per processor. */
+    int           m_traceParserThreads;
+    /** @brief If set, the waypoints or contacts of a node are read from the trace file
+               when the node is created, using a per-node index of the trace. */
+    bool          m_lazyTraceLoading;
+    /** @brief Directory of the compiled trace cache. Empty disables the cache. */
+    string        m_traceCacheDir;
+    /** @brief If set, concurrent runs lock cache entries while compiling them */
+    bool          m_traceCacheShared;
+    /** @brief The file the trace was actually read from and its format. Differs from
+               m_traceFile when the trace is read from a cache entry. */
+    string        m_loadedTraceFile;
+    bool          m_loadedTraceBinary;
+    /** @brief If set, the waypoints and contacts of binary traces are read from the 
+               mapped trace file, shared with other processes, rather than copied. */
+    bool          m_sharedTraceImage;
+    /** @brief The maximum location error in meters when merging the samples of UDel
+               traces into linear segments */
+    double        m_traceTolerance;
+    /** @brief If set, the waypoint list of each node is simplified within 
+               m_simplifyMaxError meters, see WaypointSimplifier */
+    bool          m_simplifyWaypoints;
+    double        m_simplifyMaxError;
+    /** @brief If set, the trajectories of all nodes are kept for location queries */
+    bool          m_useTrajectoryService;
+    TrajectoryService m_trajectories;
+    /** @brief The contact index of the network, NULL if there is none. Destroyed nodes
+               are removed from it. */
+    ContactIndex *m_contactIndex;
+    /** @brief The region of interest, "x1,y1,x2,y2". Empty disables the region. */
+    string        m_regionOfInterest;
+    bool          m_useRegion;
+    double        m_regionX1;
+    double        m_regionY1;
+    double        m_regionX2;
+    double        m_regionY2;
+    /** @brief The interval in seconds at which nodes are checked against the region */
+    double        m_regionCheckInterval;
+    /** @brief The interval in seconds at which the instrumentation vectors are sampled.
+               Zero disables the vectors. */
+    double        m_instrumentInterval;
+    /** @brief The node types whose modules are recycled and the number of modules of
+               each kept for reuse, e.g. "SimpleNode=100". Empty disables recycling. */
+    string        m_recyclePool;
 
     /** @brief The number of initialized modules, i.e. create commands read from file */
     unsigned long m_initializedCount;   
@@ -82,23 +214,133 @@ class NodeFactory : public cSimpleModule
 		
 		/** @brief The type of trace in effect. Either mobility or contact traces can be 
 		           in effect at the same time. Trace types cannot be mixed. */
-		TRACE_TYPE m_traceType;
-    /** @brief The generated modules */
-		CREATED_ITEMS_VECTOR_TYPE m_createdItems;
+		TRACE_TYPE m_traceType;
+    /** @brief The generated modules, by node id */
+		NodeSlotMap m_createdItems;
+
+    /** @brief Create and destroy events read from the trace file, ordered by time.
+               Events are moved from the schedule to the future event set by the
+               trace cursor as simulation time advances. */
+    TRACE_SCHEDULE_VECTOR_TYPE m_traceSchedule;
+    /** @brief Index of the first event in m_traceSchedule not yet scheduled */
+    unsigned long m_traceCursor;
+    /** @brief The trace cursor self message. Fires when the next window of create 
+               and destroy events should be scheduled. */
+    cMessage *m_traceCursorEvent;
   
-    /** @brief A collection of lists of waypoints read from the trace file. The lists
-               are assigned to TraceMobility modules of created nodes and then
-               cleared. */
-    map<int, waypointEventsList> _pendingWaypointsLists;
-    /** @brief A collection of contact events read from the trace file. The lists
-               are assigned to ContactNotifier modules upon node creation. */
-    map<int, contactEventsList> _pendingContactsLists;
+    /** @brief Maps node ids read from the trace file to dense node indices. Each node
+               id is interned once, the first time it is seen in the trace. */
+    NODE_INDEX_MAP_TYPE m_nodeIndex;
+    /** @brief The node id of each dense node index */
+    vector<int> m_nodeIds;
+    /** @brief The node id and index of the last node interned. Trace records of the 
+               same node are often adjacent, which saves most index lookups. */
+    int m_lastNodeId;
+    int m_lastNodeIndex;
+    /** @brief Expected number of waypoints or contacts per node. Read from the trace
+               header if available and used to pre-size the per-node lists. */
+    unsigned long m_recordsPerNodeHint;
+    /** @brief The number of records read from the trace file */
+    unsigned long m_parsedRecords;
+
+    /** @brief Lists of waypoints read from the trace file, indexed by dense node 
+               index. The lists are assigned to TraceMobility modules of created 
+               nodes and then cleared. A deque is used so that adding a node never 
+               copies the lists of other nodes. */
+    deque<waypointEventsVector> _pendingWaypointsLists;
+    /** @brief Lists of contact events read from the trace file, indexed by dense
+               node index. The lists are assigned to ContactNotifier modules upon 
+               node creation. */
+    deque<contactEventsVector> _pendingContactsLists;
+
+    /** @brief Offsets of the records of each node in the trace file. Only used when
+               lazy trace loading is enabled. */
+    TraceIndex m_traceIndex;
+    /** @brief Set for each dense node index whose records have been loaded lazily */
+    vector<bool> m_nodeTraceLoaded;
+    /** @brief The number of nodes whose records have been loaded lazily */
+    unsigned long m_lazyLoads;
+    /** @brief The number of waypoints removed by simplification */
+    unsigned long m_simplifiedWaypoints;
+
+    /** @brief The mapped binary trace, when the trace image is in use */
+    BinaryTraceReader m_traceImage;
+    /** @brief True if the records of nodes are read from the trace image */
+    bool m_useTraceImage;
+    /** @brief The records of each node in the trace image, indexed by dense node index */
+    TRACE_IMAGE_RANGE_VECTOR_TYPE m_imageRanges;
+
+    /** @brief The nodes handled by the region of interest, and the same by node id */
+    REGION_NODE_VECTOR_TYPE m_regionNodes;
+    REGION_NODE_MAP_TYPE m_regionIndex;
+    /** @brief The region check self message */
+    cMessage *m_regionCheckEvent;
+    /** @brief The number of region nodes presently materialized */
+    unsigned long m_materializedNodes;
+    unsigned long m_materializations;
+    unsigned long m_dematerializations;
+    /** @brief The largest numbers of virtual and materialized nodes, and their integrals
+               over time up to m_regionCountTime */
+    unsigned long m_maxVirtualNodes;
+    unsigned long m_maxMaterializedNodes;
+    double m_virtualNodeTime;
+    double m_materializedNodeTime;
+    simtime_t m_regionCountTime;
+
+    /** @brief Module types by name, resolved once. NULL if the type does not exist. */
+    map<string,cModuleType*> m_moduleTypes;
+    /** @brief The number of create batches and of nodes created in batches */
+    unsigned long m_createBatches;
+    unsigned long m_batchedCreates;
+
+    /** @brief The capacity of the recycle pool of each node type */
+    map<string,unsigned int> m_poolCapacity;
+    /** @brief Parked modules, by node type and mobility model */
+    MODULE_POOL_MAP_TYPE m_modulePools;
+    /** @brief Nodes created from a parked module, created anew although recyclable, and
+               destroyed although recyclable because the pool was full */
+    unsigned long m_poolHits;
+    unsigned long m_poolMisses;
+    unsigned long m_poolDiscards;
+
+    /** @brief Wall clock seconds spent reading the trace, creating and destroying nodes */
+    double m_readWallTime;
+    double m_createWallTime;
+    double m_destroyWallTime;
+    /** @brief The wall clock time and event number at the start of the run and at the 
+               last instrumentation sample */
+    double m_runWallStart;
+    double m_sampleWallTime;
+    long   m_sampleEventNumber;
+    /** @brief The largest number of bytes held by the pending lists */
+    unsigned long m_maxPendingBytes;
+    /** @brief The largest number of nodes alive as modules at the same time */
+    unsigned long m_maxAliveNodes;
+    /** @brief The instrumentation sample self message and the sampled vectors */
+    cMessage  *m_instrumentEvent;
+    cOutVector m_aliveVector;
+    cOutVector m_pendingBytesVector;
+    cOutVector m_eventRateVector;
+    cOutVector m_memoryVector;
 
 
   public:
     /** @brief Constructor */
     NodeFactory();
 
+    /** @brief Returns a handle of the created node with a trace node id. The handle is
+               invalid if no such node is alive. */
+    NODE_HANDLE findNode( int nodeId ) const { return m_createdItems.find( nodeId ); }
+    /** @brief Returns the module of a created node, or NULL if it has been destroyed */
+    cModule *nodeModule( NODE_HANDLE handle ) const;
+    /** @brief Returns the location of a trace node at a time, past or future, from its
+               trajectory. Returns false if the node is not alive at the time. Requires
+               the trajectory service. */
+    bool positionAt( int nodeId, double time, double &x, double &y );
+    /** @brief Returns the locations of all trace nodes alive at a time. Requires the 
+               trajectory service. */
+    void positionsAt( double time, vector<NODE_POSITION> &positions );
+
   protected:
   	/** @brief Overrides of virtual base class functions. */
     virtual void initialize();
@@ -109,18 +351,96 @@ class NodeFactory : public cSimpleModule
 
     /** @brief Create a node. Triggered by a CreateEvent message */
     void createNode( CreateEvent *event );
+    /** @brief Create the nodes of a batch in trace order. Triggered by a CreateBatchEvent
+               message. */
+    void createNodes( CreateBatchEvent *batch );
     /** @brief Destroy a node. Triggered by a DestroyEvent message */
     int  destroyNode( DestroyEvent *event );
     
-    /** @brief Reads a XML trace file. The filename is specified 
-               as a module startup parameter. */
+    /** @brief Reads a XML trace file, or its compiled trace cache entry. The filename 
+               is specified as a module startup parameter. */
     void readXmlTrace();       
-    /** @brief Reads a XML mobility trace. */
-    void readXmlMobilityTrace( xmlTextReaderPtr reader ); 
-    /** @brief Reads a XML contact trace file. */
-    void readXmlContactTrace( xmlTextReaderPtr reader );     
+    /** @brief Reads a memory mapped binary trace file. See BinaryTrace.h for the format. */
+    void readBinaryTrace( const char *filename );
+    /** @brief Reads a trace in a foreign mobility format, see TraceSource */
+    void readSourceTrace();
+
+    /** @brief TraceSink implementation. Sets the trace type and pre-sizes the node lists. */
+    virtual void beginTrace( TRACE_TYPE traceType, unsigned long nodesHint, unsigned long recordsHint );
+    /** @brief TraceSink implementation. Queues a create or destroy event. */
+    virtual void addCommand( const TRACE_COMMAND &command );
+    /** @brief TraceSink implementation. Appends a waypoint to the pending lists. */
+    virtual void addWaypoint( const WAYPOINT_EVENT &waypoint );
+    /** @brief TraceSink implementation. Appends a contact event to the pending lists. */
+    virtual void addContact( const CONTACT_EVENT &contact );
+
+    /** @brief Schedules the create and destroy events within the lookahead window and 
+               reschedules the trace cursor. */
+    void advanceTraceCursor();
     
   private:
+    /** @brief Returns the dense index of a node id, interning the id if it is new */
+    int _internNode( int nodeId );
+    /** @brief Returns the dense index of a node id, or -1 if the id is not in the trace */
+    int _findNode( int nodeId );
+    /** @brief Parses the XML trace file into a sink. In commands only mode the 
+               parallel parser does not buffer waypoints and contacts. */
+    void _parseXmlTrace( TraceSink *sink, bool commandsOnly );
+    /** @brief Simplifies the waypoint lists of all nodes */
+    void _simplifyPendingWaypoints();
+    /** @brief Builds the trajectories of all nodes from the schedule and pending lists */
+    void _buildTrajectoryService();
+    /** @brief Finds the records of each node in the trace image */
+    void _mapTraceImage();
+    /** @brief Copies the records of a node from the trace image to its pending list */
+    void _loadImageRecords( int nodeIndex );
+    /** @brief Queues the create and destroy commands of a binary trace */
+    void _readBinaryCommands( BinaryTraceReader &reader );
+    /** @brief Loads the records of a node into the pending lists from the trace index.
+               Returns the dense index of the node. Records are only loaded once. */
+    int _loadNodeTrace( int nodeId );
+    /** @brief Reserves storage for a number of nodes and records per node */
+    void _reserveNodes( unsigned long nodes, unsigned long records );
+    /** @brief Appends a create or destroy event read from the trace to the trace schedule */
+    void _queueTraceEvent( TraceEvent *event );
+    /** @brief Returns true if the locations of a binary trace need not be validated */
+    bool _binaryTraceValidated( const BINARY_TRACE_HEADER *header );
+    /** @brief Gets the pending records of a created node ready. Returns its dense index. */
+    int _acquireNodeRecords( CreateEvent *event );
+    /** @brief Builds the module of a node and hands it its pending records. The node
+               is counted as created by the caller. */
+    NODE_HANDLE _buildNode( CreateEvent *event, int nodeIndex );
+    /** @brief Finishes the module of a node and parks or deletes it. The lifetime of
+               the node is accounted for by the caller. */
+    void _teardownNode( NodeFactoryItem *item );
+    /** @brief Parses the region of interest parameter. Returns false if malformed. */
+    bool _parseRegion( const char *spec );
+    /** @brief Adds a created node to the region nodes as a virtual node */
+    void _createRegionNode( CreateEvent *event, int nodeIndex );
+    /** @brief Materializes or dematerializes a region node as it enters or leaves the region */
+    void _updateRegionNode( REGION_NODE *node );
+    /** @brief Removes a destroyed node from the region nodes. Returns false if it is not
+               a region node. */
+    bool _destroyRegionNode( int nodeId );
+    /** @brief Adds the present virtual and materialized node counts to their integrals */
+    void _updateRegionCounts();
+    /** @brief Returns the bytes held by the pending lists of a node, or of all nodes */
+    unsigned long _pendingBytes( int nodeIndex ) const;
+    unsigned long _pendingBytes() const;
+    /** @brief Records the instrumentation vectors and schedules the next sample */
+    void _sampleInstrumentation();
+    /** @brief Finds a module type by name. Each name is only looked up once. */
+    cModuleType *_findModuleType( const char *name );
+    /** @brief Loads the records of the nodes of a create batch which have not been loaded
+               yet, in a single read of the trace index */
+    void _loadBatchTraces( const vector<CreateEvent*> &events );
+    /** @brief Parses the recycle pool parameter. Returns false if malformed. */
+    bool _parseRecyclePool( const char *spec );
+    /** @brief Takes a parked module of a node type and mobility model. Returns NULL if
+               the pool is empty or the type not recycled. */
+    cModule *_takePooledModule( const string &type, const string &mobilityModel );
+    /** @brief Parks a finished module for reuse. Returns false if it is not parked. */
+    bool _parkModule( cModule *module );
     /** @brief Validates a create or waypoint location. Used when parsing the xml trace file */
     bool _validateLocation( double coordinate, COORD_TYPE ct );
 };
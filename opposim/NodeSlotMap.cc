@@ -0,0 +1,218 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "NodeSlotMap.h"
+
+// Marks empty hash buckets and the end of slot lists
+#define NO_SLOT 0xffffffff
+// Initial number of hash buckets
+#define MIN_BUCKETS 16
+
+NodeSlotMap::NodeSlotMap()
+{
+  m_freeSlot = NO_SLOT;
+}
+
+NODE_HANDLE NodeSlotMap::insert( NodeFactoryItem *item )
+{
+  uint32_t slot = m_freeSlot;
+  if ( slot != NO_SLOT )
+    m_freeSlot = m_slots[slot].position;
+  else
+  {
+    slot = m_slots.size();
+    SLOT empty;
+    empty.generation = 0;
+    m_slots.push_back( empty );
+  }
+  m_slots[slot].position = m_items.size();
+  m_slots[slot].nextSameId = NO_SLOT;
+  m_slots[slot].used = true;
+  m_items.push_back( item );
+  m_itemSlots.push_back( slot );
+
+  if ( m_items.size() * 2 > m_buckets.size() )
+    _rehash( m_buckets.empty() ? MIN_BUCKETS : m_buckets.size() * 2 );
+
+  uint32_t bucket = _findBucket( item->getId() );
+  if ( m_buckets[bucket] == NO_SLOT )
+    m_buckets[bucket] = slot;
+  else
+  {
+    // A node with the same id is alive. Append to the end of its list.
+    uint32_t last = m_buckets[bucket];
+    while ( m_slots[last].nextSameId != NO_SLOT )
+      last = m_slots[last].nextSameId;
+    m_slots[last].nextSameId = slot;
+  }
+
+  NODE_HANDLE handle;
+  handle.slot = slot;
+  handle.generation = m_slots[slot].generation;
+  return handle;
+}
+
+NODE_HANDLE NodeSlotMap::find( int nodeId ) const
+{
+  NODE_HANDLE handle;
+  handle.slot = NODE_HANDLE_INVALID_SLOT;
+  handle.generation = 0;
+  if ( m_buckets.empty() )
+    return handle;
+
+  uint32_t slot = m_buckets[_findBucket( nodeId )];
+  if ( slot != NO_SLOT )
+  {
+    handle.slot = slot;
+    handle.generation = m_slots[slot].generation;
+  }
+  return handle;
+}
+
+NodeFactoryItem *NodeSlotMap::get( NODE_HANDLE handle ) const
+{
+  if ( handle.slot >= m_slots.size() )
+    return NULL;
+  const SLOT &slot = m_slots[handle.slot];
+  if ( !slot.used || slot.generation != handle.generation )
+    return NULL;
+  return m_items[slot.position];
+}
+
+NodeFactoryItem *NodeSlotMap::remove( NODE_HANDLE handle )
+{
+  NodeFactoryItem *item = get( handle );
+  if ( item == NULL )
+    return NULL;
+  uint32_t slot = handle.slot;
+
+  // Unlink from the id index
+  uint32_t bucket = _findBucket( item->getId() );
+  if ( m_buckets[bucket] == slot )
+  {
+    if ( m_slots[slot].nextSameId != NO_SLOT )
+      m_buckets[bucket] = m_slots[slot].nextSameId;
+    else
+      _eraseBucket( bucket );
+  }
+  else
+  {
+    uint32_t prev = m_buckets[bucket];
+    while ( m_slots[prev].nextSameId != slot )
+      prev = m_slots[prev].nextSameId;
+    m_slots[prev].nextSameId = m_slots[slot].nextSameId;
+  }
+
+  // Move the last item into the place of the removed one
+  uint32_t position = m_slots[slot].position;
+  uint32_t last = m_items.size() - 1;
+  if ( position != last )
+  {
+    m_items[position] = m_items[last];
+    m_itemSlots[position] = m_itemSlots[last];
+    m_slots[m_itemSlots[position]].position = position;
+  }
+  m_items.pop_back();
+  m_itemSlots.pop_back();
+
+  // Free the slot. The new generation invalidates outstanding handles.
+  m_slots[slot].used = false;
+  m_slots[slot].generation++;
+  m_slots[slot].position = m_freeSlot;
+  m_freeSlot = slot;
+  return item;
+}
+
+void NodeSlotMap::clear()
+{
+  for ( unsigned int i=0; i < m_itemSlots.size(); i++ )
+  {
+    SLOT &slot = m_slots[m_itemSlots[i]];
+    slot.used = false;
+    slot.generation++;
+    slot.position = m_freeSlot;
+    m_freeSlot = m_itemSlots[i];
+  }
+  m_items.clear();
+  m_itemSlots.clear();
+  m_buckets.assign( m_buckets.size(), NO_SLOT );
+}
+
+uint32_t NodeSlotMap::_bucketOf( int nodeId ) const
+{
+  uint32_t hash = (uint32_t)nodeId * 2654435761u;
+  hash ^= hash >> 16;
+  return hash & ( m_buckets.size() - 1 );
+}
+
+/**
+ * Returns the bucket of a node id, or the empty bucket where it would be inserted.
+ */
+uint32_t NodeSlotMap::_findBucket( int nodeId ) const
+{
+  uint32_t mask = m_buckets.size() - 1;
+  uint32_t bucket = _bucketOf( nodeId );
+  while ( m_buckets[bucket] != NO_SLOT &&
+          m_items[m_slots[m_buckets[bucket]].position]->getId() != nodeId )
+    bucket = ( bucket + 1 ) & mask;
+  return bucket;
+}
+
+/**
+ * Empties a bucket. Entries after it are shifted back so that lookups never stop
+ * at the hole before reaching them.
+ */
+void NodeSlotMap::_eraseBucket( uint32_t bucket )
+{
+  uint32_t mask = m_buckets.size() - 1;
+  uint32_t hole = bucket;
+  uint32_t next = ( bucket + 1 ) & mask;
+  while ( m_buckets[next] != NO_SLOT )
+  {
+    uint32_t home = _bucketOf( m_items[m_slots[m_buckets[next]].position]->getId() );
+    // The entry may move to the hole if its home is not between the hole and itself
+    if ( ( ( next - home ) & mask ) >= ( ( next - hole ) & mask ) )
+    {
+      m_buckets[hole] = m_buckets[next];
+      hole = next;
+    }
+    next = ( next + 1 ) & mask;
+  }
+  m_buckets[hole] = NO_SLOT;
+}
+
+void NodeSlotMap::_rehash( unsigned int buckets )
+{
+  // Only the first slot of each node id is in the table
+  std::vector<uint32_t> heads;
+  for ( unsigned int i=0; i < m_buckets.size(); i++ )
+    if ( m_buckets[i] != NO_SLOT )
+      heads.push_back( m_buckets[i] );
+
+  m_buckets.assign( buckets, NO_SLOT );
+  for ( unsigned int i=0; i < heads.size(); i++ )
+    m_buckets[_findBucket( m_items[m_slots[heads[i]].position]->getId() )] = heads[i];
+}
@@ -0,0 +1,115 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __NODE_SLOT_MAP_INCLUDED__
+#define __NODE_SLOT_MAP_INCLUDED__
+
+#include <vector>
+#include <stdint.h>
+#include "NodeFactoryItem.h"
+
+/**
+ * @brief Stable handle of a created node. A handle stays valid until its node is
+ *        destroyed, after which lookups with it fail even if the slot is reused.
+ */
+struct NODE_HANDLE
+{
+  uint32_t slot;
+  uint32_t generation;
+};
+
+// Slot of the invalid handle
+#define NODE_HANDLE_INVALID_SLOT 0xffffffff
+
+/**
+ * @brief The created nodes of the node factory, with constant time insert, lookup by
+ *        node id and remove.
+ *
+ * Items are stored in a contiguous array, so iterating over all nodes is cheap. An
+ * item is removed by moving the last item into its place, so the iteration order
+ * changes as nodes are removed. Each item has a slot which maps its handle to its
+ * place in the array, and a generation which is increased when the slot is freed.
+ *
+ * Node ids are mapped to slots with an open addressing hash table. Should several
+ * nodes with the same id be alive at once, find() returns the oldest of them.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class NodeSlotMap
+{
+  private:
+    struct SLOT
+    {
+      /** @brief The position of the item in the item array, or the next free slot */
+      uint32_t position;
+      uint32_t generation;
+      /** @brief The next slot of a node with the same id, in creation order */
+      uint32_t nextSameId;
+      bool     used;
+    };
+
+    std::vector<NodeFactoryItem*> m_items;
+    /** @brief The slot of each item in the item array */
+    std::vector<uint32_t>         m_itemSlots;
+    std::vector<SLOT>             m_slots;
+    uint32_t                      m_freeSlot;
+    /** @brief Hash table of node ids to slots. The size is a power of two and at least
+               twice the number of items. */
+    std::vector<uint32_t>         m_buckets;
+
+  public:
+    /** @brief Constructor */
+    NodeSlotMap();
+
+    /** @brief Adds a created node, keyed by its node id, and returns its handle */
+    NODE_HANDLE insert( NodeFactoryItem *item );
+    /** @brief Returns the handle of the oldest alive node with a node id. The handle is
+               invalid if there is no such node. */
+    NODE_HANDLE find( int nodeId ) const;
+    /** @brief Returns the node of a handle, or NULL if the node has been removed */
+    NodeFactoryItem *get( NODE_HANDLE handle ) const;
+    /** @brief Removes the node of a handle and returns it. Returns NULL if the handle is
+               no longer valid. The item is not deleted. */
+    NodeFactoryItem *remove( NODE_HANDLE handle );
+    /** @brief Removes all nodes. The items are not deleted. */
+    void clear();
+
+    /** @brief Returns the number of nodes */
+    unsigned int size() const { return m_items.size(); }
+    /** @brief Returns a node by its position, for iterating over all nodes */
+    NodeFactoryItem *at( unsigned int position ) const { return m_items[position]; }
+
+    /** @brief Returns true if a handle refers to a node, which may have been removed */
+    static bool isValid( NODE_HANDLE handle ) { return handle.slot != NODE_HANDLE_INVALID_SLOT; }
+
+  private:
+    uint32_t _bucketOf( int nodeId ) const;
+    uint32_t _findBucket( int nodeId ) const;
+    void _eraseBucket( uint32_t bucket );
+    void _rehash( unsigned int buckets );
+};
+
+#endif /* __NODE_SLOT_MAP_INCLUDED__ */
@@ -0,0 +1,145 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "NodeTrajectory.h"
+#include <math.h>
+#include <algorithm>
+
+/**
+ * Orders times before the segments starting after them
+ */
+struct SegmentStartAfter
+{
+  bool operator()( double time, const TRAJECTORY_SEGMENT &segment ) const { return time < segment.start; }
+};
+
+NodeTrajectory::NodeTrajectory()
+{
+  m_createTime = 0.0;
+  m_createX = 0.0;
+  m_createY = 0.0;
+  m_cursor = 0;
+}
+
+void NodeTrajectory::build( double createTime, double createX, double createY, const waypointEventsVector &waypoints )
+{
+  m_createTime = createTime;
+  m_createX = createX;
+  m_createY = createY;
+  m_cursor = 0;
+  m_segments.resize( waypoints.size() );
+
+  double prevEnd = createTime;
+  double prevX = createX;
+  double prevY = createY;
+  for ( unsigned int i=0; i < waypoints.size(); i++ )
+  {
+    const WAYPOINT &waypoint = waypoints[i];
+    TRAJECTORY_SEGMENT &segment = m_segments[i];
+    segment.start = waypoint.time > prevEnd ? waypoint.time : prevEnd;
+    segment.fromX = prevX;
+    segment.fromY = prevY;
+    segment.toX = waypoint.x;
+    segment.toY = waypoint.y;
+    segment.waypoint = waypoint;
+    double distance = sqrt( ( waypoint.x - prevX ) * ( waypoint.x - prevX ) +
+                            ( waypoint.y - prevY ) * ( waypoint.y - prevY ) );
+    if ( distance > 0.0 && waypoint.speed > 0.0 )
+      segment.end = segment.start + distance / waypoint.speed;
+    else
+      segment.end = segment.start;
+    prevEnd = segment.end;
+    prevX = waypoint.x;
+    prevY = waypoint.y;
+  }
+}
+
+void NodeTrajectory::positionAt( double time, double &x, double &y ) const
+{
+  int index = _findSegment( time );
+  if ( index < 0 )
+  {
+    x = m_createX;
+    y = m_createY;
+    return;
+  }
+
+  const TRAJECTORY_SEGMENT &segment = m_segments[index];
+  if ( time >= segment.end )
+  {
+    x = segment.toX;
+    y = segment.toY;
+    return;
+  }
+  double fraction = ( time - segment.start ) / ( segment.end - segment.start );
+  x = segment.fromX + fraction * ( segment.toX - segment.fromX );
+  y = segment.fromY + fraction * ( segment.toY - segment.fromY );
+}
+
+void NodeTrajectory::remainingWaypoints( double time, waypointEventsVector &waypoints ) const
+{
+  waypoints.clear();
+  int index = _findSegment( time );
+  unsigned int next = index + 1;
+  if ( index >= 0 && time < m_segments[index].end )
+  {
+    // Continue the movement in progress from where the node is now
+    WAYPOINT waypoint = m_segments[index].waypoint;
+    waypoint.time = time;
+    waypoints.push_back( waypoint );
+  }
+  for ( unsigned int i=next; i < m_segments.size(); i++ )
+    waypoints.push_back( m_segments[i].waypoint );
+}
+
+int NodeTrajectory::_findSegment( double time ) const
+{
+  if ( m_segments.empty() || time < m_segments[0].start )
+    return -1;
+
+  // Gallop forward from the last lookup, so that a lookup a few segments ahead is
+  // cheap and a far one logarithmic. Earlier times are searched for.
+  unsigned int index;
+  if ( m_cursor < m_segments.size() && m_segments[m_cursor].start <= time )
+  {
+    unsigned int low = m_cursor;
+    unsigned int step = 1;
+    unsigned int high = low + step;
+    while ( high < m_segments.size() && m_segments[high].start <= time )
+    {
+      low = high;
+      step *= 2;
+      high = low + step;
+    }
+    if ( high > m_segments.size() )
+      high = m_segments.size();
+    index = std::upper_bound( m_segments.begin() + low + 1, m_segments.begin() + high, time, SegmentStartAfter() ) - m_segments.begin() - 1;
+  }
+  else
+    index = std::upper_bound( m_segments.begin(), m_segments.end(), time, SegmentStartAfter() ) - m_segments.begin() - 1;
+  m_cursor = index;
+  return index;
+}
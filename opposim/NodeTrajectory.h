@@ -0,0 +1,98 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __NODE_TRAJECTORY_INCLUDED__
+#define __NODE_TRAJECTORY_INCLUDED__
+
+#include <vector>
+#include "TraceTypes.h"
+
+/**
+ * @brief A movement of a node along its trajectory. The node leaves the from location
+ *        at the start time and arrives at the to location at the end time.
+ */
+struct TRAJECTORY_SEGMENT
+{
+  double start;
+  double end;
+  double fromX;
+  double fromY;
+  double toX;
+  double toY;
+  /** @brief The waypoint the movement was made from */
+  WAYPOINT waypoint;
+};
+
+/**
+ * @brief The trajectory of a node, computed analytically from its waypoints.
+ *
+ * The movements are worked out as TraceMobility makes them: a movement starts at the
+ * waypoint time, or when the previous waypoint is reached if that is later, and goes
+ * in a straight line at the waypoint speed. A waypoint with no speed is jumped to. The
+ * location of the node at any time is then found without simulating its movement.
+ * Timing differences due to the TraceMobility update interval are not taken into
+ * account.
+ *
+ * Lookups are usually made at increasing times, so the segment of the last lookup is
+ * remembered and the search starts from there.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class NodeTrajectory
+{
+  private:
+    double                          m_createTime;
+    double                          m_createX;
+    double                          m_createY;
+    std::vector<TRAJECTORY_SEGMENT> m_segments;
+    mutable unsigned int            m_cursor;
+
+  public:
+    /** @brief Constructor. Creates the trajectory of a node which never moves from the
+               origin. */
+    NodeTrajectory();
+
+    /** @brief Builds the trajectory of a node created at a time and location */
+    void build( double createTime, double createX, double createY, const waypointEventsVector &waypoints );
+    /** @brief Returns the location of the node at a time. Before the node is created it
+               is at its create location. */
+    void positionAt( double time, double &x, double &y ) const;
+    /** @brief Returns the waypoints which take the node from its location at a time along
+               the rest of its trajectory. A movement in progress becomes a waypoint from
+               the current location at the same speed. */
+    void remainingWaypoints( double time, waypointEventsVector &waypoints ) const;
+    /** @brief Returns the time the node reaches its last waypoint */
+    double endTime() const { return m_segments.empty() ? m_createTime : m_segments.back().end; }
+    /** @brief Returns the number of movements */
+    unsigned int segments() const { return m_segments.size(); }
+
+  private:
+    /** @brief Returns the index of the last segment starting at or before a time, or -1
+               if there is none. */
+    int _findSegment( double time ) const;
+};
+
+#endif /* __NODE_TRAJECTORY_INCLUDED__ */
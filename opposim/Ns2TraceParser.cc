@@ -0,0 +1,155 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "Ns2TraceParser.h"
+#include <stdio.h>
+
+Ns2TraceParser::Ns2TraceParser( double scenarioSizeX, double scenarioSizeY )
+  : TraceSource( scenarioSizeX, scenarioSizeY )
+{
+}
+
+bool Ns2TraceParser::parseFile( const char *filename, TraceSink *sink )
+{
+  m_nodes.clear();
+  m_samples = 0;
+  m_waypoints = 0;
+
+  FILE *f = fopen( filename, "r" );
+  if ( f == NULL )
+  {
+    m_lastError = "Unable to open config file";
+    return false;
+  }
+
+  sink->beginTrace( MobilityTrace, 0, 0 );
+
+  char line[1024];
+  int lineNumber = 0;
+  bool ok = true;
+  while ( ok && fgets( line, sizeof(line), f ) != NULL )
+  {
+    lineNumber++;
+    ok = _parseLine( line, sink );
+  }
+  fclose(f);
+
+  if ( !ok )
+  {
+    _setErrorLine( lineNumber );
+    return false;
+  }
+
+  // Create the nodes which never move
+  NODE_STATE_MAP_TYPE::iterator iter;
+  for ( iter = m_nodes.begin(); ok && iter != m_nodes.end(); iter++ )
+    if ( !iter->second.created )
+      ok = _create( iter->first, iter->second, sink );
+  m_nodes.clear();
+  return ok;
+}
+
+bool Ns2TraceParser::_parseLine( const char *line, TraceSink *sink )
+{
+  int nodeId;
+  char coordinate;
+  double value;
+  if ( sscanf( line, " $node_(%d) set %c_ %lf", &nodeId, &coordinate, &value ) == 3 )
+  {
+    if ( coordinate != 'X' && coordinate != 'Y' )
+      return true;
+
+    NODE_STATE_MAP_TYPE::iterator iter = m_nodes.find( nodeId );
+    if ( iter == m_nodes.end() )
+    {
+      NODE_STATE state;
+      state.x = state.y = 0.0;
+      state.hasX = state.hasY = state.created = false;
+      iter = m_nodes.insert( NODE_STATE_MAP_TYPE::value_type( nodeId, state ) ).first;
+    }
+    NODE_STATE &state = iter->second;
+    if ( state.created )
+    {
+      m_lastError = "Initial location of node set after its first movement";
+      return false;
+    }
+    if ( coordinate == 'X' )
+    {
+      state.x = value;
+      state.hasX = true;
+    }
+    else
+    {
+      state.y = value;
+      state.hasY = true;
+    }
+    return true;
+  }
+
+  WAYPOINT_EVENT waypoint;
+  if ( sscanf( line, " $ns_ at %lf \"$node_(%d) setdest %lf %lf %lf", &waypoint.time, &waypoint.id,
+               &waypoint.x, &waypoint.y, &waypoint.speed ) == 5 )
+  {
+    m_samples++;
+    NODE_STATE_MAP_TYPE::iterator iter = m_nodes.find( waypoint.id );
+    if ( iter == m_nodes.end() )
+    {
+      m_lastError = "Movement of node with no initial location";
+      return false;
+    }
+    if ( !iter->second.created && !_create( waypoint.id, iter->second, sink ) )
+      return false;
+    if ( !_validateLocation( waypoint.x, waypoint.y ) )
+      return false;
+    if ( waypoint.speed < 0.0 )
+    {
+      m_lastError = "Negative speed";
+      return false;
+    }
+    // ns-2 leaves nodes with no speed where they are
+    if ( waypoint.speed == 0.0 )
+      return true;
+
+    sink->addWaypoint( waypoint );
+    m_waypoints++;
+  }
+  return true;
+}
+
+bool Ns2TraceParser::_create( int nodeId, NODE_STATE &state, TraceSink *sink )
+{
+  if ( !state.hasX || !state.hasY )
+  {
+    m_lastError = "Incomplete initial location of node";
+    return false;
+  }
+  if ( !_validateLocation( state.x, state.y ) )
+    return false;
+
+  _createNode( sink, nodeId, 0.0, state.x, state.y );
+  state.created = true;
+  return true;
+}
@@ -0,0 +1,86 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __NS2_TRACE_PARSER_INCLUDED__
+#define __NS2_TRACE_PARSER_INCLUDED__
+
+#include <string>
+#include <map>
+#include "TraceSource.h"
+
+/**
+ * @brief Parser for ns-2 movement scenario files, as written by setdest and BonnMotion.
+ *
+ * The initial location of each node is set with
+ *
+ *   $node_(0) set X_ 150.0
+ *   $node_(0) set Y_ 93.9
+ *
+ * and each movement is a setdest command:
+ *
+ *   $ns_ at 2.0 "$node_(0) setdest 300.0 200.0 5.0"
+ *
+ * which maps directly to a waypoint. All nodes are created at time zero at their
+ * initial location. Setdest commands with no speed leave the node where it is and are
+ * skipped. All other lines, such as Z_ coordinates, comments and $god_ commands, are
+ * ignored.
+ *
+ * ns-2 starts a setdest movement at its time even if the node has not arrived at the
+ * previous destination, whereas TraceMobility waits for the arrival. The two agree for
+ * scenarios where each movement is scheduled after the previous one ends, as setdest
+ * writes them.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class Ns2TraceParser : public TraceSource
+{
+  private:
+    /** @brief Initial location of a node */
+    struct NODE_STATE
+    {
+      double x;
+      double y;
+      bool   hasX;
+      bool   hasY;
+      bool   created;
+    };
+    typedef std::map<int,NODE_STATE> NODE_STATE_MAP_TYPE;
+
+    NODE_STATE_MAP_TYPE m_nodes;
+
+  public:
+    /** @brief Constructor. A zero scenario size disables location validation. */
+    Ns2TraceParser( double scenarioSizeX, double scenarioSizeY );
+
+    /** @brief Parses a ns-2 movement file. Returns false on error. */
+    virtual bool parseFile( const char *filename, TraceSink *sink );
+
+  private:
+    bool _parseLine( const char *line, TraceSink *sink );
+    bool _create( int nodeId, NODE_STATE &state, TraceSink *sink );
+};
+
+#endif /* __NS2_TRACE_PARSER_INCLUDED__ */
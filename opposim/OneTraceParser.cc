@@ -0,0 +1,124 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "OneTraceParser.h"
+#include <stdio.h>
+
+OneTraceParser::OneTraceParser( double scenarioSizeX, double scenarioSizeY )
+  : TraceSource( scenarioSizeX, scenarioSizeY )
+{
+  m_minX = 0.0;
+  m_minY = 0.0;
+}
+
+bool OneTraceParser::parseFile( const char *filename, TraceSink *sink )
+{
+  m_lastSamples.clear();
+  m_samples = 0;
+  m_waypoints = 0;
+
+  FILE *f = fopen( filename, "r" );
+  if ( f == NULL )
+  {
+    m_lastError = "Unable to open config file";
+    return false;
+  }
+
+  sink->beginTrace( MobilityTrace, 0, 0 );
+
+  char line[1024];
+  int lineNumber = 0;
+  bool ok = true;
+  while ( ok && fgets( line, sizeof(line), f ) != NULL )
+  {
+    lineNumber++;
+    ok = lineNumber == 1 ? _parseHeader( line ) : _parseLine( line, sink );
+  }
+  fclose(f);
+  m_lastSamples.clear();
+
+  if ( ok && lineNumber == 0 )
+  {
+    m_lastError = "Missing ONE movement header";
+    return false;
+  }
+  if ( !ok )
+  {
+    _setErrorLine( lineNumber );
+    return false;
+  }
+  return true;
+}
+
+bool OneTraceParser::_parseHeader( const char *line )
+{
+  double minTime, maxTime, maxX, maxY;
+  if ( sscanf( line, "%lf %lf %lf %lf %lf %lf", &minTime, &maxTime, &m_minX, &maxX, &m_minY, &maxY ) != 6 )
+  {
+    m_lastError = "Missing ONE movement header";
+    return false;
+  }
+  return true;
+}
+
+bool OneTraceParser::_parseLine( const char *line, TraceSink *sink )
+{
+  int nodeId;
+  SAMPLE sample;
+  char trailing;
+  int count = sscanf( line, "%lf %d %lf %lf %c", &sample.time, &nodeId, &sample.x, &sample.y, &trailing );
+  if ( count == EOF )
+    return true;
+  if ( count != 4 )
+  {
+    m_lastError = "Malformed ONE movement sample";
+    return false;
+  }
+  sample.x -= m_minX;
+  sample.y -= m_minY;
+  if ( !_validateLocation( sample.x, sample.y ) )
+    return false;
+  m_samples++;
+
+  SAMPLE_MAP_TYPE::iterator iter = m_lastSamples.find( nodeId );
+  if ( iter == m_lastSamples.end() )
+  {
+    // The node is created at its first sample
+    _createNode( sink, nodeId, sample.time, sample.x, sample.y );
+    m_lastSamples[nodeId] = sample;
+    return true;
+  }
+
+  SAMPLE &last = iter->second;
+  if ( sample.time < last.time )
+  {
+    m_lastError = "ONE samples of a node not in time order";
+    return false;
+  }
+  _addMovement( sink, nodeId, last.time, last.x, last.y, sample.time, sample.x, sample.y );
+  last = sample;
+  return true;
+}
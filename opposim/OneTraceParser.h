@@ -0,0 +1,80 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __ONE_TRACE_PARSER_INCLUDED__
+#define __ONE_TRACE_PARSER_INCLUDED__
+
+#include <string>
+#include <map>
+#include "TraceSource.h"
+
+/**
+ * @brief Parser for ONE simulator external movement files.
+ *
+ * The first line holds the bounds of the trace and each following line a location
+ * sample:
+ *
+ *   minTime maxTime minX maxX minY maxY
+ *   time id x y
+ *
+ * As in the ONE, locations are normalized by the minimum coordinates of the header,
+ * and nodes move in a straight line between consecutive samples. A node is created at
+ * its first sample and each following sample becomes a waypoint. Only numeric node
+ * ids are supported. Samples of different nodes may be interleaved, but the samples
+ * of each node must be in time order. Only the last sample of each node is kept in
+ * memory.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class OneTraceParser : public TraceSource
+{
+  private:
+    /** @brief A single location sample */
+    struct SAMPLE
+    {
+      double time;
+      double x;
+      double y;
+    };
+    typedef std::map<int,SAMPLE> SAMPLE_MAP_TYPE;
+
+    double          m_minX;
+    double          m_minY;
+    SAMPLE_MAP_TYPE m_lastSamples;
+
+  public:
+    /** @brief Constructor. A zero scenario size disables location validation. */
+    OneTraceParser( double scenarioSizeX, double scenarioSizeY );
+
+    /** @brief Parses a ONE external movement file. Returns false on error. */
+    virtual bool parseFile( const char *filename, TraceSink *sink );
+
+  private:
+    bool _parseHeader( const char *line );
+    bool _parseLine( const char *line, TraceSink *sink );
+};
+
+#endif /* __ONE_TRACE_PARSER_INCLUDED__ */
@@ -0,0 +1,240 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "ParallelTraceParser.h"
+#include "XmlTraceScanner.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief A chunk of the trace and the results of parsing it.
+ *
+ * The parser reads the chunk through the libxml2 I/O callbacks as the concatenation
+ * of the root start tag, the chunk and the root end tag, so no copy of the chunk is
+ * needed.
+ */
+struct TRACE_CHUNK
+{
+  const char        *segments[3];
+  size_t             sizes[3];
+  int                segment;
+  size_t             offset;
+  std::string        rootStart;
+  std::string        rootEnd;
+  XmlTraceParser    *parser;
+  BufferedTraceSink  sink;
+  bool               ok;
+  std::string        error;
+};
+
+static int readChunk( void *context, char *buffer, int len )
+{
+  TRACE_CHUNK *chunk = (TRACE_CHUNK *)context;
+  int count = 0;
+  while ( count < len && chunk->segment < 3 )
+  {
+    size_t left = chunk->sizes[chunk->segment] - chunk->offset;
+    if ( left == 0 )
+    {
+      chunk->segment++;
+      chunk->offset = 0;
+      continue;
+    }
+    size_t n = (size_t)( len - count ) < left ? (size_t)( len - count ) : left;
+    memcpy( buffer + count, chunk->segments[chunk->segment] + chunk->offset, n );
+    chunk->offset += n;
+    count += n;
+  }
+  return count;
+}
+
+static int closeChunk( void *context )
+{
+  return 0;
+}
+
+ParallelTraceParser::ParallelTraceParser( double scenarioSizeX, double scenarioSizeY, int threads )
+{
+  m_scenarioSizeX = scenarioSizeX;
+  m_scenarioSizeY = scenarioSizeY;
+  m_threads = threads;
+  if ( m_threads <= 0 )
+    m_threads = sysconf( _SC_NPROCESSORS_ONLN );
+  if ( m_threads <= 0 )
+    m_threads = 1;
+  m_chunks = 0;
+  m_commandsOnly = false;
+  m_skippedRecords = 0;
+}
+
+bool ParallelTraceParser::parseFile( const char *filename, TraceSink *sink )
+{
+  m_chunks = 1;
+  m_skippedRecords = 0;
+
+  int fd = open( filename, O_RDONLY );
+  if ( fd < 0 )
+  {
+    m_lastError = "Unable to open config file";
+    return false;
+  }
+  struct stat st;
+  if ( fstat( fd, &st ) != 0 || st.st_size == 0 )
+  {
+    close(fd);
+    XmlTraceParser parser( m_scenarioSizeX, m_scenarioSizeY );
+    bool ok = parser.parseFile( filename, sink );
+    m_lastError = parser.lastError();
+    return ok;
+  }
+  size_t size = st.st_size;
+  void *mapping = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close(fd);
+  if ( mapping == MAP_FAILED )
+  {
+    m_lastError = "Unable to map trace file";
+    return false;
+  }
+  const char *base = (const char *)mapping;
+
+  size_t bodyStart = 0, bodyEnd = 0;
+  std::string rootName;
+  XmlTraceScanner::findBody( base, size, rootName, bodyStart, bodyEnd );
+
+  size_t bodySize = bodyEnd > bodyStart ? bodyEnd - bodyStart : 0;
+  int chunks = m_threads;
+  if ( (size_t)chunks > bodySize / MIN_PARALLEL_CHUNK_SIZE )
+    chunks = bodySize / MIN_PARALLEL_CHUNK_SIZE;
+
+  if ( chunks <= 1 )
+  {
+    // Not worth splitting. Use the serial parser.
+    munmap( mapping, size );
+    XmlTraceParser parser( m_scenarioSizeX, m_scenarioSizeY );
+    bool ok = parser.parseFile( filename, sink );
+    m_lastError = parser.lastError();
+    return ok;
+  }
+
+  // Split the body on record boundaries.
+  std::vector<size_t> bounds;
+  bounds.push_back( bodyStart );
+  for ( int i=1; i < chunks; i++ )
+  {
+    size_t nominal = bodyStart + ( bodySize / chunks ) * i;
+    if ( nominal < bounds.back() )
+      nominal = bounds.back();
+    bounds.push_back( XmlTraceScanner::recordEnd( base, nominal, bodyEnd ) );
+  }
+  bounds.push_back( bodyEnd );
+
+  std::vector<TRACE_CHUNK> jobs( chunks );
+  std::vector<XmlTraceParser> parsers( chunks, XmlTraceParser( m_scenarioSizeX, m_scenarioSizeY ) );
+  std::vector<pthread_t> threads( chunks );
+
+  // libxml2 must be initialized before it is used from several threads.
+  xmlInitParser();
+
+  // The first chunk gets the root start tag as in the file, so the size hints on it
+  // are read. Attribute values cannot contain '<'.
+  size_t rootTag = bodyStart - 1;
+  while ( rootTag > 0 && base[rootTag] != '<' )
+    rootTag--;
+
+  for ( int i=0; i < chunks; i++ )
+  {
+    TRACE_CHUNK &job = jobs[i];
+    job.rootStart = i == 0 ? std::string( base + rootTag, bodyStart - rootTag ) : "<" + rootName + ">";
+    job.rootEnd = "</" + rootName + ">";
+    job.segments[0] = job.rootStart.data();
+    job.sizes[0] = job.rootStart.size();
+    job.segments[1] = base + bounds[i];
+    job.sizes[1] = bounds[i+1] - bounds[i];
+    job.segments[2] = job.rootEnd.data();
+    job.sizes[2] = job.rootEnd.size();
+    job.segment = 0;
+    job.offset = 0;
+    job.parser = &parsers[i];
+    job.ok = false;
+    job.sink.commandsOnly = m_commandsOnly;
+    if ( pthread_create( &threads[i], NULL, _parseChunk, &job ) != 0 )
+    {
+      // Parse the chunk on this thread if no more threads can be started.
+      _parseChunk( &job );
+      threads[i] = pthread_self();
+    }
+  }
+  for ( int i=0; i < chunks; i++ )
+    if ( !pthread_equal( threads[i], pthread_self() ) )
+      pthread_join( threads[i], NULL );
+
+  munmap( mapping, size );
+  m_chunks = chunks;
+
+  // Report the first error in file order.
+  for ( int i=0; i < chunks; i++ )
+  {
+    if ( !jobs[i].ok )
+    {
+      m_lastError = jobs[i].error;
+      return false;
+    }
+  }
+
+  // Merge the chunks in file order.
+  if ( jobs[0].sink.traceType != None )
+    sink->beginTrace( jobs[0].sink.traceType, jobs[0].sink.nodesHint, jobs[0].sink.recordsHint );
+  for ( int i=0; i < chunks; i++ )
+  {
+    jobs[i].sink.replay( sink );
+    m_skippedRecords += jobs[i].sink.skippedRecords;
+    // Release the chunk buffers as soon as they have been merged.
+    std::vector<TRACE_COMMAND>().swap( jobs[i].sink.commands );
+    std::vector<WAYPOINT_EVENT>().swap( jobs[i].sink.waypoints );
+    std::vector<CONTACT_EVENT>().swap( jobs[i].sink.contacts );
+  }
+  return true;
+}
+
+void *ParallelTraceParser::_parseChunk( void *arg )
+{
+  TRACE_CHUNK *job = (TRACE_CHUNK *)arg;
+  xmlTextReaderPtr reader = xmlReaderForIO( readChunk, closeChunk, job, NULL, NULL, 0 );
+  if ( reader == NULL )
+  {
+    job->ok = false;
+    job->error = "Unable to create trace reader";
+    return NULL;
+  }
+  job->ok = job->parser->parseReader( reader, &job->sink );
+  job->error = job->parser->lastError();
+  xmlFreeTextReader( reader );
+  return NULL;
+}
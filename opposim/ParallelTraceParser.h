@@ -0,0 +1,88 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __PARALLEL_TRACE_PARSER_INCLUDED__
+#define __PARALLEL_TRACE_PARSER_INCLUDED__
+
+#include <string>
+#include "XmlTraceParser.h"
+
+// Traces smaller than this per thread are not worth splitting
+#define MIN_PARALLEL_CHUNK_SIZE (1024*1024)
+
+/**
+ * @brief Multi-threaded parser for XML mobility and contact traces.
+ *
+ * The trace file is memory mapped and the body of the root element split into one
+ * chunk per thread. Chunk boundaries are moved forward to the end tag of the next
+ * create, destroy, waypoint, contact or break record, so every record is contained in
+ * exactly one chunk. Each chunk is parsed on its own thread by a XmlTraceParser,
+ * wrapped in the root element of the trace, into a BufferedTraceSink.
+ *
+ * The chunks are then replayed into the destination sink in file order. Each chunk
+ * passes on its commands, then its waypoints, then its contacts, so the sink receives
+ * the records of each kind in file order, but not the interleaving of the kinds of a
+ * serial XmlTraceParser. The error reported for an invalid trace is the first one in
+ * the file.
+ *
+ * Records must not be nested in comments or CDATA sections containing record end tags.
+ * Traces generated by the MobiTrace toolbox never are.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class ParallelTraceParser
+{
+  private:
+    double      m_scenarioSizeX;
+    double      m_scenarioSizeY;
+    int         m_threads;
+    int         m_chunks;
+    bool        m_commandsOnly;
+    unsigned long m_skippedRecords;
+    std::string m_lastError;
+
+  public:
+    /** @brief Constructor. Zero threads uses one thread per online processor. */
+    ParallelTraceParser( double scenarioSizeX, double scenarioSizeY, int threads );
+
+    /** @brief Parses a trace file. Returns false on error. */
+    bool parseFile( const char *filename, TraceSink *sink );
+    /** @brief Returns a description of the last error encountered. */
+    const std::string &lastError() const { return m_lastError; }
+    /** @brief Returns the number of chunks the last trace was parsed in */
+    int chunks() const { return m_chunks; }
+    /** @brief Only pass create and destroy commands on to the sink. Waypoints and 
+               contacts are parsed and validated but not buffered. Used when the 
+               records of each node are loaded on demand. */
+    void setCommandsOnly( bool commandsOnly ) { m_commandsOnly = commandsOnly; }
+    /** @brief Returns the number of records not passed on in commands only mode */
+    unsigned long skippedRecords() const { return m_skippedRecords; }
+
+  private:
+    static void *_parseChunk( void *arg );
+};
+
+#endif /* __PARALLEL_TRACE_PARSER_INCLUDED__ */
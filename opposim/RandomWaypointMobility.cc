@@ -52,11 +52,19 @@ void RandomWaypointMobility::initialize(int stage)
   	hasPar("velocitySd") ? m_fSdVelocity = par("velocitySd") : m_fSdVelocity = 0.0;
   	hasPar("pauseTimeMean") ? m_fMeanPause = par("pauseTimeMean") : m_fMeanPause = 0.0;
   	hasPar("pauseTimeSd") ? m_fSdPause = par("pauseTimeSd") : m_fSdPause = 0.0;
+
+    double maxError, minInterval, maxInterval;
+    m_fUpdateInterval = updateInterval;
+    hasPar("maxPositionError") ? maxError = par("maxPositionError") : maxError = 0.0;
+    hasPar("minUpdateInterval") ? minInterval = par("minUpdateInterval") : minInterval = m_fUpdateInterval;
+    hasPar("maxUpdateInterval") ? maxInterval = par("maxUpdateInterval") : maxInterval = m_fUpdateInterval;
+    m_updatePolicy.configure( maxError, minInterval, maxInterval );
   	
   	EV << "   velocity - mean: " << m_fMeanVelocity << endl;
   	EV << "   velocity - sd:   " << m_fSdVelocity << endl;
   	EV << "   pause - mean:    " << m_fMeanPause << endl;
   	EV << "   pause - sd:      " << m_fSdPause << endl;
+  	EV << "   max error:       " << maxError << endl;
   	 	
     _initialize();
   }
@@ -66,10 +74,28 @@ void RandomWaypointMobility::initialize(int stage)
   }
 }
 
+void RandomWaypointMobility::finish()
+{
+  m_updatePolicy.recordScalar("mobility.interval");
+  BasicMobility::finish();
+}
+
+void RandomWaypointMobility::requestResolution( double maxError )
+{
+  Enter_Method_Silent();
+  m_updatePolicy.setObserverError( maxError );
+}
+
 void RandomWaypointMobility::makeMove()
 {
   _updateLocation();	
   move.startTime = simTime();
+
+  // The interval until the next update. A pausing node is next updated when the pause ends.
+  if ( m_fNextMoveTime > simTime() )
+    updateInterval = m_updatePolicy.nextInterval( 0.0, m_fUpdateInterval, m_fNextMoveTime - simTime() );
+  else
+    updateInterval = m_updatePolicy.nextInterval( move.speed, m_fUpdateInterval );
 }
 void RandomWaypointMobility::_updateLocation()
 {
@@ -77,8 +103,12 @@ void RandomWaypointMobility::_updateLocation()
 	if ( _checkOffMap() )
 		_pickWaypoint();
 
-  // Calculate the delta time from the last update
-	double fDeltaTime = simTime() - m_tLastUpdate;
+  // Calculate the delta time from the last update. With adaptive intervals the update
+  // ending a pause may come long after it, so the node only moves from its end.
+	simtime_t moveStart = m_tLastUpdate;
+	if ( m_updatePolicy.enabled() && m_fNextMoveTime > m_tLastUpdate )
+	  moveStart = m_fNextMoveTime;
+	double fDeltaTime = simTime() - moveStart;
 	m_tLastUpdate = simTime();
 
   // Dont do anyting if we are currently pausing
@@ -44,6 +44,7 @@
 
 #include <omnetpp.h>
 #include <BasicMobility.h>
+#include "AdaptiveUpdatePolicy.h"
 
 // The minimum velocity of the normal distribution
 #define MIN_VELOCITY  0.5
@@ -75,11 +76,16 @@
  * fixed at 0.5 m/s. Otherwise, a number of stuck nodes (ones with zero or very
  * low velocity) is expected during a prolonged simulation.
  *
+ * With a maximum position error set, the interval until the next update is chosen
+ * from the speed of the node, see AdaptiveUpdatePolicy. A pausing node is next 
+ * updated when the pause ends.
+ *
  * @author Kristjan V. Jonsson
  */
 class  RandomWaypointMobility : public BasicMobility
 {
-  protected:        
+  protected:
+        
     /** @brief Target position of the host - the next waypoint*/
     Coord targetPos;
     
@@ -96,12 +102,20 @@ class  RandomWaypointMobility : public BasicMobility
 		simtime_t m_fNextMoveTime; 
 		/** Last update time. Used to calculate the distance to interpolate between waypoints. */
 		simtime_t m_tLastUpdate; 
+		/** The fixed update interval */
+		double m_fUpdateInterval;
+		/** Chooses the interval until the next update */
+		AdaptiveUpdatePolicy m_updatePolicy;
 		
   public:
     Module_Class_Members( RandomWaypointMobility, BasicMobility, 0 );
 
     /** @brief Initializes mobility model parameters. */
     virtual void initialize(int);
+    /** @brief Records the chosen update intervals */
+    virtual void finish();
+    /** @brief Requests updates at least this accurate in meters. Zero clears the request. */
+    void requestResolution( double maxError );
 
   protected:
     /** @brief Move the host */
@@ -0,0 +1,165 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "TraceCache.h"
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// FNV-1a 64 bit hash parameters
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME        1099511628211ULL
+
+static void hashBytes( uint64_t &hash, const void *data, size_t size )
+{
+  const unsigned char *p = (const unsigned char *)data;
+  for ( size_t i=0; i < size; i++ )
+  {
+    hash ^= p[i];
+    hash *= FNV_PRIME;
+  }
+}
+
+TraceCache::TraceCache( const char *directory, bool shared )
+{
+  m_directory = directory;
+  m_shared = shared;
+  m_lockFd = -1;
+  m_hit = false;
+}
+
+TraceCache::~TraceCache()
+{
+  release();
+}
+
+bool TraceCache::lookup( const char *traceFile, double scenarioSizeX, double scenarioSizeY )
+{
+  release();
+  m_hit = false;
+
+  uint64_t hash = FNV_OFFSET_BASIS;
+  if ( !_hashFile( traceFile, hash ) )
+    return false;
+  uint32_t version = BINARY_TRACE_VERSION;
+  hashBytes( hash, &version, sizeof(version) );
+  hashBytes( hash, &scenarioSizeX, sizeof(scenarioSizeX) );
+  hashBytes( hash, &scenarioSizeY, sizeof(scenarioSizeY) );
+
+  if ( mkdir( m_directory.c_str(), 0777 ) != 0 && errno != EEXIST )
+  {
+    m_lastError = "Unable to create trace cache directory " + m_directory;
+    return false;
+  }
+  char name[32];
+  sprintf( name, "/%016llx.bin", (unsigned long long)hash );
+  m_path = m_directory + name;
+
+  if ( m_shared )
+  {
+    // Blocks while another process is compiling the same trace
+    std::string lockPath = m_path + ".lock";
+    m_lockFd = open( lockPath.c_str(), O_RDWR | O_CREAT, 0666 );
+    if ( m_lockFd < 0 || flock( m_lockFd, LOCK_EX ) != 0 )
+    {
+      release();
+      m_lastError = "Unable to lock trace cache entry " + lockPath;
+      return false;
+    }
+  }
+
+  // A missing, truncated or otherwise invalid entry is a miss and is replaced.
+  BinaryTraceReader reader;
+  m_hit = reader.open( m_path.c_str() );
+  return true;
+}
+
+bool TraceCache::store( BinaryTraceWriter &writer )
+{
+  char suffix[32];
+  sprintf( suffix, ".%d.tmp", (int)getpid() );
+  std::string tmpPath = m_path + suffix;
+  if ( !writer.write( tmpPath.c_str() ) )
+  {
+    m_lastError = writer.lastError();
+    unlink( tmpPath.c_str() );
+    return false;
+  }
+  if ( rename( tmpPath.c_str(), m_path.c_str() ) != 0 )
+  {
+    m_lastError = "Unable to store trace cache entry " + m_path;
+    unlink( tmpPath.c_str() );
+    return false;
+  }
+  return true;
+}
+
+void TraceCache::release()
+{
+  if ( m_lockFd >= 0 )
+  {
+    flock( m_lockFd, LOCK_UN );
+    close( m_lockFd );
+  }
+  m_lockFd = -1;
+}
+
+bool TraceCache::_hashFile( const char *filename, uint64_t &hash )
+{
+  int fd = open( filename, O_RDONLY );
+  if ( fd < 0 )
+  {
+    m_lastError = "Unable to open config file";
+    return false;
+  }
+  struct stat st;
+  if ( fstat( fd, &st ) != 0 )
+  {
+    close(fd);
+    m_lastError = "Unable to open config file";
+    return false;
+  }
+  if ( st.st_size == 0 )
+  {
+    close(fd);
+    return true;
+  }
+  void *base = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close(fd);
+  if ( base == MAP_FAILED )
+  {
+    m_lastError = "Unable to map trace file";
+    return false;
+  }
+  madvise( base, st.st_size, MADV_SEQUENTIAL );
+  hashBytes( hash, base, st.st_size );
+  munmap( base, st.st_size );
+  return true;
+}
@@ -0,0 +1,87 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __TRACE_CACHE_INCLUDED__
+#define __TRACE_CACHE_INCLUDED__
+
+#include <stdint.h>
+#include <string>
+#include "BinaryTrace.h"
+
+/**
+ * @brief Cache of compiled XML traces, reused across simulation runs.
+ *
+ * A XML trace is compiled once into a binary trace (see BinaryTrace.h) stored in the
+ * cache directory. The cache key is a hash of the trace file content, the scenario
+ * size the trace was validated against and the binary trace version, so a changed
+ * trace or scenario never hits a stale entry.
+ *
+ * Entries are written to a temporary file and renamed into place, so a reader never
+ * sees a partially written entry. In shared mode an exclusive lock is held on the
+ * entry from lookup until the entry has been stored. Concurrent processes running the
+ * same trace then wait for the first one to compile it rather than all compiling it.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class TraceCache
+{
+  private:
+    std::string m_directory;
+    bool        m_shared;
+    std::string m_path;
+    int         m_lockFd;
+    bool        m_hit;
+    std::string m_lastError;
+
+  public:
+    /** @brief Constructor. Entries are stored in the given directory. */
+    TraceCache( const char *directory, bool shared );
+    ~TraceCache();
+
+    /** @brief Looks up the entry of a trace file compiled for a scenario size. In
+               shared mode the entry is locked until release() is called. Returns
+               false on error. */
+    bool lookup( const char *traceFile, double scenarioSizeX, double scenarioSizeY );
+    /** @brief True if the last lookup found a valid entry */
+    bool hit() const { return m_hit; }
+    /** @brief The file name of the entry of the last lookup */
+    const std::string &path() const { return m_path; }
+    /** @brief Stores a compiled trace as the entry of the last lookup. Returns false
+               on error. */
+    bool store( BinaryTraceWriter &writer );
+    /** @brief Releases the lock on the entry of the last lookup, if any */
+    void release();
+    /** @brief Returns a description of the last error encountered. */
+    const std::string &lastError() const { return m_lastError; }
+
+  private:
+    bool _hashFile( const char *filename, uint64_t &hash );
+
+    TraceCache( const TraceCache& );
+    TraceCache &operator=( const TraceCache& );
+};
+
+#endif /* __TRACE_CACHE_INCLUDED__ */
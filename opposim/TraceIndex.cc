@@ -0,0 +1,378 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "TraceIndex.h"
+#include "BinaryTrace.h"
+#include "XmlTraceParser.h"
+#include "XmlTraceScanner.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+TraceIndex::TraceIndex()
+{
+  m_binary = false;
+  m_traceType = None;
+  m_base = NULL;
+  m_size = 0;
+  m_fromSidecar = false;
+}
+
+TraceIndex::~TraceIndex()
+{
+  close();
+}
+
+bool TraceIndex::open( const char *traceFile, bool binary )
+{
+  close();
+  m_traceFile = traceFile;
+  m_binary = binary;
+
+  int fd = ::open( traceFile, O_RDONLY );
+  if ( fd < 0 )
+  {
+    m_lastError = "Unable to open trace file";
+    return false;
+  }
+  struct stat st;
+  if ( fstat( fd, &st ) != 0 || st.st_size == 0 )
+  {
+    ::close(fd);
+    m_lastError = "Trace file is empty";
+    return false;
+  }
+  void *base = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  ::close(fd);
+  if ( base == MAP_FAILED )
+  {
+    m_lastError = "Unable to map trace file";
+    return false;
+  }
+  m_base = (const char *)base;
+  m_size = st.st_size;
+
+  // Records are read a node at a time, scattered over the file
+  madvise( base, m_size, MADV_RANDOM );
+
+  std::string sidecar = m_traceFile + TRACE_INDEX_SUFFIX;
+  if ( _readSidecar( sidecar, st.st_size, st.st_mtime ) )
+  {
+    m_fromSidecar = true;
+    return true;
+  }
+
+  if ( !_build() )
+  {
+    close();
+    return false;
+  }
+  // Saving the index is an optimization for later runs. Failure is not an error.
+  _writeSidecar( sidecar, st.st_size, st.st_mtime );
+  return true;
+}
+
+void TraceIndex::close()
+{
+  if ( m_base != NULL )
+    munmap( (void *)m_base, m_size );
+  m_base = NULL;
+  m_size = 0;
+  m_nodes.clear();
+  std::vector<uint64_t>().swap( m_offsets );
+  m_traceType = None;
+  m_fromSidecar = false;
+}
+
+bool TraceIndex::loadNode( int nodeId, TraceSink *sink, double scenarioSizeX, double scenarioSizeY )
+{
+  return loadNodes( std::vector<int>( 1, nodeId ), sink, scenarioSizeX, scenarioSizeY );
+}
+
+bool TraceIndex::loadNodes( const std::vector<int> &nodeIds, TraceSink *sink, double scenarioSizeX, double scenarioSizeY )
+{
+  if ( m_binary )
+  {
+    for ( unsigned int n=0; n < nodeIds.size(); n++ )
+    {
+      NODE_ENTRY_MAP_TYPE::iterator iter = m_nodes.find( nodeIds[n] );
+      if ( iter == m_nodes.end() )
+        continue;
+      const TRACE_INDEX_ENTRY &entry = iter->second;
+      for ( uint64_t i=entry.first; i < entry.first + entry.count; i++ )
+      {
+        if ( m_traceType == MobilityTrace )
+        {
+          const BINARY_WAYPOINT_RECORD *rec = (const BINARY_WAYPOINT_RECORD *)( m_base + m_offsets[i] );
+          if ( ( scenarioSizeX != 0 && ( rec->x < 0.0 || rec->x > scenarioSizeX ) ) ||
+               ( scenarioSizeY != 0 && ( rec->y < 0.0 || rec->y > scenarioSizeY ) ) )
+          {
+            m_lastError = "Location of node out of bounds";
+            return false;
+          }
+          WAYPOINT_EVENT waypoint;
+          waypoint.id = rec->nodeId;
+          waypoint.time = rec->time;
+          waypoint.x = rec->x;
+          waypoint.y = rec->y;
+          waypoint.speed = rec->speed;
+          sink->addWaypoint( waypoint );
+        }
+        else
+        {
+          const BINARY_CONTACT_RECORD *rec = (const BINARY_CONTACT_RECORD *)( m_base + m_offsets[i] );
+          CONTACT_EVENT contact;
+          contact.type = (ContactEventType)rec->type;
+          contact.id = rec->nodeId;
+          contact.time = rec->time;
+          contact.peerId = rec->peerId;
+          sink->addContact( contact );
+        }
+      }
+    }
+    return true;
+  }
+
+  // Gather the XML records of the nodes into a single document and parse it.
+  std::string root = m_traceType == ContactTrace ? "contact-trace" : "mobility-trace";
+  std::string document = "<" + root + ">";
+  bool empty = true;
+  for ( unsigned int n=0; n < nodeIds.size(); n++ )
+  {
+    NODE_ENTRY_MAP_TYPE::iterator iter = m_nodes.find( nodeIds[n] );
+    if ( iter == m_nodes.end() )
+      continue;
+    const TRACE_INDEX_ENTRY &entry = iter->second;
+    for ( uint64_t i=entry.first; i < entry.first + entry.count; i++ )
+    {
+      size_t start = m_offsets[i];
+      size_t end = XmlTraceScanner::recordEnd( m_base, start, m_size );
+      document.append( m_base + start, end - start );
+    }
+    empty = false;
+  }
+  if ( empty )
+    return true;
+  document += "</" + root + ">";
+
+  BufferedTraceSink records;
+  XmlTraceParser parser( scenarioSizeX, scenarioSizeY );
+  if ( !parser.parseMemory( document.data(), document.size(), &records ) )
+  {
+    m_lastError = parser.lastError();
+    return false;
+  }
+  records.replay( sink );
+  return true;
+}
+
+bool TraceIndex::_build()
+{
+  std::map<int, std::vector<uint64_t> > nodeOffsets;
+  bool ok = m_binary ? _buildBinary( nodeOffsets ) : _buildXml( nodeOffsets );
+  if ( !ok )
+    return false;
+
+  // Store the offsets grouped by node, in file order within each node.
+  unsigned long total = 0;
+  std::map<int, std::vector<uint64_t> >::iterator iter;
+  for ( iter = nodeOffsets.begin(); iter != nodeOffsets.end(); iter++ )
+    total += iter->second.size();
+  m_offsets.reserve( total );
+  for ( iter = nodeOffsets.begin(); iter != nodeOffsets.end(); iter++ )
+  {
+    TRACE_INDEX_ENTRY entry;
+    entry.nodeId = iter->first;
+    entry.reserved = 0;
+    entry.first = m_offsets.size();
+    entry.count = iter->second.size();
+    m_offsets.insert( m_offsets.end(), iter->second.begin(), iter->second.end() );
+    std::vector<uint64_t>().swap( iter->second );
+    m_nodes[entry.nodeId] = entry;
+  }
+  return true;
+}
+
+bool TraceIndex::_buildXml( std::map<int, std::vector<uint64_t> > &nodeOffsets )
+{
+  std::string rootName;
+  size_t bodyStart, bodyEnd;
+  if ( !XmlTraceScanner::findBody( m_base, m_size, rootName, bodyStart, bodyEnd ) )
+  {
+    m_lastError = "No trace found in the trace file";
+    return false;
+  }
+  for ( unsigned int i=0; i < rootName.size(); i++ )
+    rootName[i] = tolower(rootName[i]);
+  if ( rootName == "mobility-trace" )
+    m_traceType = MobilityTrace;
+  else if ( rootName == "contact-trace" )
+    m_traceType = ContactTrace;
+  else
+  {
+    m_lastError = "Unspecified or unsupported trace";
+    return false;
+  }
+
+  std::string name;
+  size_t pos = bodyStart;
+  while ( pos < bodyEnd )
+  {
+    size_t start = XmlTraceScanner::nextRecord( m_base, pos, bodyEnd, name );
+    if ( start >= bodyEnd )
+      break;
+    size_t end = XmlTraceScanner::recordEnd( m_base, start, bodyEnd );
+    if ( ( m_traceType == MobilityTrace && name == "waypoint" ) ||
+         ( m_traceType == ContactTrace && ( name == "contact" || name == "break" ) ) )
+    {
+      int nodeId = XmlTraceScanner::recordNodeId( m_base, start, end );
+      nodeOffsets[nodeId].push_back( start );
+    }
+    pos = end;
+  }
+  return true;
+}
+
+bool TraceIndex::_buildBinary( std::map<int, std::vector<uint64_t> > &nodeOffsets )
+{
+  BinaryTraceReader reader;
+  if ( !reader.open( m_traceFile.c_str() ) )
+  {
+    m_lastError = reader.lastError();
+    return false;
+  }
+  const BINARY_TRACE_HEADER *header = reader.header();
+  m_traceType = header->traceType == BINARY_CONTACT_TRACE ? ContactTrace : MobilityTrace;
+
+  uint64_t offset = sizeof(BINARY_TRACE_HEADER) + (uint64_t)header->commandCount * sizeof(BINARY_COMMAND_RECORD);
+  const BINARY_WAYPOINT_RECORD *waypoint = reader.waypoints();
+  for ( uint32_t i=0; i < header->waypointCount; i++, waypoint++ )
+  {
+    nodeOffsets[waypoint->nodeId].push_back( offset );
+    offset += sizeof(BINARY_WAYPOINT_RECORD);
+  }
+  const BINARY_CONTACT_RECORD *contact = reader.contacts();
+  for ( uint32_t i=0; i < header->contactCount; i++, contact++ )
+  {
+    nodeOffsets[contact->nodeId].push_back( offset );
+    offset += sizeof(BINARY_CONTACT_RECORD);
+  }
+  return true;
+}
+
+bool TraceIndex::_readSidecar( const std::string &filename, uint64_t traceSize, int64_t traceModified )
+{
+  FILE *f = fopen( filename.c_str(), "rb" );
+  if ( f == NULL )
+    return false;
+
+  TRACE_INDEX_HEADER header;
+  bool ok = fread( &header, sizeof(header), 1, f ) == 1 &&
+            header.magic == TRACE_INDEX_MAGIC &&
+            header.version == TRACE_INDEX_VERSION &&
+            header.traceSize == traceSize &&
+            header.traceModified == traceModified;
+
+  // The counts of a truncated or corrupt sidecar must not be allocated from
+  struct stat st;
+  if ( ok )
+    ok = fstat( fileno(f), &st ) == 0 && (uint64_t)st.st_size >= sizeof(header);
+  if ( ok )
+  {
+    uint64_t body = st.st_size - sizeof(header);
+    ok = header.nodeCount <= body / sizeof(TRACE_INDEX_ENTRY);
+    if ( ok )
+      body -= (uint64_t)header.nodeCount * sizeof(TRACE_INDEX_ENTRY);
+    ok = ok && header.offsetCount <= body / sizeof(uint64_t);
+  }
+  if ( ok )
+  {
+    std::vector<TRACE_INDEX_ENTRY> entries( header.nodeCount );
+    m_offsets.resize( header.offsetCount );
+    if ( header.nodeCount > 0 )
+      ok = fread( &entries[0], sizeof(TRACE_INDEX_ENTRY), header.nodeCount, f ) == header.nodeCount;
+    if ( ok && header.offsetCount > 0 )
+      ok = fread( &m_offsets[0], sizeof(uint64_t), header.offsetCount, f ) == header.offsetCount;
+    for ( uint32_t i=0; ok && i < header.nodeCount; i++ )
+    {
+      ok = entries[i].first + entries[i].count <= header.offsetCount;
+      m_nodes[entries[i].nodeId] = entries[i];
+    }
+    for ( uint64_t i=0; ok && i < header.offsetCount; i++ )
+      ok = m_offsets[i] < m_size;
+    m_traceType = (TRACE_TYPE)header.traceType;
+  }
+  fclose(f);
+
+  if ( !ok )
+  {
+    m_nodes.clear();
+    std::vector<uint64_t>().swap( m_offsets );
+    m_traceType = None;
+  }
+  return ok;
+}
+
+bool TraceIndex::_writeSidecar( const std::string &filename, uint64_t traceSize, int64_t traceModified )
+{
+  // Write to a temporary file and rename it, so that concurrent runs never read a
+  // partially written index.
+  char suffix[32];
+  sprintf( suffix, ".%d.tmp", (int)getpid() );
+  std::string tmpname = filename + suffix;
+  FILE *f = fopen( tmpname.c_str(), "wb" );
+  if ( f == NULL )
+    return false;
+
+  TRACE_INDEX_HEADER header;
+  memset( &header, 0, sizeof(header) );
+  header.magic = TRACE_INDEX_MAGIC;
+  header.version = TRACE_INDEX_VERSION;
+  header.traceSize = traceSize;
+  header.traceModified = traceModified;
+  header.traceType = m_traceType;
+  header.nodeCount = m_nodes.size();
+  header.offsetCount = m_offsets.size();
+
+  bool ok = fwrite( &header, sizeof(header), 1, f ) == 1;
+  NODE_ENTRY_MAP_TYPE::iterator iter;
+  for ( iter = m_nodes.begin(); ok && iter != m_nodes.end(); iter++ )
+    ok = fwrite( &iter->second, sizeof(TRACE_INDEX_ENTRY), 1, f ) == 1;
+  if ( ok && !m_offsets.empty() )
+    ok = fwrite( &m_offsets[0], sizeof(uint64_t), m_offsets.size(), f ) == m_offsets.size();
+  if ( fclose(f) != 0 )
+    ok = false;
+
+  if ( !ok || rename( tmpname.c_str(), filename.c_str() ) != 0 )
+  {
+    unlink( tmpname.c_str() );
+    return false;
+  }
+  return true;
+}
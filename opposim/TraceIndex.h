@@ -0,0 +1,136 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __TRACE_INDEX_INCLUDED__
+#define __TRACE_INDEX_INCLUDED__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include "TraceSink.h"
+
+#define TRACE_INDEX_MAGIC    0x58445049  // "IPDX" when stored little endian
+#define TRACE_INDEX_VERSION  1
+// The index of a trace file is stored next to it with this suffix
+#define TRACE_INDEX_SUFFIX   ".idx"
+
+/**
+ * @brief Header of a trace index sidecar file.
+ *
+ * The trace size and modification time are used to detect a stale index. The header is
+ * followed by nodeCount TRACE_INDEX_ENTRY structures and offsetCount 64 bit offsets.
+ */
+struct TRACE_INDEX_HEADER
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t traceSize;
+  int64_t  traceModified;
+  uint32_t traceType;     /**< A TRACE_TYPE value */
+  uint32_t nodeCount;
+  uint64_t offsetCount;
+};
+
+/**
+ * @brief The records of a single node in a trace index. The node's record offsets are
+ *        offsets [first,first+count) of the offset table.
+ */
+struct TRACE_INDEX_ENTRY
+{
+  int32_t  nodeId;
+  uint32_t reserved;
+  uint64_t first;
+  uint64_t count;
+};
+
+/**
+ * @brief Index of the waypoint or contact records of each node in a trace file.
+ *
+ * The index stores the byte offset of every waypoint or contact record in the trace
+ * file, grouped by node id. It allows the records of a single node to be read from the
+ * trace when the node is created, rather than keeping the records of all nodes in
+ * memory for the whole run. Both XML and binary traces can be indexed.
+ *
+ * The index is saved in a sidecar file next to the trace, and reused by later runs
+ * as long as the size and modification time of the trace are unchanged. The trace file
+ * is kept memory mapped while the index is open.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class TraceIndex
+{
+  private:
+    typedef std::map<int,TRACE_INDEX_ENTRY> NODE_ENTRY_MAP_TYPE;
+
+    std::string          m_traceFile;
+    bool                 m_binary;
+    TRACE_TYPE           m_traceType;
+    /** @brief Start and size of the trace file mapping */
+    const char          *m_base;
+    size_t               m_size;
+    NODE_ENTRY_MAP_TYPE  m_nodes;
+    std::vector<uint64_t> m_offsets;
+    /** @brief True if the index was read from an up to date sidecar file */
+    bool                 m_fromSidecar;
+    std::string          m_lastError;
+
+  public:
+    TraceIndex();
+    ~TraceIndex();
+
+    /** @brief Opens the index of a trace file, reading it from the sidecar file if it is
+               up to date and building and saving it otherwise. Returns false on error. */
+    bool open( const char *traceFile, bool binary );
+    /** @brief Closes the index and unmaps the trace file */
+    void close();
+
+    /** @brief Reads the records of a node from the trace file and passes them to the
+               sink. Locations are validated against the scenario size. Returns false
+               on error. */
+    bool loadNode( int nodeId, TraceSink *sink, double scenarioSizeX, double scenarioSizeY );
+    /** @brief Reads the records of several nodes, node by node. The XML records of all
+               the nodes are parsed as a single document. Returns false on error. */
+    bool loadNodes( const std::vector<int> &nodeIds, TraceSink *sink, double scenarioSizeX, double scenarioSizeY );
+
+    TRACE_TYPE traceType() const { return m_traceType; }
+    unsigned long nodes() const { return m_nodes.size(); }
+    unsigned long records() const { return m_offsets.size(); }
+    bool fromSidecar() const { return m_fromSidecar; }
+    const std::string &lastError() const { return m_lastError; }
+
+  private:
+    bool _build();
+    bool _buildXml( std::map<int, std::vector<uint64_t> > &nodeOffsets );
+    bool _buildBinary( std::map<int, std::vector<uint64_t> > &nodeOffsets );
+    bool _readSidecar( const std::string &filename, uint64_t traceSize, int64_t traceModified );
+    bool _writeSidecar( const std::string &filename, uint64_t traceSize, int64_t traceModified );
+
+    TraceIndex( const TraceIndex& );
+    TraceIndex &operator=( const TraceIndex& );
+};
+
+#endif /* __TRACE_INDEX_INCLUDED__ */
@@ -26,6 +26,7 @@
 // ***************************************************************************
  
 #include "TraceMobility.h"
+#include "MobilityManager.h"
 #include <FWMath.h>
 
 //#define __TRACE_MOBILITY_DEBUG__
@@ -38,7 +39,37 @@ void TraceMobility::initialize(int stage)
 
   if (stage == 0)
   {        
-    updateInterval = par("updateInterval");
+    m_updateInterval = par("updateInterval");
+    updateInterval = m_updateInterval;
+    double maxError, minInterval, maxInterval;
+    hasPar("maxPositionError") ? maxError = par("maxPositionError") : maxError = 0.0;
+    hasPar("minUpdateInterval") ? minInterval = par("minUpdateInterval") : minInterval = m_updateInterval;
+    hasPar("maxUpdateInterval") ? maxInterval = par("maxUpdateInterval") : maxInterval = m_updateInterval;
+    m_updatePolicy.configure( maxError, minInterval, maxInterval );
+
+    std::string encodingName;
+    WAYPOINT_ENCODING encoding;
+    hasPar("waypointEncoding") ? encodingName = (const char *)par("waypointEncoding") : encodingName = "double";
+    if ( !WaypointStore::parseEncoding( encodingName, encoding ) )
+      error("Unknown waypoint encoding %s. Use double, float or delta.", encodingName.c_str());
+    m_eventList.setEncoding( encoding );
+
+    hasPar("analytic") ? m_analytic = par("analytic") : m_analytic = false;
+
+    // Managed nodes are moved by the mobility manager of the network
+    bool managed;
+    hasPar("managed") ? managed = par("managed") : managed = false;
+    m_manager = NULL;
+    m_managerSlot = MOBILITY_ENGINE_NO_SLOT;
+    if ( managed )
+    {
+      if ( m_analytic )
+        error("A managed node can not use analytic mode");
+      cModule *manager = findHost()->parentModule()->submodule("mobilityManager");
+      if ( manager == NULL )
+        error("Mobility manager not found");
+      m_manager = check_and_cast<MobilityManager*>(manager);
+    }
     moveCategory = bb->getCategory(&move);
 
     // Initialize the start position
@@ -49,6 +80,7 @@ void TraceMobility::initialize(int stage)
     ev << "    initial x:       " << move.startPos.x << endl;
     ev << "    initial y:       " << move.startPos.y << endl;
     ev << "    update interval: " << updateInterval << endl;
+    ev << "    analytic:        " << m_analytic << endl;
     ev << "    debug:           " << debug << endl;
       
     // Set initial move data
@@ -58,6 +90,10 @@ void TraceMobility::initialize(int stage)
     move.direction = Coord(0,0);
     
     m_curWaypoint = 0; 
+    m_moving = false;
+    m_targetSpeed = 0;
+    // A recycled module may hold waypoints of its previous node
+    m_eventList.clear();
 
     // Update blackboard & screen position
     updatePosition();
@@ -73,12 +109,24 @@ void TraceMobility::initialize(int stage)
 
 void TraceMobility::finish()
 {
+  m_updatePolicy.recordScalar("mobility.interval");
+  if ( m_manager != NULL && m_managerSlot != MOBILITY_ENGINE_NO_SLOT )
+    m_manager->removeNode( m_managerSlot );
+  m_managerSlot = MOBILITY_ENGINE_NO_SLOT;
   cancelAndDelete(updateEvent);
+  updateEvent = NULL;
 }
 
 void TraceMobility::handleMessage(cMessage *msg)
 {
-  if ( msg == updateEvent )
+  if ( msg == updateEvent && m_analytic )
+  {
+    if ( m_moving )
+      arrive();
+    else
+      startMovement();
+  }
+  else if ( msg == updateEvent )
   {
     makeMove();
     updatePosition();
@@ -114,8 +162,7 @@ void TraceMobility::makeMove()
     // Schedule a new event if any remain
     if ( !m_eventList.empty() )
     {
-      WAYPOINT_EVENT waypoint = m_eventList.front();
-      m_eventList.pop_front();
+      WAYPOINT waypoint = m_eventList.next();
 
       #ifdef __TRACE_MOBILITY_DEBUG__
       ev << "    (" << simTime() << ") new position: x=" << waypoint.x << " y=" << waypoint.y 
@@ -144,6 +191,20 @@ void TraceMobility::setTarget(double time, double x, double y, double speed )
   double activateTime = time;
   if ( activateTime < simTime() )
     activateTime = simTime();
+
+  if ( m_analytic )
+  {
+    // The node rests at its present position until the waypoint is activated
+    _targetPos = newTarget;
+    m_targetSpeed = speed;
+    if ( updateEvent->isScheduled() )
+      cancelEvent( updateEvent );
+    if ( activateTime > simTime() )
+      scheduleAt( activateTime, updateEvent );
+    else
+      startMovement();
+    return;
+  }
     
   // Set the target position and distance to target
   _targetPos = newTarget;
@@ -151,7 +212,8 @@ void TraceMobility::setTarget(double time, double x, double y, double speed )
   move.speed = speed; 
   double travelTime = distance / move.speed;
 
-  // Get the number of steps needed to be covered.
+  // Get the number of steps needed to be covered, at an interval fitting the speed
+  updateInterval = m_updatePolicy.nextInterval( speed, m_updateInterval );
   _numSteps = static_cast<int>(ceil(travelTime/updateInterval));
     
   _stepSize = (_targetPos - move.startPos)/_numSteps;
@@ -171,36 +233,101 @@ void TraceMobility::setTarget(double time, double x, double y, double speed )
   scheduleAt( activateTime, updateEvent );
 }
 
-void TraceMobility::initializeTrace( const waypointEventsList *eventList )
+void TraceMobility::startMovement()
+{
+  double distance = move.startPos.distance(_targetPos);
+  // A waypoint at the present position or without speed is reached at once
+  if ( distance == 0.0 || m_targetSpeed <= 0.0 )
+  {
+    arrive();
+    return;
+  }
+
+  move.startTime = simTime();
+  move.speed = m_targetSpeed;
+  move.setDirection(_targetPos);
+  m_moving = true;
+  updatePosition();
+
+  #ifdef __TRACE_MOBILITY_DEBUG__
+  ev << fullPath() << ": (" << simTime() << ") WP=" << m_curWaypoint << " moving to " << _targetPos.info()
+                   << " arrival=" << simTime() + distance / m_targetSpeed << endl;
+  #endif
+  scheduleAt( simTime() + distance / m_targetSpeed, updateEvent );
+}
+
+void TraceMobility::arrive()
+{
+  move.startPos = _targetPos;
+  move.startTime = simTime();
+  move.speed = 0;
+  m_moving = false;
+  updatePosition();
+
+  if ( !m_eventList.empty() )
+  {
+    WAYPOINT waypoint = m_eventList.next();
+    setTarget( waypoint.time, waypoint.x, waypoint.y, waypoint.speed );
+  }
+}
+
+void TraceMobility::managedMove( const Coord &position, double speed, const Coord &target )
+{
+  Enter_Method_Silent();
+  move.startPos = position;
+  move.startTime = simTime();
+  move.speed = speed;
+  if ( speed > 0 )
+    move.setDirection(target);
+  updatePosition();
+}
+
+void TraceMobility::requestResolution( double maxError )
+{
+  Enter_Method_Silent();
+  m_updatePolicy.setObserverError( maxError );
+}
+
+Coord TraceMobility::positionAt( simtime_t time ) const
+{
+  if ( move.speed == 0 || time <= move.startTime )
+    return move.startPos;
+  return move.startPos + move.direction * ( move.speed * ( time - move.startTime ) );
+}
+
+void TraceMobility::initializeTrace( waypointEventsVector *eventList )
 {
   Enter_Method_Silent();
   
   if ( eventList == NULL )
     return;
     
-  // Copy the given event list to the internal list.
-  m_eventList.resize(eventList->size());
-  std::copy(eventList->begin(),eventList->end(),m_eventList.begin());
-
-  WAYPOINT_EVENT waypoint;
+  WAYPOINT waypoint;
   
   #ifdef __TRACE_MOBILITY_DEBUG__  
-  waypointEventsList::iterator i = m_eventList.begin();
-  for(; i != m_eventList.end();i++)
+  waypointEventsVector::const_iterator i = eventList->begin();
+  for(; i != eventList->end();i++)
   {
     waypoint = (*i);
-    ev << "event: id=" << waypoint.id << " time=" << waypoint.time
+    ev << "event: time=" << waypoint.time
        << " x=" << waypoint.x << " y=" << waypoint.y
        << " speed=" << waypoint.speed << endl;
   }  
   #endif  
       
-  if ( m_eventList.size() != 0 )
+  // Take over the given events, or hand them to the manager which keeps the waypoints
+  // of managed nodes
+  if ( eventList->size() != 0 && m_manager != NULL )
+  {
+    m_managerSlot = m_manager->addNode( this, move.startPos, *eventList );
+    return;
+  }
+  m_eventList.adopt(*eventList);
+  if ( !m_eventList.empty() )
   {
-    waypoint = m_eventList.front();
-    m_eventList.pop_front();
+    waypoint = m_eventList.next();
     #ifdef __TRACE_MOBILITY_DEBUG__  
-    ev << "First scheduled event: id=" << waypoint.id << " time=" << waypoint.time
+    ev << "First scheduled event: time=" << waypoint.time
        << " x=" << waypoint.x << " y=" << waypoint.y
        << " speed=" << waypoint.speed << endl;
     #endif    
@@ -31,6 +31,10 @@
 #include <omnetpp.h>
 #include <BasicMobility.h>
 #include "TraceTypes.h"
+#include "AdaptiveUpdatePolicy.h"
+#include "CompactTrace.h"
+
+class MobilityManager;
 
 /**
  * @brief Trace mobility module. 
@@ -44,6 +48,18 @@
  * with its waypoint list and an optional destroy event. 
  * The mobility module is then autonomous for the duration of its lifetime.
  *
+ * By default the position is updated every updateInterval seconds while the node
+ * moves. In analytic mode the only events are the activation of each waypoint and
+ * the arrival at it. The movement in progress is published as its start position,
+ * start time, direction and speed, and positionAt() computes the position from it.
+ *
+ * With a maximum position error set, the update interval of the stepped mode is 
+ * chosen for each movement from its speed, see AdaptiveUpdatePolicy.
+ *
+ * With the managed parameter set, the module is a proxy of the MobilityManager of
+ * the network. The manager moves the node along with all other managed nodes and 
+ * calls managedMove() when its movement changes, which publishes it.
+ *
  * @version 1.0 
  * @author  Olafur R. Helgason
  * @author  Kristjan V. Jonsson
@@ -53,6 +69,20 @@ class TraceMobility : public BasicMobility
   private:
     /** @brief The update interval in seconds */
 		double m_updateInterval;
+    /** @brief Compute the position from the movement in progress instead of updating it
+               every update interval */
+    bool m_analytic;
+    /** @brief True while moving towards the target in analytic mode. The update event
+               is then the arrival, otherwise the activation of the target waypoint. */
+    bool m_moving;
+    /** @brief The speed of the movement towards the target waypoint in analytic mode */
+    double m_targetSpeed;
+    /** @brief Chooses the update interval of each movement in the stepped mode */
+    AdaptiveUpdatePolicy m_updatePolicy;
+    /** @brief The manager moving the node in managed mode, NULL otherwise */
+    MobilityManager *m_manager;
+    /** @brief The slot of the node in the manager, MOBILITY_ENGINE_NO_SLOT if none */
+    unsigned int m_managerSlot;
     
     /** @brief location update event */		
     cMessage *updateEvent;
@@ -62,8 +92,8 @@ class TraceMobility : public BasicMobility
     /** @brief Target position of the host */
     Coord targetPos;
     
-    /** @brief The pending event list. Contains waypoint updates */
-    waypointEventsList m_eventList;
+    /** @brief The waypoints not yet reached */
+    WaypointStore m_eventList;
     
     Coord _targetPos;
     
@@ -89,14 +119,29 @@ class TraceMobility : public BasicMobility
     virtual void handleMessage(cMessage *msg);
     
     /** @brief Initialize the waypoint event list. Called by the 
-               trace factory object upon creation of the node */    
-    void initializeTrace( const waypointEventsList *eventList );
+               trace factory object upon creation of the node. The module takes
+               over the waypoints without a copy and leaves the list empty. */    
+    void initializeTrace( waypointEventsVector *eventList );
+    /** @brief Returns the position of the node at a time no earlier than the start of
+               the movement in progress */
+    Coord positionAt( simtime_t time ) const;
+    /** @brief Requests updates at least this accurate in meters from the next movement 
+               on. Zero clears the request. */
+    void requestResolution( double maxError );
+    /** @brief Publishes the movement of the node set by the manager in managed mode */
+    void managedMove( const Coord &position, double speed, const Coord &target );
+    /** @brief Sets the slot of the node in the manager. Called when it is moved. */
+    void setManagerSlot( unsigned int slot ) { m_managerSlot = slot; }
 
   protected:
     /** @brief Move the host one step */
     virtual void makeMove();    
     /** @brief Set a new target or waypoint for the node movement */
     void setTarget(double time, double x, double y, double speed );
+    /** @brief Start the movement towards the target in analytic mode. Schedules the arrival. */
+    void startMovement();
+    /** @brief Arrive at the target in analytic mode and set the next waypoint as target */
+    void arrive();
 };
 
 #endif /* __TRACE_MOBILITY_INCLUDED__ */
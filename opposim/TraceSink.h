@@ -0,0 +1,128 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __TRACE_SINK_INCLUDED__
+#define __TRACE_SINK_INCLUDED__
+
+#include <string>
+#include <vector>
+#include <list>
+#include "TraceTypes.h"
+
+/**
+ * @brief Receiver of the records read from a trace file.
+ *
+ * Trace parsers hand every record they read to a sink, in trace file order. This
+ * decouples parsing from what is done with the records, so the same parser can feed
+ * the NodeFactory directly, a buffer filled on a worker thread or a trace writer.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class TraceSink
+{
+  public:
+    virtual ~TraceSink() {}
+
+    /** @brief Called when the root element of a trace is read. The hints are the
+               expected number of nodes and records, or zero if unknown. */
+    virtual void beginTrace( TRACE_TYPE traceType, unsigned long nodesHint, unsigned long recordsHint ) = 0;
+    /** @brief Called for each create or destroy command */
+    virtual void addCommand( const TRACE_COMMAND &command ) = 0;
+    /** @brief Called for each waypoint */
+    virtual void addWaypoint( const WAYPOINT_EVENT &waypoint ) = 0;
+    /** @brief Called for each contact or break event */
+    virtual void addContact( const CONTACT_EVENT &contact ) = 0;
+};
+
+/**
+ * @brief A trace sink which stores the records in memory.
+ *
+ * Used to collect the records of a part of a trace, e.g. on a parser thread, and replay
+ * them into another sink later. The records of each kind are replayed in the order they
+ * were added.
+ */
+class BufferedTraceSink : public TraceSink
+{
+  public:
+    TRACE_TYPE                    traceType;
+    /** @brief The size hints of the root element, zero if unknown */
+    unsigned long                 nodesHint;
+    unsigned long                 recordsHint;
+    std::vector<TRACE_COMMAND>    commands;
+    std::vector<WAYPOINT_EVENT>   waypoints;
+    std::vector<CONTACT_EVENT>    contacts;
+    /** @brief If set, waypoints and contacts are counted but not stored */
+    bool                          commandsOnly;
+    /** @brief The number of waypoints and contacts not stored */
+    unsigned long                 skippedRecords;
+
+  public:
+    BufferedTraceSink() { traceType = None; nodesHint = recordsHint = 0; commandsOnly = false; skippedRecords = 0; }
+
+    virtual void beginTrace( TRACE_TYPE type, unsigned long nodes, unsigned long records )
+      { traceType = type; nodesHint = nodes; recordsHint = records; }
+    virtual void addCommand( const TRACE_COMMAND &command ) { commands.push_back(command); }
+    virtual void addWaypoint( const WAYPOINT_EVENT &waypoint )
+      { if ( commandsOnly ) skippedRecords++; else waypoints.push_back(waypoint); }
+    virtual void addContact( const CONTACT_EVENT &contact )
+      { if ( commandsOnly ) skippedRecords++; else contacts.push_back(contact); }
+
+    /** @brief Passes the stored records on to another sink */
+    void replay( TraceSink *sink ) const
+    {
+      unsigned int i;
+      for ( i=0; i < commands.size(); i++ )
+        sink->addCommand( commands[i] );
+      for ( i=0; i < waypoints.size(); i++ )
+        sink->addWaypoint( waypoints[i] );
+      for ( i=0; i < contacts.size(); i++ )
+        sink->addContact( contacts[i] );
+    }
+};
+
+/**
+ * @brief A trace sink which passes every record on to two other sinks.
+ */
+class TeeTraceSink : public TraceSink
+{
+  private:
+    TraceSink *m_first;
+    TraceSink *m_second;
+
+  public:
+    TeeTraceSink( TraceSink *first, TraceSink *second ) { m_first = first; m_second = second; }
+
+    virtual void beginTrace( TRACE_TYPE type, unsigned long nodesHint, unsigned long recordsHint )
+      { m_first->beginTrace( type, nodesHint, recordsHint ); m_second->beginTrace( type, nodesHint, recordsHint ); }
+    virtual void addCommand( const TRACE_COMMAND &command )
+      { m_first->addCommand( command ); m_second->addCommand( command ); }
+    virtual void addWaypoint( const WAYPOINT_EVENT &waypoint )
+      { m_first->addWaypoint( waypoint ); m_second->addWaypoint( waypoint ); }
+    virtual void addContact( const CONTACT_EVENT &contact )
+      { m_first->addContact( contact ); m_second->addContact( contact ); }
+};
+
+#endif /* __TRACE_SINK_INCLUDED__ */
@@ -0,0 +1,106 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "TraceSource.h"
+#include "UdelTraceParser.h"
+#include "Ns2TraceParser.h"
+#include "BonnMotionTraceParser.h"
+#include "OneTraceParser.h"
+#include <stdio.h>
+#include <math.h>
+
+TraceSource::TraceSource( double scenarioSizeX, double scenarioSizeY )
+{
+  m_scenarioSizeX = scenarioSizeX;
+  m_scenarioSizeY = scenarioSizeY;
+  m_samples = 0;
+  m_waypoints = 0;
+}
+
+TraceSource *TraceSource::create( const std::string &format, double scenarioSizeX,
+                                  double scenarioSizeY, double tolerance )
+{
+  if ( format == "udel" )
+    return new UdelTraceParser( scenarioSizeX, scenarioSizeY, tolerance );
+  if ( format == "ns2" )
+    return new Ns2TraceParser( scenarioSizeX, scenarioSizeY );
+  if ( format == "bonnmotion" )
+    return new BonnMotionTraceParser( scenarioSizeX, scenarioSizeY );
+  if ( format == "one" )
+    return new OneTraceParser( scenarioSizeX, scenarioSizeY );
+  return NULL;
+}
+
+void TraceSource::_createNode( TraceSink *sink, int nodeId, double time, double x, double y )
+{
+  TRACE_COMMAND command;
+  command.kind = CREATE_EVENT_KIND;
+  command.time = time;
+  command.nodeId = nodeId;
+  command.x = x;
+  command.y = y;
+  command.type = TRACE_SOURCE_NODE_TYPE;
+  command.prefix = TRACE_SOURCE_NODE_PREFIX;
+  command.icon = TRACE_SOURCE_NODE_ICON;
+  command.mobilityModel = TRACE_SOURCE_MOBILITY_MODEL;
+  sink->addCommand( command );
+}
+
+void TraceSource::_addMovement( TraceSink *sink, int nodeId, double startTime, double startX, double startY,
+                                double endTime, double endX, double endY )
+{
+  double distance = sqrt( ( endX - startX ) * ( endX - startX ) + ( endY - startY ) * ( endY - startY ) );
+  // The node stands still. No waypoint is needed.
+  if ( distance == 0.0 )
+    return;
+
+  WAYPOINT_EVENT waypoint;
+  waypoint.id = nodeId;
+  waypoint.time = startTime;
+  waypoint.x = endX;
+  waypoint.y = endY;
+  // A movement taking no time is a jump
+  waypoint.speed = endTime > startTime ? distance / ( endTime - startTime ) : 0.0;
+  sink->addWaypoint( waypoint );
+  m_waypoints++;
+}
+
+bool TraceSource::_validateLocation( double x, double y )
+{
+  if ( ( m_scenarioSizeX == 0 || ( x >= 0.0 && x <= m_scenarioSizeX ) ) &&
+       ( m_scenarioSizeY == 0 || ( y >= 0.0 && y <= m_scenarioSizeY ) ) )
+    return true;
+
+  m_lastError = "Location of node out of bounds";
+  return false;
+}
+
+void TraceSource::_setErrorLine( int lineNumber )
+{
+  char location[64];
+  sprintf( location, " in line %d", lineNumber );
+  m_lastError += location;
+}
@@ -0,0 +1,99 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __TRACE_SOURCE_INCLUDED__
+#define __TRACE_SOURCE_INCLUDED__
+
+#include <string>
+#include "TraceSink.h"
+
+// Node type attributes of the create commands of mobility formats which do not
+// specify them. Same as those written by the MobiTrace converters.
+#define TRACE_SOURCE_NODE_TYPE      "SimpleNode"
+#define TRACE_SOURCE_NODE_PREFIX    "node"
+#define TRACE_SOURCE_NODE_ICON      "device/palm_s"
+#define TRACE_SOURCE_MOBILITY_MODEL "TraceMobility"
+
+/**
+ * @brief Reader of a foreign mobility trace format.
+ *
+ * A trace source streams a trace file in some external format into a TraceSink, as
+ * create commands and waypoints, without converting it to a XML trace first. The
+ * source to use is selected by name with create(), so adding a format only requires
+ * a new subclass and an entry in create().
+ *
+ * Locations are validated against the scenario size as they are read. Formats which
+ * describe movement as location samples are turned into one waypoint per sample:
+ * at the time of the previous sample, move to the sample at the speed needed to
+ * arrive at the time of the sample. Samples with no movement become pauses.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class TraceSource
+{
+  protected:
+    double        m_scenarioSizeX;
+    double        m_scenarioSizeY;
+    /** @brief The number of location samples or movement commands read */
+    unsigned long m_samples;
+    /** @brief The number of waypoints passed to the sink */
+    unsigned long m_waypoints;
+    std::string   m_lastError;
+
+  public:
+    /** @brief Constructor. A zero scenario size disables location validation. */
+    TraceSource( double scenarioSizeX, double scenarioSizeY );
+    virtual ~TraceSource() {}
+
+    /** @brief Reads a trace file into the sink. Returns false on error. */
+    virtual bool parseFile( const char *filename, TraceSink *sink ) = 0;
+    /** @brief Returns a description of the last error encountered. */
+    const std::string &lastError() const { return m_lastError; }
+    /** @brief Returns the number of samples or movement commands read by the last parse */
+    unsigned long samples() const { return m_samples; }
+    /** @brief Returns the number of waypoints written by the last parse */
+    unsigned long waypoints() const { return m_waypoints; }
+
+    /** @brief Creates the source of a format: udel, ns2, bonnmotion or one. Returns NULL
+               for an unknown format. The tolerance is only used by formats which merge
+               samples. */
+    static TraceSource *create( const std::string &format, double scenarioSizeX,
+                                double scenarioSizeY, double tolerance );
+
+  protected:
+    /** @brief Passes a create command with the default node attributes to the sink */
+    void _createNode( TraceSink *sink, int nodeId, double time, double x, double y );
+    /** @brief Passes the waypoint of a movement between two samples to the sink. No
+               waypoint is needed if the node does not move. */
+    void _addMovement( TraceSink *sink, int nodeId, double startTime, double startX, double startY,
+                       double endTime, double endX, double endY );
+    /** @brief Validates a location. Sets the last error if out of bounds. */
+    bool _validateLocation( double x, double y );
+    /** @brief Appends the line number to the last error */
+    void _setErrorLine( int lineNumber );
+};
+
+#endif /* __TRACE_SOURCE_INCLUDED__ */
@@ -34,6 +34,9 @@
 #ifndef __TYPES_INCLUDED__
 #define __TYPES_INCLUDED__
 
+#include <string>
+#include <vector>
+
 // Defines for traced event types
 #define NO_EVENT_KIND  0
 #define CREATE_EVENT_KIND 1
@@ -41,6 +44,37 @@
 #define DESTROY_EVENT_KIND 3
 #define CONTACT_EVENT_KIND 4
 
+/**
+ * @brief Coordinate axes. Used when validating trace locations.
+ */
+enum COORD_TYPE {xCoordinate,yCoordinate};
+/**
+ * @brief Trace types. Either mobility or contact traces can be in effect at the same time.
+ */
+enum TRACE_TYPE {None,MobilityTrace,ContactTrace};
+
+/**
+ * @brief Create or destroy command data structure.
+ *
+ * Data structure for a single create or destroy command read from a trace file, before
+ * it is turned into a CreateEvent or DestroyEvent message by the NodeFactory. The kind
+ * is either CREATE_EVENT_KIND or DESTROY_EVENT_KIND. The location and string fields 
+ * are only used by create commands.
+ */
+struct TRACE_COMMAND
+{
+  int kind;
+  double time;
+  int nodeId;
+  double x;
+  double y;
+  std::string type;
+  std::string name;
+  std::string prefix;
+  std::string icon;
+  std::string mobilityModel;
+};
+
 /**
  * @brief Waypoint data structure.
  *
@@ -79,12 +113,62 @@ struct CONTACT_EVENT
 };
 
 /**
- * Container for cached waypoint events read from a trace file.
+ * @brief A waypoint of a node, without the node id.
+ *
+ * The waypoints of each node are kept in a list of their own once read from a trace,
+ * so the node id is not stored with every waypoint.
+ */
+struct WAYPOINT
+{
+  double time;
+  double x;
+  double y;
+  double speed;
+};
+
+/** @brief Returns a waypoint event without its node id */
+inline WAYPOINT waypointOf( const WAYPOINT_EVENT &event )
+{
+  WAYPOINT waypoint;
+  waypoint.time = event.time;
+  waypoint.x = event.x;
+  waypoint.y = event.y;
+  waypoint.speed = event.speed;
+  return waypoint;
+}
+
+/**
+ * @brief A contact or break of a node, without the node id.
+ *
+ * The contacts of each node are kept in a list of their own once read from a trace,
+ * so the node id is not stored with every contact.
+ */
+struct CONTACT
+{
+  ContactEventType type;
+  int peerId;
+  double time;
+};
+
+/** @brief Returns a contact event without its node id */
+inline CONTACT contactOf( const CONTACT_EVENT &event )
+{
+  CONTACT contact;
+  contact.type = event.type;
+  contact.peerId = event.peerId;
+  contact.time = event.time;
+  return contact;
+}
+
+/**
+ * Contiguous per-node storage for waypoints while a trace is read. The waypoints
+ * of a created node are kept in a WaypointStore, see CompactTrace.h.
  */
-typedef std::list<WAYPOINT_EVENT> waypointEventsList; 
+typedef std::vector<WAYPOINT> waypointEventsVector;
 /**
- * Container for cached contact events read from a trace file.
+ * Contiguous per-node storage for contact events while a trace is read. The events
+ * of a created node are kept in a ContactStore.
  */
-typedef std::list<CONTACT_EVENT> contactEventsList;
+typedef std::vector<CONTACT> contactEventsVector;
 
 #endif /* __TYPES_INCLUDED__ */
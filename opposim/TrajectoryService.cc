@@ -0,0 +1,111 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "TrajectoryService.h"
+#include <float.h>
+
+TrajectoryService::TrajectoryService()
+{
+  m_segments = 0;
+  m_horizon = 0.0;
+}
+
+void TrajectoryService::addNode( int nodeId, double createTime, double x, double y, const waypointEventsVector &waypoints )
+{
+  std::vector<NODE_LIFE> &lives = m_nodes[nodeId];
+  lives.push_back( NODE_LIFE() );
+  NODE_LIFE &life = lives.back();
+  life.createTime = createTime;
+  life.destroyTime = DBL_MAX;
+  life.trajectory.build( createTime, x, y, waypoints );
+  m_segments += life.trajectory.segments();
+  if ( life.trajectory.endTime() > m_horizon )
+    m_horizon = life.trajectory.endTime();
+}
+
+bool TrajectoryService::destroyNode( int nodeId, double time )
+{
+  NODE_LIFE_MAP_TYPE::iterator iter = m_nodes.find( nodeId );
+  if ( iter == m_nodes.end() )
+    return false;
+  std::vector<NODE_LIFE> &lives = iter->second;
+  for ( unsigned int i=0; i < lives.size(); i++ )
+  {
+    if ( lives[i].destroyTime == DBL_MAX )
+    {
+      lives[i].destroyTime = time;
+      if ( time > m_horizon )
+        m_horizon = time;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TrajectoryService::clear()
+{
+  m_nodes.clear();
+  m_segments = 0;
+  m_horizon = 0.0;
+}
+
+bool TrajectoryService::positionAt( int nodeId, double time, double &x, double &y ) const
+{
+  NODE_LIFE_MAP_TYPE::const_iterator iter = m_nodes.find( nodeId );
+  if ( iter == m_nodes.end() )
+    return false;
+  const NODE_LIFE *life = _findLife( iter->second, time );
+  if ( life == NULL )
+    return false;
+  life->trajectory.positionAt( time, x, y );
+  return true;
+}
+
+void TrajectoryService::positionsAt( double time, std::vector<NODE_POSITION> &positions ) const
+{
+  positions.clear();
+  NODE_LIFE_MAP_TYPE::const_iterator iter;
+  for ( iter = m_nodes.begin(); iter != m_nodes.end(); iter++ )
+  {
+    const NODE_LIFE *life = _findLife( iter->second, time );
+    if ( life == NULL )
+      continue;
+    NODE_POSITION position;
+    position.nodeId = iter->first;
+    life->trajectory.positionAt( time, position.x, position.y );
+    positions.push_back( position );
+  }
+}
+
+const TrajectoryService::NODE_LIFE *TrajectoryService::_findLife( const std::vector<NODE_LIFE> &lives, double time ) const
+{
+  // A node is alive from its create command up to its destroy command. Lives are in
+  // create order and rarely more than one.
+  for ( unsigned int i=0; i < lives.size(); i++ )
+    if ( lives[i].createTime <= time && time < lives[i].destroyTime )
+      return &lives[i];
+  return NULL;
+}
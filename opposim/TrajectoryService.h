@@ -0,0 +1,107 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __TRAJECTORY_SERVICE_INCLUDED__
+#define __TRAJECTORY_SERVICE_INCLUDED__
+
+#include <string>
+#include <vector>
+#include <map>
+#include "NodeTrajectory.h"
+
+/**
+ * @brief The location of a node at a time
+ */
+struct NODE_POSITION
+{
+  int    nodeId;
+  double x;
+  double y;
+};
+
+/**
+ * @brief Answers the location of any node of a mobility trace at any time.
+ *
+ * The service holds the trajectory of every life of every node of the trace, from its
+ * create to its destroy command, built from its waypoints by NodeTrajectory. The
+ * location of a node at a time, past or future, is found with a binary search of its
+ * movements, without subscribing to the node or scheduling any events. A node id may
+ * be created again after it has been destroyed, so the lives of a node are kept in 
+ * create order. A node created again has no waypoints, as all the waypoints of a node
+ * id go to its first life.
+ *
+ * The locations are those of the trajectory computed from the waypoints. They are
+ * followed exactly by TraceMobility in analytic mode, and within an update interval
+ * by the stepped mode.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class TrajectoryService
+{
+  private:
+    /** @brief A node from its create to its destroy command */
+    struct NODE_LIFE
+    {
+      double         createTime;
+      double         destroyTime;
+      NodeTrajectory trajectory;
+    };
+    typedef std::map<int,std::vector<NODE_LIFE> > NODE_LIFE_MAP_TYPE;
+
+    NODE_LIFE_MAP_TYPE m_nodes;
+    unsigned long      m_segments;
+    double             m_horizon;
+
+  public:
+    /** @brief Constructor */
+    TrajectoryService();
+
+    /** @brief Adds a life of a node created at a time and location with its waypoints */
+    void addNode( int nodeId, double createTime, double x, double y, const waypointEventsVector &waypoints );
+    /** @brief Ends the earliest life of a node not yet destroyed. Returns false if none. */
+    bool destroyNode( int nodeId, double time );
+    /** @brief Removes all nodes */
+    void clear();
+
+    /** @brief Returns the location of a node at a time. Returns false if the node is not
+               alive at the time. */
+    bool positionAt( int nodeId, double time, double &x, double &y ) const;
+    /** @brief Returns the locations of all nodes alive at a time, ordered by node id */
+    void positionsAt( double time, std::vector<NODE_POSITION> &positions ) const;
+
+    /** @brief Returns the number of node ids */
+    unsigned int nodes() const { return m_nodes.size(); }
+    /** @brief Returns the number of movements of all nodes */
+    unsigned long segments() const { return m_segments; }
+    /** @brief Returns the time of the last create or destroy command or arrival */
+    double horizon() const { return m_horizon; }
+
+  private:
+    /** @brief Returns the life of a node at a time, or NULL if it is not alive */
+    const NODE_LIFE *_findLife( const std::vector<NODE_LIFE> &lives, double time ) const;
+};
+
+#endif /* __TRAJECTORY_SERVICE_INCLUDED__ */
@@ -0,0 +1,210 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "UdelTraceParser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+UdelTraceParser::UdelTraceParser( double scenarioSizeX, double scenarioSizeY, double tolerance )
+  : TraceSource( scenarioSizeX, scenarioSizeY )
+{
+  m_tolerance = tolerance;
+}
+
+bool UdelTraceParser::parseFile( const char *filename, TraceSink *sink )
+{
+  m_nodes.clear();
+  m_samples = 0;
+  m_waypoints = 0;
+
+  FILE *f = fopen( filename, "r" );
+  if ( f == NULL )
+  {
+    m_lastError = "Unable to open config file";
+    return false;
+  }
+
+  sink->beginTrace( MobilityTrace, 0, 0 );
+
+  char line[1024];
+  int lineNumber = 0;
+  bool ok = true;
+  while ( ok && fgets( line, sizeof(line), f ) != NULL )
+  {
+    lineNumber++;
+    int nodeId;
+    SAMPLE sample;
+    bool skip;
+    ok = _parseLine( line, nodeId, sample, skip );
+    if ( ok && !skip )
+      ok = _addSample( nodeId, sample, sink );
+  }
+  fclose(f);
+
+  if ( !ok )
+  {
+    _setErrorLine( lineNumber );
+    return false;
+  }
+
+  // Close the open segment of every node
+  NODE_STATE_MAP_TYPE::iterator iter;
+  for ( iter = m_nodes.begin(); iter != m_nodes.end(); iter++ )
+  {
+    NODE_STATE &state = iter->second;
+    if ( !state.samples.empty() )
+      _endSegment( iter->first, state.anchor, state.samples.back(), sink );
+  }
+  m_nodes.clear();
+  return true;
+}
+
+/**
+ * Parses a sample line. Empty lines and samples of nodes which are not mobile hosts or
+ * are outside the simulated area are skipped.
+ */
+bool UdelTraceParser::_parseLine( char *line, int &nodeId, SAMPLE &sample, bool &skip )
+{
+  skip = true;
+  char *symbols[10];
+  int count = 0;
+  char *save = NULL;
+  for ( char *token = strtok_r( line, " \t\r\n", &save ); token != NULL && count < 10;
+        token = strtok_r( NULL, " \t\r\n", &save ) )
+    symbols[count++] = token;
+  if ( count == 0 )
+    return true;
+  if ( count < 10 )
+  {
+    m_lastError = "Insufficient arguments";
+    return false;
+  }
+
+  // Lets silently skip all nodes other than MOBILE-HOST at the moment.
+  if ( strcasecmp( symbols[5], "MOBILE-HOST" ) != 0 )
+    return true;
+  // Skip nodes which are outside the simulated area or about to exit
+  int floorNum = atoi( symbols[8] );
+  if ( floorNum == 100000 || floorNum == 100001 )
+    return true;
+
+  char *end;
+  nodeId = strtol( symbols[0], &end, 10 );
+  bool ok = *end == '\0';
+  sample.time = strtod( symbols[1], &end );
+  ok = ok && *end == '\0';
+  char *coords = symbols[2];
+  if ( *coords == '(' )
+    coords++;
+  sample.x = strtod( coords, &end );
+  ok = ok && *end == ',';
+  if ( ok )
+    sample.y = strtod( end+1, &end );
+  ok = ok && ( *end == ',' || *end == ')' || *end == '\0' );
+  if ( !ok )
+  {
+    m_lastError = "Malformed UDel sample";
+    return false;
+  }
+
+  if ( !_validateLocation( sample.x, sample.y ) )
+    return false;
+  skip = false;
+  return true;
+}
+
+bool UdelTraceParser::_addSample( int nodeId, const SAMPLE &sample, TraceSink *sink )
+{
+  m_samples++;
+
+  NODE_STATE_MAP_TYPE::iterator iter = m_nodes.find( nodeId );
+  if ( iter == m_nodes.end() )
+  {
+    // The node is created at its first sample
+    _createNode( sink, nodeId, sample.time, sample.x, sample.y );
+
+    NODE_STATE &state = m_nodes[nodeId];
+    state.anchor = sample;
+    state.samples.reserve( UDEL_MAX_SEGMENT_SAMPLES );
+    return true;
+  }
+
+  NODE_STATE &state = iter->second;
+  const SAMPLE &last = state.samples.empty() ? state.anchor : state.samples.back();
+  if ( sample.time < last.time )
+  {
+    m_lastError = "UDel samples of a node not in time order";
+    return false;
+  }
+  if ( sample.time == last.time )
+    return true;
+
+  if ( state.samples.size() < UDEL_MAX_SEGMENT_SAMPLES && _fits( state, sample ) )
+  {
+    state.samples.push_back( sample );
+    return true;
+  }
+
+  // The sample does not fit the open segment. End the segment at the previous sample
+  // and start a new one there.
+  SAMPLE end = state.samples.back();
+  _endSegment( nodeId, state.anchor, end, sink );
+  state.anchor = end;
+  state.samples.clear();
+  state.samples.push_back( sample );
+  return true;
+}
+
+/**
+ * Checks whether the open segment of a node can be extended to end at a sample, that
+ * is whether all samples of the segment are within the tolerance of the extended
+ * segment.
+ */
+bool UdelTraceParser::_fits( const NODE_STATE &state, const SAMPLE &end ) const
+{
+  const SAMPLE &start = state.anchor;
+  double duration = end.time - start.time;
+  double dx = end.x - start.x;
+  double dy = end.y - start.y;
+  double tolerance2 = m_tolerance * m_tolerance;
+  for ( unsigned int i=0; i < state.samples.size(); i++ )
+  {
+    const SAMPLE &sample = state.samples[i];
+    double fraction = ( sample.time - start.time ) / duration;
+    double ex = start.x + fraction * dx - sample.x;
+    double ey = start.y + fraction * dy - sample.y;
+    if ( ex*ex + ey*ey > tolerance2 )
+      return false;
+  }
+  return true;
+}
+
+void UdelTraceParser::_endSegment( int nodeId, const SAMPLE &start, const SAMPLE &end, TraceSink *sink )
+{
+  _addMovement( sink, nodeId, start.time, start.x, start.y, end.time, end.x, end.y );
+}
@@ -0,0 +1,99 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __UDEL_TRACE_PARSER_INCLUDED__
+#define __UDEL_TRACE_PARSER_INCLUDED__
+
+#include <string>
+#include <vector>
+#include <map>
+#include "TraceSource.h"
+
+// Upper bound on the samples merged into a single segment. Bounds the work per sample.
+#define UDEL_MAX_SEGMENT_SAMPLES 256
+
+/**
+ * @brief Parser for UDel mobility simulator output (http://udelmodels.eecis.udel.edu).
+ *
+ * UDel writes the location of every node at every time step, one line per sample:
+ *
+ *   NodeID Time (X,Y,Z) NotUsed NotUsed HostType # NodeType FloorNum TaskNum
+ *
+ * As with u2tr, only MOBILE-HOST nodes are read and samples of nodes outside the
+ * simulated area (floor 100000 and 100001) skipped. A node is created at its first
+ * sample.
+ *
+ * Rather than one waypoint per sample, the samples of each node are merged into
+ * linear segments of constant speed. A segment is extended for as long as every
+ * sample it covers is within the tolerance of the location interpolated at the time
+ * of the sample. Each segment becomes a single waypoint: at the start time of the
+ * segment, move to its end at the speed needed to arrive at the end time. Segments
+ * with no movement become pauses and result in no waypoint at all.
+ *
+ * The samples of each node must be in time order. Samples of different nodes may be
+ * interleaved, as UDel writes them. Records are handed to the sink as segments are
+ * completed, so only the samples of open segments are kept in memory.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class UdelTraceParser : public TraceSource
+{
+  private:
+    /** @brief A single location sample */
+    struct SAMPLE
+    {
+      double time;
+      double x;
+      double y;
+    };
+    /** @brief The open segment of a node. The segment starts at the anchor and ends at
+               the last of the samples. */
+    struct NODE_STATE
+    {
+      SAMPLE              anchor;
+      std::vector<SAMPLE> samples;
+    };
+    typedef std::map<int,NODE_STATE> NODE_STATE_MAP_TYPE;
+
+    double              m_tolerance;
+    NODE_STATE_MAP_TYPE m_nodes;
+
+  public:
+    /** @brief Constructor. A zero scenario size disables location validation. The
+               tolerance is the maximum location error in meters. */
+    UdelTraceParser( double scenarioSizeX, double scenarioSizeY, double tolerance );
+
+    /** @brief Parses a UDel output file. Returns false on error. */
+    virtual bool parseFile( const char *filename, TraceSink *sink );
+
+  private:
+    bool _parseLine( char *line, int &nodeId, SAMPLE &sample, bool &skip );
+    bool _addSample( int nodeId, const SAMPLE &sample, TraceSink *sink );
+    bool _fits( const NODE_STATE &state, const SAMPLE &end ) const;
+    void _endSegment( int nodeId, const SAMPLE &start, const SAMPLE &end, TraceSink *sink );
+};
+
+#endif /* __UDEL_TRACE_PARSER_INCLUDED__ */
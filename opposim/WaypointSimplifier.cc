@@ -0,0 +1,137 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "WaypointSimplifier.h"
+#include <math.h>
+
+WaypointSimplifier::WaypointSimplifier( double maxError )
+{
+  m_maxError = maxError;
+}
+
+unsigned long WaypointSimplifier::simplify( waypointEventsVector &waypoints, double createTime,
+                                            double createX, double createY )
+{
+  if ( waypoints.size() < 2 )
+    return 0;
+
+  // Work out the movements as TraceMobility makes them
+  m_movements.resize( waypoints.size() );
+  double prevEnd = createTime;
+  double prevX = createX;
+  double prevY = createY;
+  for ( unsigned int i=0; i < waypoints.size(); i++ )
+  {
+    const WAYPOINT &waypoint = waypoints[i];
+    MOVEMENT &movement = m_movements[i];
+    movement.start = waypoint.time > prevEnd ? waypoint.time : prevEnd;
+    movement.x = waypoint.x;
+    movement.y = waypoint.y;
+    double distance = sqrt( ( waypoint.x - prevX ) * ( waypoint.x - prevX ) +
+                            ( waypoint.y - prevY ) * ( waypoint.y - prevY ) );
+    if ( distance > 0.0 && waypoint.speed > 0.0 )
+      movement.end = movement.start + distance / waypoint.speed;
+    else
+      movement.end = movement.start;
+    prevEnd = movement.end;
+    prevX = waypoint.x;
+    prevY = waypoint.y;
+  }
+
+  // Merge runs of movements, starting each run where the previous one ended
+  waypointEventsVector simplified;
+  unsigned int first = 0;
+  double startX = createX;
+  double startY = createY;
+  while ( first < m_movements.size() )
+  {
+    unsigned int last = first;
+    while ( last+1 < m_movements.size() && last+1 - first < MAX_MERGED_WAYPOINTS &&
+            _fits( first, last+1, startX, startY ) )
+      last++;
+
+    const MOVEMENT &from = m_movements[first];
+    const MOVEMENT &to = m_movements[last];
+    double distance = sqrt( ( to.x - startX ) * ( to.x - startX ) + ( to.y - startY ) * ( to.y - startY ) );
+    if ( distance > 0.0 )
+    {
+      WAYPOINT waypoint = waypoints[last];
+      waypoint.time = from.start;
+      waypoint.speed = to.end > from.start ? distance / ( to.end - from.start ) : 0.0;
+      simplified.push_back( waypoint );
+    }
+    startX = to.x;
+    startY = to.y;
+    first = last+1;
+  }
+
+  // TraceMobility requires at least one waypoint. A node which never moves keeps
+  // its first one.
+  if ( simplified.empty() )
+    simplified.push_back( waypoints[0] );
+
+  unsigned long removed = waypoints.size() - simplified.size();
+  waypoints.swap( simplified );
+  return removed;
+}
+
+/**
+ * Checks whether movements first to last can be merged into a single movement from
+ * the start location to the location of the last movement.
+ */
+bool WaypointSimplifier::_fits( unsigned int first, unsigned int last, double startX, double startY ) const
+{
+  double start = m_movements[first].start;
+  double duration = m_movements[last].end - start;
+  // All movements are instantaneous jumps. Only the final location matters.
+  if ( duration <= 0.0 )
+    return true;
+
+  double dx = m_movements[last].x - startX;
+  double dy = m_movements[last].y - startY;
+  double maxError2 = m_maxError * m_maxError;
+  double prevX = startX;
+  double prevY = startY;
+  for ( unsigned int i=first; i <= last; i++ )
+  {
+    const MOVEMENT &movement = m_movements[i];
+    // The node is at the previous location when the movement starts, and at the
+    // location of the movement when it ends.
+    double fraction = ( movement.start - start ) / duration;
+    double ex = startX + fraction * dx - prevX;
+    double ey = startY + fraction * dy - prevY;
+    if ( ex*ex + ey*ey > maxError2 )
+      return false;
+    fraction = ( movement.end - start ) / duration;
+    ex = startX + fraction * dx - movement.x;
+    ey = startY + fraction * dy - movement.y;
+    if ( ex*ex + ey*ey > maxError2 )
+      return false;
+    prevX = movement.x;
+    prevY = movement.y;
+  }
+  return true;
+}
@@ -0,0 +1,83 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __WAYPOINT_SIMPLIFIER_INCLUDED__
+#define __WAYPOINT_SIMPLIFIER_INCLUDED__
+
+#include <vector>
+#include "TraceTypes.h"
+
+// Upper bound on the waypoints merged into one. Bounds the work per waypoint.
+#define MAX_MERGED_WAYPOINTS 64
+
+/**
+ * @brief Simplifies the waypoint list of a node within a maximum position error.
+ *
+ * TraceMobility starts moving towards a waypoint at the waypoint time, or when the
+ * previous waypoint is reached if that is later, and moves there at the waypoint
+ * speed. A waypoint with no speed is jumped to. The simplifier works out when each
+ * movement of a node starts and ends, and merges runs of consecutive movements into
+ * a single one from the start of the first to the end of the last. A run is merged
+ * as long as the node is within the maximum error of the merged movement at the
+ * start and end of every movement in the run. Runs where the node does not move are
+ * removed, which leaves the node paused until its next movement.
+ *
+ * The merged waypoints keep the start and end times of the movements, so collinear
+ * movements at constant speed are merged without any error. Timing differences due
+ * to the TraceMobility update interval are not taken into account.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class WaypointSimplifier
+{
+  private:
+    /** @brief A movement of a node. The node leaves from the location of the previous
+               movement at the start time and arrives at the end time. */
+    struct MOVEMENT
+    {
+      double start;
+      double end;
+      double x;
+      double y;
+    };
+
+    double                m_maxError;
+    std::vector<MOVEMENT> m_movements;
+
+  public:
+    /** @brief Constructor. The maximum error is in meters. */
+    WaypointSimplifier( double maxError );
+
+    /** @brief Simplifies the waypoints of a node created at the given time and location.
+               Returns the number of waypoints removed. */
+    unsigned long simplify( waypointEventsVector &waypoints, double createTime,
+                            double createX, double createY );
+
+  private:
+    bool _fits( unsigned int first, unsigned int last, double startX, double startY ) const;
+};
+
+#endif /* __WAYPOINT_SIMPLIFIER_INCLUDED__ */
@@ -0,0 +1,414 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "XmlTraceParser.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <ctype.h>
+
+XmlTraceParser::XmlTraceParser( double scenarioSizeX, double scenarioSizeY )
+{
+  m_scenarioSizeX = scenarioSizeX;
+  m_scenarioSizeY = scenarioSizeY;
+}
+
+bool XmlTraceParser::parseFile( const char *filename, TraceSink *sink )
+{
+  xmlTextReaderPtr reader = xmlReaderForFile( filename, NULL, 0 );
+  if ( reader == NULL )
+  {
+    m_lastError = "Unable to open config file";
+    return false;
+  }
+  bool ok = parseReader( reader, sink );
+  xmlFreeTextReader(reader);
+  return ok;
+}
+
+bool XmlTraceParser::parseMemory( const char *buffer, int size, TraceSink *sink )
+{
+  xmlTextReaderPtr reader = xmlReaderForMemory( buffer, size, NULL, NULL, 0 );
+  if ( reader == NULL )
+  {
+    m_lastError = "Unable to read trace from memory";
+    return false;
+  }
+  bool ok = parseReader( reader, sink );
+  xmlFreeTextReader(reader);
+  return ok;
+}
+
+bool XmlTraceParser::parseReader( xmlTextReaderPtr reader, TraceSink *sink )
+{
+  const xmlChar *namestr;
+  std::string name;
+  bool ok = true;
+
+  int ret = xmlTextReaderRead(reader);
+  while ( ret == 1 && ok )
+  {
+    namestr = xmlTextReaderConstName(reader);
+    name = (const char *)namestr;
+    std::transform(name.begin(),name.end(),name.begin(),::tolower);
+
+    if ( xmlTextReaderNodeType(reader) == 1 && xmlTextReaderDepth(reader) == 0 )
+    {
+      // Optional size hints on the root element, used to pre-size the node lists
+      unsigned long nodes = 0, records = 0;
+      xmlChar *nodesHint = xmlTextReaderGetAttribute( reader, BAD_CAST "nodes" );
+      xmlChar *recordsHint = xmlTextReaderGetAttribute( reader, BAD_CAST "records" );
+      if ( nodesHint != NULL )
+        nodes = atol((const char *)nodesHint);
+      if ( recordsHint != NULL )
+        records = atol((const char *)recordsHint);
+      xmlFree( nodesHint );
+      xmlFree( recordsHint );
+
+      if ( name == "mobility-trace" )
+      {
+        sink->beginTrace( MobilityTrace, nodes, records );
+        ok = _parseMobilityTrace(reader, sink);
+      }
+      else if ( name == "contact-trace" )
+      {
+        sink->beginTrace( ContactTrace, nodes, records );
+        ok = _parseContactTrace(reader, sink);
+      }
+    }
+    if ( ok )
+      ret = xmlTextReaderRead(reader);
+  }
+
+  if ( ret < 0 && ok )
+  {
+    m_lastError = "Malformed XML trace file";
+    ok = false;
+  }
+  return ok;
+}
+
+bool XmlTraceParser::_parseMobilityTrace( xmlTextReaderPtr reader, TraceSink *sink )
+{
+  const xmlChar *namestr;
+  const xmlChar *value;
+  const char* valueStr = "";
+
+  int curEventKind = NO_EVENT_KIND;
+  TRACE_COMMAND curCommand;
+  WAYPOINT_EVENT curWaypointEvent;
+  std::string curValueLbl;
+  std::string curSubValueLbl;
+  int depth;
+
+  std::string name;
+
+  int ret = xmlTextReaderRead(reader);
+  while ( ret == 1)
+  {
+    namestr = xmlTextReaderConstName(reader);
+    depth = xmlTextReaderDepth(reader);
+
+    name = (const char *)namestr;
+    std::transform(name.begin(),name.end(),name.begin(),::tolower);
+
+    if ( xmlTextReaderNodeType(reader) == 1 )
+    {
+      if ( depth == 1 )
+      {
+        // Handle element
+        if ( name == "create" || name == "destroy" )
+        {
+          curEventKind = name == "create" ? CREATE_EVENT_KIND : DESTROY_EVENT_KIND;
+          curCommand = TRACE_COMMAND();
+          curCommand.kind = curEventKind;
+          curCommand.time = 0.0;
+          curCommand.nodeId = 0;
+          curCommand.x = 0.0;
+          curCommand.y = 0.0;
+        }
+        else if ( name == "waypoint" )
+        {
+          curEventKind = WAYPOINT_EVENT_KIND;
+          curWaypointEvent.id = -1;
+          curWaypointEvent.time = 0.0;
+          curWaypointEvent.x = 0.0;
+          curWaypointEvent.y = 0.0;
+          curWaypointEvent.speed = 0.0;
+        }
+      }
+      else if ( depth == 2 )
+      {
+        curValueLbl = name;
+      }
+      else if ( depth == 3 )
+      {
+        curSubValueLbl = name;
+      }
+    }
+    if ( xmlTextReaderNodeType(reader) == 15 )
+    {
+      // Handle end element
+      if ( depth == 1 )
+      {
+        if ( curEventKind == CREATE_EVENT_KIND || curEventKind == DESTROY_EVENT_KIND )
+          sink->addCommand(curCommand);
+        else if ( curEventKind == WAYPOINT_EVENT_KIND )
+          sink->addWaypoint(curWaypointEvent);
+        curEventKind = NO_EVENT_KIND;
+      }
+    }
+    if ( xmlTextReaderNodeType(reader) == 3 )
+    {
+      // Handle a value. Use the curValueLbl and curSubValueLbl to
+      // identify the property which the value corresponds to.
+  	  if ( xmlTextReaderHasValue(reader) )
+      {
+  			value = xmlTextReaderConstValue(reader);
+        valueStr = (const char *)value;
+      }
+
+      if ( curEventKind == CREATE_EVENT_KIND )
+      {
+        if ( curValueLbl == "time" )
+          curCommand.time = atof(valueStr);
+        else if ( curValueLbl == "nodeid" )
+          curCommand.nodeId = atoi(valueStr);
+        else if ( curValueLbl == "type" )
+          curCommand.type = valueStr;
+        else if ( curValueLbl == "name" )
+          curCommand.name = valueStr;
+        else if ( curValueLbl == "prefix" )
+          curCommand.prefix = valueStr;
+        else if ( curValueLbl == "icon" )
+          curCommand.icon = valueStr;
+        else if ( curValueLbl == "mobilitymodel" )
+          curCommand.mobilityModel = valueStr;
+        else if ( curValueLbl == "location" && curSubValueLbl == "xpos" )
+        {
+          if ( !_validateLocation( atof(valueStr), xCoordinate ) )
+            return false;
+          curCommand.x = atof(valueStr);
+        }
+        else if ( curValueLbl == "location" && curSubValueLbl == "ypos" )
+        {
+          if ( !_validateLocation( atof(valueStr), yCoordinate ) )
+            return false;
+          curCommand.y = atof(valueStr);
+        }
+      }
+      else if ( curEventKind == DESTROY_EVENT_KIND )
+      {
+        if ( curValueLbl == "time" )
+          curCommand.time = atof(valueStr);
+        else if ( curValueLbl == "nodeid" )
+          curCommand.nodeId = atoi(valueStr);
+      }
+      else if ( curEventKind == WAYPOINT_EVENT_KIND )
+      {
+        if ( curValueLbl == "time" )
+          curWaypointEvent.time = atof(valueStr);
+        else if ( curValueLbl == "nodeid" )
+          curWaypointEvent.id = atoi(valueStr);
+        else if ( curValueLbl == "speed" )
+          curWaypointEvent.speed = atof(valueStr);
+        else if ( curValueLbl == "destination" && curSubValueLbl == "xpos" )
+        {
+          if ( !_validateLocation( atof(valueStr), xCoordinate ) )
+            return false;
+          curWaypointEvent.x = atof(valueStr);
+        }
+        else if ( curValueLbl == "destination" && curSubValueLbl == "ypos" )
+        {
+          if ( !_validateLocation( atof(valueStr), yCoordinate ) )
+            return false;
+          curWaypointEvent.y = atof(valueStr);
+        }
+      }
+    }
+
+    ret = xmlTextReaderRead(reader);
+  }
+
+  if ( ret < 0 )
+  {
+    m_lastError = "Malformed XML trace file";
+    return false;
+  }
+  return true;
+}
+
+bool XmlTraceParser::_parseContactTrace( xmlTextReaderPtr reader, TraceSink *sink )
+{
+  const xmlChar *namestr;
+  const xmlChar *value;
+  const char* valueStr = "";
+
+  int curEventKind = NO_EVENT_KIND;
+  TRACE_COMMAND curCommand;
+  CONTACT_EVENT curContactEvent;
+  std::string curValueLbl;
+  std::string curSubValueLbl;
+  int depth;
+
+  std::string name;
+
+  int ret = xmlTextReaderRead(reader);
+  while ( ret == 1)
+  {
+    namestr = xmlTextReaderConstName(reader);
+    depth = xmlTextReaderDepth(reader);
+
+    name = (const char *)namestr;
+    std::transform(name.begin(),name.end(),name.begin(),::tolower);
+
+    if ( xmlTextReaderNodeType(reader) == 1 )
+    {
+      if ( depth == 1 )
+      {
+        // Handle element
+        if ( name == "create" || name == "destroy" )
+        {
+          curEventKind = name == "create" ? CREATE_EVENT_KIND : DESTROY_EVENT_KIND;
+          curCommand = TRACE_COMMAND();
+          curCommand.kind = curEventKind;
+          curCommand.time = 0.0;
+          curCommand.nodeId = 0;
+          curCommand.x = 0.0;
+          curCommand.y = 0.0;
+        }
+        else if ( name == "contact" || name == "break" )
+        {
+          curEventKind = CONTACT_EVENT_KIND;
+          curContactEvent.type = name == "contact" ? Contact : Break;
+          curContactEvent.time = 0.0;
+          curContactEvent.id = -1;
+          curContactEvent.peerId = -1;
+        }
+      }
+      else if ( depth == 2 )
+      {
+        curValueLbl = name;
+      }
+      else if ( depth == 3 )
+      {
+        curSubValueLbl = name;
+      }
+    }
+    if ( xmlTextReaderNodeType(reader) == 15 )
+    {
+      // Handle end element
+      if ( depth == 1 )
+      {
+        if ( curEventKind == CREATE_EVENT_KIND || curEventKind == DESTROY_EVENT_KIND )
+          sink->addCommand(curCommand);
+        else if ( curEventKind == CONTACT_EVENT_KIND )
+          sink->addContact(curContactEvent);
+        curEventKind = NO_EVENT_KIND;
+      }
+    }
+    if ( xmlTextReaderNodeType(reader) == 3 )
+    {
+      // Handle value. Use curValueLbl and curSubValueLbl to assign values
+      // parsed to the correct attribute.
+  	  if ( xmlTextReaderHasValue(reader) )
+      {
+  			value = xmlTextReaderConstValue(reader);
+        valueStr = (const char *)value;
+      }
+
+      if ( curEventKind == CREATE_EVENT_KIND )
+      {
+        if ( curValueLbl == "time" )
+          curCommand.time = atof(valueStr);
+        else if ( curValueLbl == "nodeid" )
+          curCommand.nodeId = atoi(valueStr);
+        else if ( curValueLbl == "type" )
+          curCommand.type = valueStr;
+        else if ( curValueLbl == "name" )
+          curCommand.name = valueStr;
+        else if ( curValueLbl == "prefix" )
+          curCommand.prefix = valueStr;
+        else if ( curValueLbl == "icon" )
+          curCommand.icon = valueStr;
+        else if ( curValueLbl == "location" && curSubValueLbl == "xpos" )
+        {
+          if ( !_validateLocation( atof(valueStr), xCoordinate ) )
+            return false;
+          curCommand.x = atof(valueStr);
+        }
+        else if ( curValueLbl == "location" && curSubValueLbl == "ypos" )
+        {
+          if ( !_validateLocation( atof(valueStr), yCoordinate ) )
+            return false;
+          curCommand.y = atof(valueStr);
+        }
+      }
+      else if ( curEventKind == DESTROY_EVENT_KIND )
+      {
+        if ( curValueLbl == "time" )
+          curCommand.time = atof(valueStr);
+        else if ( curValueLbl == "nodeid" )
+          curCommand.nodeId = atoi(valueStr);
+      }
+      else if ( curEventKind == CONTACT_EVENT_KIND )
+      {
+        if ( curValueLbl == "time" )
+          curContactEvent.time = atof(valueStr);
+        else if ( curValueLbl == "nodeid" )
+          curContactEvent.id = atoi(valueStr);
+        else if ( curValueLbl == "peerid" )
+          curContactEvent.peerId = atoi(valueStr);
+      }
+    }
+
+    ret = xmlTextReaderRead(reader);
+  }
+
+  if ( ret < 0 )
+  {
+    m_lastError = "Malformed XML trace file";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @todo Add the node id and location for easier debugging of traces.
+ */
+bool XmlTraceParser::_validateLocation( double coordinate, COORD_TYPE ct )
+{
+  double refval = 0.0;
+  if ( ct == xCoordinate )
+    refval = m_scenarioSizeX;
+  else if ( ct == yCoordinate )
+    refval = m_scenarioSizeY;
+
+  if ( refval == 0 || ( coordinate >= 0.0 && coordinate <= refval ) )
+    return true;
+
+  m_lastError = "Location of node out of bounds";
+  return false;
+}
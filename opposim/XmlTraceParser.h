@@ -0,0 +1,76 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __XML_TRACE_PARSER_INCLUDED__
+#define __XML_TRACE_PARSER_INCLUDED__
+
+#include <string>
+#include <libxml/xmlreader.h>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+#include "TraceSink.h"
+
+/**
+ * @brief Parser for XML mobility and contact traces.
+ *
+ * Reads a XML trace with a mobility-trace or contact-trace root element and hands the
+ * create, destroy, waypoint and contact records to a TraceSink in file order. Locations
+ * are validated against the scenario size while parsing.
+ *
+ * The parser does not depend on the simulation kernel. Parsing stops at the first
+ * invalid record and the error is available through lastError(). Separate parser
+ * objects can be used concurrently on different threads.
+ *
+ * @author Kristjan V. Jonsson
+ * @author Olafur R. Helgason
+ */
+class XmlTraceParser
+{
+  private:
+    double      m_scenarioSizeX;
+    double      m_scenarioSizeY;
+    std::string m_lastError;
+
+  public:
+    /** @brief Constructor. A zero scenario size disables location validation. */
+    XmlTraceParser( double scenarioSizeX, double scenarioSizeY );
+
+    /** @brief Parses a trace file. Returns false on error. */
+    bool parseFile( const char *filename, TraceSink *sink );
+    /** @brief Parses a trace held in memory. Returns false on error. */
+    bool parseMemory( const char *buffer, int size, TraceSink *sink );
+    /** @brief Parses a trace from an open reader. Returns false on error. */
+    bool parseReader( xmlTextReaderPtr reader, TraceSink *sink );
+    /** @brief Returns a description of the last error encountered. */
+    const std::string &lastError() const { return m_lastError; }
+
+  private:
+    bool _parseMobilityTrace( xmlTextReaderPtr reader, TraceSink *sink );
+    bool _parseContactTrace( xmlTextReaderPtr reader, TraceSink *sink );
+    bool _validateLocation( double coordinate, COORD_TYPE ct );
+};
+
+#endif /* __XML_TRACE_PARSER_INCLUDED__ */
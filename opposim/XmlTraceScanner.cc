@@ -0,0 +1,159 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#include "XmlTraceScanner.h"
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+bool XmlTraceScanner::findBody( const char *base, size_t size, std::string &rootName,
+                                size_t &bodyStart, size_t &bodyEnd )
+{
+  // Locate the root start tag, skipping the XML declaration, comments and doctype.
+  size_t pos = 0;
+  while ( pos < size )
+  {
+    const char *lt = (const char *)memchr( base + pos, '<', size - pos );
+    if ( lt == NULL )
+      return false;
+    pos = lt - base;
+    if ( pos + 4 <= size && strncmp( base + pos, "<!--", 4 ) == 0 )
+    {
+      const char *endComment = (const char *)memmem( base + pos, size - pos, "-->", 3 );
+      pos = endComment == NULL ? size : ( endComment - base ) + 3;
+    }
+    else if ( pos + 1 < size && ( base[pos+1] == '?' || base[pos+1] == '!' ) )
+    {
+      const char *gt = (const char *)memchr( base + pos, '>', size - pos );
+      pos = gt == NULL ? size : ( gt - base ) + 1;
+    }
+    else
+      break;
+  }
+  if ( pos >= size )
+    return false;
+
+  size_t nameEnd = pos + 1;
+  while ( nameEnd < size && !isspace(base[nameEnd]) && base[nameEnd] != '>' && base[nameEnd] != '/' )
+    nameEnd++;
+  rootName.assign( base + pos + 1, nameEnd - pos - 1 );
+  const char *gt = (const char *)memchr( base + nameEnd, '>', size - nameEnd );
+  if ( gt == NULL || *(gt-1) == '/' )
+    return false;
+  bodyStart = ( gt - base ) + 1;
+
+  // The body ends at the last end tag in the file, the root end tag.
+  for ( bodyEnd = size; bodyEnd > bodyStart + 1; bodyEnd-- )
+    if ( base[bodyEnd-2] == '<' && base[bodyEnd-1] == '/' )
+      break;
+  if ( bodyEnd <= bodyStart + 1 )
+    return false;
+  bodyEnd -= 2;
+  return true;
+}
+
+size_t XmlTraceScanner::recordEnd( const char *base, size_t pos, size_t end )
+{
+  static const char *records[] = { "create", "destroy", "waypoint", "contact", "break", NULL };
+
+  while ( pos < end )
+  {
+    const char *tag = (const char *)memmem( base + pos, end - pos, "</", 2 );
+    if ( tag == NULL )
+      return end;
+    pos = ( tag - base ) + 2;
+    for ( int i=0; records[i] != NULL; i++ )
+    {
+      size_t len = strlen( records[i] );
+      if ( pos + len < end && strncasecmp( base + pos, records[i], len ) == 0 )
+      {
+        size_t gt = pos + len;
+        while ( gt < end && isspace(base[gt]) )
+          gt++;
+        if ( gt < end && base[gt] == '>' )
+          return gt + 1;
+      }
+    }
+  }
+  return end;
+}
+
+size_t XmlTraceScanner::nextRecord( const char *base, size_t pos, size_t end, std::string &name )
+{
+  while ( pos < end )
+  {
+    const char *lt = (const char *)memchr( base + pos, '<', end - pos );
+    if ( lt == NULL )
+      return end;
+    pos = lt - base;
+    if ( pos + 1 < end && ( base[pos+1] == '/' || base[pos+1] == '!' || base[pos+1] == '?' ) )
+    {
+      // Not a start tag. Skip comments as a whole, other tags up to their end.
+      const char *gt;
+      if ( pos + 4 <= end && strncmp( base + pos, "<!--", 4 ) == 0 )
+      {
+        gt = (const char *)memmem( base + pos, end - pos, "-->", 3 );
+        pos = gt == NULL ? end : ( gt - base ) + 3;
+      }
+      else
+      {
+        gt = (const char *)memchr( base + pos, '>', end - pos );
+        pos = gt == NULL ? end : ( gt - base ) + 1;
+      }
+      continue;
+    }
+
+    size_t nameEnd = pos + 1;
+    while ( nameEnd < end && !isspace(base[nameEnd]) && base[nameEnd] != '>' && base[nameEnd] != '/' )
+      nameEnd++;
+    name.assign( base + pos + 1, nameEnd - pos - 1 );
+    for ( unsigned int i=0; i < name.size(); i++ )
+      name[i] = tolower(name[i]);
+    return pos;
+  }
+  return end;
+}
+
+int XmlTraceScanner::recordNodeId( const char *base, size_t start, size_t end )
+{
+  size_t pos = start;
+  while ( pos < end )
+  {
+    const char *lt = (const char *)memchr( base + pos, '<', end - pos );
+    if ( lt == NULL )
+      return -1;
+    pos = ( lt - base ) + 1;
+    if ( pos + 7 <= end && strncasecmp( base + pos, "nodeid>", 7 ) == 0 )
+    {
+      pos += 7;
+      while ( pos < end && isspace(base[pos]) )
+        pos++;
+      return atoi( base + pos );
+    }
+  }
+  return -1;
+}
@@ -0,0 +1,63 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+#ifndef __XML_TRACE_SCANNER_INCLUDED__
+#define __XML_TRACE_SCANNER_INCLUDED__
+
+#include <string>
+#include <stddef.h>
+
+/**
+ * @brief Raw scanning of XML traces held in memory.
+ *
+ * These helpers locate the root element and the top level records of a XML trace
+ * without running a XML parser. They are used to split traces for parallel parsing
+ * and to index the records of each node. The records themselves are always read with
+ * the XmlTraceParser.
+ *
+ * The scanner assumes record end tags do not appear inside comments or CDATA sections.
+ * Traces generated by the MobiTrace toolbox never contain either.
+ *
+ * @author Kristjan V. Jonsson
+ */
+class XmlTraceScanner
+{
+  public:
+    /** @brief Locates the root element. Returns false if the trace has no root element
+               with content. The body is the content between the root start and end tags. */
+    static bool findBody( const char *base, size_t size, std::string &rootName,
+                          size_t &bodyStart, size_t &bodyEnd );
+    /** @brief Returns the position just after the first record end tag at or after pos, 
+               or end if there is none. */
+    static size_t recordEnd( const char *base, size_t pos, size_t end );
+    /** @brief Returns the position of the next record start tag at or after pos, or end
+               if there is none. The lower case element name is returned in name. */
+    static size_t nextRecord( const char *base, size_t pos, size_t end, std::string &name );
+    /** @brief Returns the nodeid value of the record in [start,end), or -1 if it has none. */
+    static int recordNodeId( const char *base, size_t start, size_t end );
+};
+
+#endif /* __XML_TRACE_SCANNER_INCLUDED__ */
@@ -0,0 +1,285 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+/**
+ * @file contactbench.cc
+ * @brief opposim-contactbench, a benchmark of the central contact scheduler.
+ *
+ * Delivers the same random contact lists of 1000, 10000 and 100000 nodes in two ways.
+ * The contacts are found by periodic scans, as in Bluetooth contact traces, so many
+ * contacts share a time. The first way follows ContactNotifier, with a contact event
+ * per node in a binary heap, as in the future event set of OMNeT++, rescheduled after
+ * each contact. The second keeps the next contact of every node in a ContactCalendar,
+ * as the ContactScheduler module does, with one event per contact time. The wall
+ * clock time, the number of events and the number of contacts of each are reported,
+ * and whether both delivered the contacts in the same order.
+ *
+ * Usage: opposim-contactbench [-c contacts] [-g gap] [-s scan] [nodes...]
+ *
+ * @author Kristjan V. Jonsson
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+#include <queue>
+#include "TraceTypes.h"
+#include "ContactCalendar.h"
+
+static double wallClock()
+{
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/**
+ * @brief Linear congruential generator, so that the contacts of a run do not 
+ *        depend on the C library.
+ */
+class BenchRandom
+{
+  private:
+    unsigned long long m_state;
+
+  public:
+    BenchRandom( unsigned long long seed ) { m_state = seed; }
+    double uniform( double low, double high )
+    {
+      m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+      return low + ( high - low ) * ( ( m_state >> 11 ) * ( 1.0 / 9007199254740992.0 ) );
+    }
+};
+
+/**
+ * @brief A contact event of a node in the event heap
+ */
+struct ContactHeapEvent
+{
+  double        time;
+  unsigned long serial;
+  unsigned int  node;
+};
+
+/**
+ * @brief Orders the event heap by time and then by scheduling order, as the future
+ *        event set
+ */
+struct ContactHeapEventLater
+{
+  bool operator()( const ContactHeapEvent &a, const ContactHeapEvent &b ) const
+  {
+    if ( a.time != b.time )
+      return a.time > b.time;
+    return a.serial > b.serial;
+  }
+};
+
+typedef std::priority_queue<ContactHeapEvent,std::vector<ContactHeapEvent>,ContactHeapEventLater> CONTACT_HEAP_TYPE;
+
+struct BENCH_RESULT
+{
+  double        wallTime;
+  unsigned long events;
+  unsigned long contacts;
+  /** @brief A hash of the delivered contacts in order of delivery */
+  unsigned long long orderHash;
+};
+
+/** @brief Delivers a contact, folding it into the order hash */
+static inline void deliver( BENCH_RESULT &result, int id, const CONTACT &contact )
+{
+  result.orderHash = result.orderHash * 1099511628211ULL + id * 65537ULL + contact.peerId;
+  result.contacts++;
+}
+
+static void generateContacts( unsigned int nodes, unsigned int contacts, double gap, double scan,
+                              std::vector<contactEventsVector> &lists )
+{
+  BenchRandom random( 12345 );
+  lists.resize( nodes );
+  for ( unsigned int i=0; i < nodes; i++ )
+  {
+    // The time of each contact is relative to the previous one, as in a contact trace.
+    // Contacts are found at whole scan intervals.
+    double time = 0.0;
+    double previous = 0.0;
+    for ( unsigned int j=0; j < contacts; j++ )
+    {
+      time += random.uniform( 0.0, 2.0 * gap );
+      double found = scan > 0.0 ? ceil( time / scan ) * scan : time;
+      CONTACT contact;
+      contact.peerId = (int)random.uniform( 0.0, nodes );
+      contact.type = j % 2 == 0 ? Contact : Break;
+      contact.time = found - previous;
+      previous = found;
+      lists[i].push_back( contact );
+    }
+  }
+}
+
+static BENCH_RESULT runPerNode( const std::vector<contactEventsVector> &lists )
+{
+  BENCH_RESULT result;
+  result.events = 0;
+  result.contacts = 0;
+  result.orderHash = 0;
+  double start = wallClock();
+
+  std::vector<unsigned int> cursors( lists.size(), 0 );
+  CONTACT_HEAP_TYPE heap;
+  unsigned long serial = 0;
+  for ( unsigned int i=0; i < lists.size(); i++ )
+  {
+    if ( lists[i].empty() )
+      continue;
+    ContactHeapEvent event;
+    event.time = lists[i][0].time;
+    event.serial = serial++;
+    event.node = i;
+    heap.push( event );
+  }
+
+  while ( !heap.empty() )
+  {
+    ContactHeapEvent event = heap.top();
+    heap.pop();
+    result.events++;
+    const contactEventsVector &list = lists[event.node];
+    unsigned int &cursor = cursors[event.node];
+    deliver( result, event.node, list[cursor++] );
+    if ( cursor < list.size() )
+    {
+      event.time += list[cursor].time;
+      event.serial = serial++;
+      heap.push( event );
+    }
+  }
+
+  result.wallTime = wallClock() - start;
+  return result;
+}
+
+static BENCH_RESULT runCalendar( const std::vector<contactEventsVector> &lists, double scan )
+{
+  BENCH_RESULT result;
+  result.events = 0;
+  result.contacts = 0;
+  result.orderHash = 0;
+  double start = wallClock();
+
+  std::vector<unsigned int> cursors( lists.size(), 0 );
+  ContactCalendar calendar;
+  calendar.configure( scan > 0.0 ? scan : 1.0, 64 );
+  for ( unsigned int i=0; i < lists.size(); i++ )
+  {
+    if ( !lists[i].empty() )
+      calendar.insert( lists[i][0].time, i, 0 );
+  }
+
+  // One event per contact time, delivering all contacts of the time
+  while ( !calendar.empty() )
+  {
+    double now = calendar.top().time;
+    result.events++;
+    while ( !calendar.empty() && calendar.top().time <= now )
+    {
+      unsigned int node = calendar.top().slot;
+      calendar.pop();
+      const contactEventsVector &list = lists[node];
+      unsigned int &cursor = cursors[node];
+      deliver( result, node, list[cursor++] );
+      if ( cursor < list.size() )
+        calendar.insert( now + list[cursor].time, node, 0 );
+    }
+  }
+
+  result.wallTime = wallClock() - start;
+  return result;
+}
+
+static void usage()
+{
+  fprintf( stderr, "Usage: opposim-contactbench [-c contacts] [-g gap] [-s scan] [nodes...]\n" );
+  fprintf( stderr, "  -c  Contacts per node (default 100)\n" );
+  fprintf( stderr, "  -g  Mean seconds between the contacts of a node (default 600)\n" );
+  fprintf( stderr, "  -s  Scan interval in seconds, 0 for unaligned contacts (default 120)\n" );
+  fprintf( stderr, "  Node counts default to 1000 10000 100000\n" );
+  exit(2);
+}
+
+int main( int argc, char **argv )
+{
+  unsigned int contacts = 100;
+  double gap = 600.0;
+  double scan = 120.0;
+
+  int opt;
+  while ( ( opt = getopt( argc, argv, "c:g:s:h" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 'c': contacts = atoi(optarg); break;
+      case 'g': gap = atof(optarg); break;
+      case 's': scan = atof(optarg); break;
+      default:  usage();
+    }
+  }
+  if ( contacts < 1 || gap <= 0.0 || scan < 0.0 )
+    usage();
+
+  std::vector<unsigned int> nodeCounts;
+  for ( int i=optind; i < argc; i++ )
+    nodeCounts.push_back( atoi(argv[i]) );
+  if ( nodeCounts.empty() )
+  {
+    nodeCounts.push_back( 1000 );
+    nodeCounts.push_back( 10000 );
+    nodeCounts.push_back( 100000 );
+  }
+
+  printf( "%u contacts per node, %g s mean gap, %g s scan interval\n", contacts, gap, scan );
+  printf( "%8s %-9s %10s %12s %12s %12s\n", "nodes", "mode", "wall s", "events", "contacts", "contacts/s" );
+  for ( unsigned int i=0; i < nodeCounts.size(); i++ )
+  {
+    std::vector<contactEventsVector> lists;
+    generateContacts( nodeCounts[i], contacts, gap, scan, lists );
+
+    BENCH_RESULT perNode = runPerNode( lists );
+    BENCH_RESULT calendar = runCalendar( lists, scan );
+    printf( "%8u %-9s %10.3f %12lu %12lu %12.0f\n", nodeCounts[i], "per-node", perNode.wallTime,
+            perNode.events, perNode.contacts, perNode.contacts / perNode.wallTime );
+    printf( "%8u %-9s %10.3f %12lu %12lu %12.0f\n", nodeCounts[i], "scheduler", calendar.wallTime,
+            calendar.events, calendar.contacts, calendar.contacts / calendar.wallTime );
+    printf( "%8s speedup %.1fx, delivery order %s\n", "", perNode.wallTime / calendar.wallTime,
+            perNode.orderHash == calendar.orderHash ? "identical" : "differs" );
+  }
+  return 0;
+}
@@ -0,0 +1,334 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+/**
+ * @file mobilitybench.cc
+ * @brief opposim-mobilitybench, a benchmark of the central mobility manager.
+ *
+ * Moves the same random waypoint lists of 1000, 10000 and 100000 nodes in two ways.
+ * The first follows the stepped mode of TraceMobility, with each node a separate heap
+ * object with its own waypoint list, and an update event per node and step in a
+ * binary heap, as in the future event set of OMNeT++. The second steps all nodes in
+ * a MobilityEngine, as the MobilityManager module does, with one event per tick. The
+ * wall clock time, the number of events and the number of position updates of each
+ * are reported.
+ *
+ * Usage: opposim-mobilitybench [-t duration] [-i interval] [-w waypoints] [nodes...]
+ *
+ * @author Kristjan V. Jonsson
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <string>
+#include <list>
+#include <vector>
+#include <queue>
+#include "MobilityEngine.h"
+
+// The side of the square scenario in meters
+#define BENCH_SCENARIO_SIZE 1000.0
+
+static double wallClock()
+{
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/**
+ * @brief Linear congruential generator, so that the waypoints of a run do not 
+ *        depend on the C library.
+ */
+class BenchRandom
+{
+  private:
+    unsigned long long m_state;
+
+  public:
+    BenchRandom( unsigned long long seed ) { m_state = seed; }
+    double uniform( double low, double high )
+    {
+      m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+      return low + ( high - low ) * ( ( m_state >> 11 ) * ( 1.0 / 9007199254740992.0 ) );
+    }
+};
+
+/**
+ * @brief A node moved by its own update events, as TraceMobility in stepped mode.
+ */
+struct PerNodeMobility
+{
+  double x;
+  double y;
+  double targetX;
+  double targetY;
+  double stepX;
+  double stepY;
+  int    step;
+  int    numSteps;
+  std::list<WAYPOINT_EVENT> events;
+};
+
+/**
+ * @brief An update event of a node in the event heap
+ */
+struct NodeEvent
+{
+  double time;
+  unsigned long serial;
+  PerNodeMobility *node;
+};
+
+/**
+ * @brief Orders the event heap by time and then by scheduling order, as the future
+ *        event set
+ */
+struct NodeEventLater
+{
+  bool operator()( const NodeEvent &a, const NodeEvent &b ) const
+  {
+    if ( a.time != b.time )
+      return a.time > b.time;
+    return a.serial > b.serial;
+  }
+};
+
+typedef std::priority_queue<NodeEvent,std::vector<NodeEvent>,NodeEventLater> NODE_EVENT_HEAP_TYPE;
+
+struct BENCH_RESULT
+{
+  double        wallTime;
+  unsigned long events;
+  unsigned long updates;
+  /** @brief The sum of the final coordinates, so that the work is not optimized away */
+  double        checksum;
+};
+
+static void generateWaypoints( unsigned int nodes, unsigned int waypoints, 
+                               std::vector<std::list<WAYPOINT_EVENT>> &lists, std::vector<double> &startX,
+                               std::vector<double> &startY )
+{
+  BenchRandom random( 12345 );
+  lists.resize( nodes );
+  startX.resize( nodes );
+  startY.resize( nodes );
+  for ( unsigned int i=0; i < nodes; i++ )
+  {
+    startX[i] = random.uniform( 0.0, BENCH_SCENARIO_SIZE );
+    startY[i] = random.uniform( 0.0, BENCH_SCENARIO_SIZE );
+    double time = 0.0;
+    for ( unsigned int j=0; j < waypoints; j++ )
+    {
+      WAYPOINT_EVENT waypoint;
+      waypoint.id = i;
+      // Pedestrian to vehicle speeds, with pauses between some movements
+      time += random.uniform( 0.0, 60.0 );
+      waypoint.time = time;
+      waypoint.x = random.uniform( 0.0, BENCH_SCENARIO_SIZE );
+      waypoint.y = random.uniform( 0.0, BENCH_SCENARIO_SIZE );
+      waypoint.speed = random.uniform( 1.0, 15.0 );
+      lists[i].push_back( waypoint );
+    }
+  }
+}
+
+static void setTarget( PerNodeMobility *node, NODE_EVENT_HEAP_TYPE &heap, unsigned long &serial, 
+                       double now, double interval )
+{
+  WAYPOINT_EVENT waypoint = node->events.front();
+  node->events.pop_front();
+  node->targetX = waypoint.x;
+  node->targetY = waypoint.y;
+  double distance = sqrt( ( node->targetX - node->x ) * ( node->targetX - node->x ) +
+                          ( node->targetY - node->y ) * ( node->targetY - node->y ) );
+  node->numSteps = static_cast<int>( ceil( distance / waypoint.speed / interval ) );
+  if ( node->numSteps < 1 )
+    node->numSteps = 1;
+  node->stepX = ( node->targetX - node->x ) / node->numSteps;
+  node->stepY = ( node->targetY - node->y ) / node->numSteps;
+  node->step = 0;
+
+  NodeEvent event;
+  event.time = waypoint.time > now ? waypoint.time : now;
+  event.serial = serial++;
+  event.node = node;
+  heap.push( event );
+}
+
+static BENCH_RESULT runPerNode( const std::vector<std::list<WAYPOINT_EVENT>> &lists, const std::vector<double> &startX,
+                                const std::vector<double> &startY, double duration, double interval )
+{
+  BENCH_RESULT result;
+  result.events = 0;
+  result.updates = 0;
+  double start = wallClock();
+
+  std::vector<PerNodeMobility*> nodes( lists.size() );
+  NODE_EVENT_HEAP_TYPE heap;
+  unsigned long serial = 0;
+  for ( unsigned int i=0; i < lists.size(); i++ )
+  {
+    nodes[i] = new PerNodeMobility;
+    nodes[i]->x = startX[i];
+    nodes[i]->y = startY[i];
+    nodes[i]->events = lists[i];
+    setTarget( nodes[i], heap, serial, 0.0, interval );
+  }
+
+  while ( !heap.empty() && heap.top().time <= duration )
+  {
+    NodeEvent event = heap.top();
+    heap.pop();
+    result.events++;
+    PerNodeMobility *node = event.node;
+    if ( ++node->step >= node->numSteps )
+    {
+      node->x = node->targetX;
+      node->y = node->targetY;
+      if ( !node->events.empty() )
+        setTarget( node, heap, serial, event.time, interval );
+    }
+    else
+    {
+      node->x += node->stepX;
+      node->y += node->stepY;
+      event.time += interval;
+      event.serial = serial++;
+      heap.push( event );
+    }
+    result.updates++;
+  }
+
+  result.checksum = 0.0;
+  for ( unsigned int i=0; i < nodes.size(); i++ )
+  {
+    result.checksum += nodes[i]->x + nodes[i]->y;
+    delete nodes[i];
+  }
+  result.wallTime = wallClock() - start;
+  return result;
+}
+
+static BENCH_RESULT runEngine( const std::vector<std::list<WAYPOINT_EVENT>> &lists, const std::vector<double> &startX,
+                               const std::vector<double> &startY, double duration, double interval )
+{
+  BENCH_RESULT result;
+  result.events = 0;
+  result.updates = 0;
+  double start = wallClock();
+
+  MobilityEngine engine( interval );
+  for ( unsigned int i=0; i < lists.size(); i++ )
+  {
+    waypointEventsVector waypoints;
+    std::list<WAYPOINT_EVENT>::const_iterator iter;
+    for ( iter = lists[i].begin(); iter != lists[i].end(); iter++ )
+      waypoints.push_back( waypointOf( *iter ) );
+    engine.addNode( 0.0, startX[i], startY[i], waypoints );
+  }
+  engine.clearChanged();
+
+  double time = engine.nextTime( 0.0 );
+  while ( time >= 0.0 && time <= duration )
+  {
+    engine.step( time );
+    result.events++;
+    result.updates += engine.changed().size();
+    engine.clearChanged();
+    time = engine.nextTime( time );
+  }
+
+  result.checksum = 0.0;
+  for ( unsigned int i=0; i < engine.size(); i++ )
+    result.checksum += engine.x(i) + engine.y(i);
+  result.wallTime = wallClock() - start;
+  return result;
+}
+
+static void usage()
+{
+  fprintf( stderr, "Usage: opposim-mobilitybench [-t duration] [-i interval] [-w waypoints] [nodes...]\n" );
+  fprintf( stderr, "  -t  Simulated seconds (default 600)\n" );
+  fprintf( stderr, "  -i  Update interval in seconds (default 1)\n" );
+  fprintf( stderr, "  -w  Waypoints per node (default 20)\n" );
+  fprintf( stderr, "  Node counts default to 1000 10000 100000\n" );
+  exit(2);
+}
+
+int main( int argc, char **argv )
+{
+  double duration = 600.0;
+  double interval = 1.0;
+  unsigned int waypoints = 20;
+
+  int opt;
+  while ( ( opt = getopt( argc, argv, "t:i:w:h" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 't': duration = atof(optarg); break;
+      case 'i': interval = atof(optarg); break;
+      case 'w': waypoints = atoi(optarg); break;
+      default:  usage();
+    }
+  }
+  if ( duration <= 0.0 || interval <= 0.0 || waypoints < 1 )
+    usage();
+
+  std::vector<unsigned int> nodeCounts;
+  for ( int i=optind; i < argc; i++ )
+    nodeCounts.push_back( atoi(argv[i]) );
+  if ( nodeCounts.empty() )
+  {
+    nodeCounts.push_back( 1000 );
+    nodeCounts.push_back( 10000 );
+    nodeCounts.push_back( 100000 );
+  }
+
+  printf( "%u s simulated, %g s interval, %u waypoints per node\n", (unsigned int)duration, interval, waypoints );
+  printf( "%8s %-9s %10s %12s %12s %12s\n", "nodes", "mode", "wall s", "events", "updates", "updates/s" );
+  for ( unsigned int i=0; i < nodeCounts.size(); i++ )
+  {
+    std::vector<std::list<WAYPOINT_EVENT>> lists;
+    std::vector<double> startX, startY;
+    generateWaypoints( nodeCounts[i], waypoints, lists, startX, startY );
+
+    BENCH_RESULT perNode = runPerNode( lists, startX, startY, duration, interval );
+    BENCH_RESULT engine = runEngine( lists, startX, startY, duration, interval );
+    printf( "%8u %-9s %10.3f %12lu %12lu %12.0f\n", nodeCounts[i], "per-node", perNode.wallTime,
+            perNode.events, perNode.updates, perNode.updates / perNode.wallTime );
+    printf( "%8u %-9s %10.3f %12lu %12lu %12.0f\n", nodeCounts[i], "manager", engine.wallTime,
+            engine.events, engine.updates, engine.updates / engine.wallTime );
+    printf( "%8s speedup %.1fx, final location checksum difference %.2f m per node\n", "",
+            perNode.wallTime / engine.wallTime, 
+            fabs( perNode.checksum - engine.checksum ) / nodeCounts[i] );
+  }
+  return 0;
+}
@@ -0,0 +1,369 @@
+// ***************************************************************************
+//
+// OppoNet Project
+//
+// This file is a part of the opponet project, jointly managed by the
+// Laboratory for Communications Networks (LCN) at KTH in Stockholm, Sweden
+// and the Laboratory for Dependable Secure Systems (LDSS) at Reykjavik
+// University, Iceland.
+//
+// ***************************************************************************
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License version 3
+// as published by the Free Software Foundation.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+// ***************************************************************************
+
+/**
+ * @file tracec.cc
+ * @brief opposim-tracec, the offline trace compiler.
+ *
+ * Compiles a XML mobility or contact trace, as written by mobgen, rwpy, urbanmob or
+ * u2tr, into the binary trace format read by the NodeFactory (see BinaryTrace.h).
+ * Traces of other mobility generators are compiled directly with their trace source
+ * (see TraceSource.h): UDel output, with the samples of each node merged into linear
+ * segments within a tolerance, ns-2 setdest, BonnMotion and ONE movement files.
+ *
+ * Locations are validated against the scenario size and malformed records rejected
+ * when the trace is compiled. The commands are ordered by time and the waypoints and
+ * contacts grouped by node and ordered by time. The output is marked as validated, so
+ * simulation runs with a scenario no smaller than the one given here skip validation.
+ *
+ * With -s, the memory taken by the waypoints of the trace in the node modules is
+ * reported for each waypoint encoding (see CompactTrace.h), with the largest error of
+ * the lossy encodings.
+ *
+ * Usage: opposim-tracec [-x sizeX] [-y sizeY] [-j threads] [-f format] [-e tolerance] [-s]
+ *                       input output.bin
+ *
+ * @author Kristjan V. Jonsson
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <set>
+#include <map>
+#include "XmlTraceParser.h"
+#include "ParallelTraceParser.h"
+#include "TraceSource.h"
+#include "BinaryTrace.h"
+#include "CompactTrace.h"
+
+/**
+ * @brief Checks the records of a trace and passes them on to a binary trace writer.
+ *
+ * The first malformed record is reported and the rest of the trace ignored.
+ */
+class CompilerSink : public TraceSink
+{
+  public:
+    BinaryTraceWriter *writer;
+    TRACE_TYPE         traceType;
+    unsigned long      commands;
+    unsigned long      records;
+    /** @brief The number of records read before an earlier record of the same node */
+    unsigned long      reordered;
+    std::set<int>      createdNodes;
+    std::set<int>      recordNodes;
+    std::map<int,double> lastTimes;
+    /** @brief The waypoints of each node, kept for the storage report */
+    bool               keepWaypoints;
+    std::map<int,waypointEventsVector> nodeWaypoints;
+    std::string        error;
+
+  public:
+    CompilerSink()
+    {
+      writer = NULL;
+      traceType = None;
+      commands = 0;
+      records = 0;
+      reordered = 0;
+      keepWaypoints = false;
+    }
+
+    virtual void beginTrace( TRACE_TYPE type, unsigned long nodesHint, unsigned long recordsHint )
+    {
+      traceType = type;
+      writer = new BinaryTraceWriter( type == ContactTrace ? BINARY_CONTACT_TRACE : BINARY_MOBILITY_TRACE );
+    }
+
+    virtual void addCommand( const TRACE_COMMAND &command )
+    {
+      if ( !_checkTime( command.time, command.nodeId ) )
+        return;
+      if ( command.kind == CREATE_EVENT_KIND )
+        createdNodes.insert( command.nodeId );
+      writer->addCommand( command );
+      commands++;
+    }
+
+    virtual void addWaypoint( const WAYPOINT_EVENT &waypoint )
+    {
+      if ( !_checkTime( waypoint.time, waypoint.id ) )
+        return;
+      if ( !( waypoint.speed >= 0.0 ) )
+      {
+        _setError( "Invalid waypoint speed", waypoint.id, waypoint.time );
+        return;
+      }
+      _checkOrder( waypoint.id, waypoint.time );
+      writer->addWaypoint( waypoint );
+      if ( keepWaypoints )
+        nodeWaypoints[waypoint.id].push_back( waypointOf( waypoint ) );
+      records++;
+    }
+
+    virtual void addContact( const CONTACT_EVENT &contact )
+    {
+      if ( !_checkTime( contact.time, contact.id ) )
+        return;
+      if ( contact.peerId == contact.id )
+      {
+        _setError( "Contact of a node with itself", contact.id, contact.time );
+        return;
+      }
+      _checkOrder( contact.id, contact.time );
+      writer->addContact( contact );
+      records++;
+    }
+
+    /** @brief Returns the number of nodes with records but no create command */
+    unsigned long uncreatedNodes() const
+    {
+      unsigned long count = 0;
+      std::set<int>::const_iterator iter;
+      for ( iter = recordNodes.begin(); iter != recordNodes.end(); iter++ )
+        if ( createdNodes.find(*iter) == createdNodes.end() )
+          count++;
+      return count;
+    }
+
+  private:
+    bool _checkTime( double time, int nodeId )
+    {
+      if ( !error.empty() )
+        return false;
+      if ( !( time >= 0.0 ) || isinf(time) )
+      {
+        _setError( "Invalid event time", nodeId, time );
+        return false;
+      }
+      return true;
+    }
+
+    void _checkOrder( int nodeId, double time )
+    {
+      recordNodes.insert( nodeId );
+      std::map<int,double>::iterator iter = lastTimes.find( nodeId );
+      if ( iter == lastTimes.end() )
+        lastTimes[nodeId] = time;
+      else if ( time < iter->second )
+        reordered++;
+      else
+        iter->second = time;
+    }
+
+    void _setError( const char *message, int nodeId, double time )
+    {
+      char buffer[200];
+      snprintf( buffer, sizeof(buffer), "%s (node %d, time %g)", message, nodeId, time );
+      error = buffer;
+    }
+};
+
+static double wallClock()
+{
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/**
+ * @brief Reports the bytes per waypoint of the waypoints of a trace held in a waypoint
+ *        list, as before the compact storage, and in each encoding of WaypointStore,
+ *        with the largest time and location errors of each.
+ */
+static void reportWaypointStorage( const std::map<int,waypointEventsVector> &nodeWaypoints )
+{
+  unsigned long waypoints = 0;
+  std::map<int,waypointEventsVector>::const_iterator iter;
+  for ( iter = nodeWaypoints.begin(); iter != nodeWaypoints.end(); iter++ )
+    waypoints += iter->second.size();
+  if ( waypoints == 0 )
+    return;
+
+  // A list node holds two pointers and the waypoint, in a heap chunk with an 8 byte
+  // header rounded up to 16 bytes, as allocated by glibc
+  unsigned long listBytes = ( sizeof(WAYPOINT_EVENT) + 2 * sizeof(void*) + 8 + 15 ) / 16 * 16;
+  printf( "    Waypoint storage:\n" );
+  printf( "      list:          %.1f bytes/waypoint (estimated)\n", (double)listBytes );
+
+  const char *names[] = { "double:", "float:", "delta:" };
+  for ( int e=DoubleEncoding; e <= DeltaEncoding; e++ )
+  {
+    WaypointStore store( static_cast<WAYPOINT_ENCODING>(e) );
+    unsigned long bytes = 0;
+    double timeError = 0.0;
+    double locationError = 0.0;
+    for ( iter = nodeWaypoints.begin(); iter != nodeWaypoints.end(); iter++ )
+    {
+      const waypointEventsVector &original = iter->second;
+      store.assign( original );
+      bytes += store.bytes();
+      for ( unsigned int i=0; i < original.size(); i++ )
+      {
+        WAYPOINT decoded = store.next();
+        double dt = fabs( decoded.time - original[i].time );
+        double dl = sqrt( ( decoded.x - original[i].x ) * ( decoded.x - original[i].x ) +
+                          ( decoded.y - original[i].y ) * ( decoded.y - original[i].y ) );
+        if ( dt > timeError )
+          timeError = dt;
+        if ( dl > locationError )
+          locationError = dl;
+      }
+    }
+    printf( "      %-14s %.1f bytes/waypoint, max error %g s, %g m\n", names[e],
+            (double)bytes / waypoints, timeError, locationError );
+  }
+}
+
+static void usage()
+{
+  fprintf( stderr, "Usage: opposim-tracec [-x sizeX] [-y sizeY] [-j threads] [-f format] [-e tolerance] [-s]\n" );
+  fprintf( stderr, "                      input output.bin\n" );
+  fprintf( stderr, "  -x, -y  Scenario size used to validate locations, 0 disables (default 1000)\n" );
+  fprintf( stderr, "  -j      XML parser threads, 0 for one per processor (default 0)\n" );
+  fprintf( stderr, "  -f      Input format, xml, udel, ns2, bonnmotion or one (default xml)\n" );
+  fprintf( stderr, "  -e      Maximum location error in meters when merging UDel samples (default 1)\n" );
+  fprintf( stderr, "  -s      Report the waypoint storage of each encoding\n" );
+  exit(2);
+}
+
+int main( int argc, char **argv )
+{
+  double scenarioSizeX = 1000;
+  double scenarioSizeY = 1000;
+  int threads = 0;
+  std::string format = "xml";
+  double tolerance = 1.0;
+  bool storageReport = false;
+
+  int opt;
+  while ( ( opt = getopt( argc, argv, "x:y:j:f:e:sh" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 'x': scenarioSizeX = atof(optarg); break;
+      case 'y': scenarioSizeY = atof(optarg); break;
+      case 'j': threads = atoi(optarg); break;
+      case 'f': format = optarg; break;
+      case 'e': tolerance = atof(optarg); break;
+      case 's': storageReport = true; break;
+      default:  usage();
+    }
+  }
+  TraceSource *source = NULL;
+  if ( format != "xml" )
+    source = TraceSource::create( format, scenarioSizeX, scenarioSizeY, tolerance );
+  if ( argc - optind != 2 || ( format != "xml" && source == NULL ) || tolerance < 0.0 )
+    usage();
+  const char *inputFile = argv[optind];
+  const char *outputFile = argv[optind+1];
+
+  double start = wallClock();
+
+  CompilerSink sink;
+  sink.keepWaypoints = storageReport;
+  ParallelTraceParser parser( scenarioSizeX, scenarioSizeY, threads );
+  bool ok;
+  std::string parseError;
+  if ( source != NULL )
+  {
+    ok = source->parseFile( inputFile, &sink );
+    parseError = source->lastError();
+  }
+  else
+  {
+    ok = parser.parseFile( inputFile, &sink );
+    parseError = parser.lastError();
+    xmlCleanupParser();
+  }
+  if ( !ok )
+  {
+    fprintf( stderr, "%s: %s\n", inputFile, parseError.c_str() );
+    return 1;
+  }
+  if ( sink.writer == NULL )
+  {
+    fprintf( stderr, "%s: Unspecified or unsupported trace\n", inputFile );
+    return 1;
+  }
+  if ( !sink.error.empty() )
+  {
+    fprintf( stderr, "%s: %s\n", inputFile, sink.error.c_str() );
+    delete sink.writer;
+    return 1;
+  }
+  double parseTime = wallClock() - start;
+
+  sink.writer->setValidated( scenarioSizeX, scenarioSizeY );
+  sink.writer->sortRecords();
+  ok = sink.writer->write( outputFile );
+  std::string writeError = sink.writer->lastError();
+  delete sink.writer;
+  if ( !ok )
+  {
+    fprintf( stderr, "%s: %s\n", outputFile, writeError.c_str() );
+    unlink( outputFile );
+    return 1;
+  }
+  double totalTime = wallClock() - start;
+
+  struct stat inputStat, outputStat;
+  stat( inputFile, &inputStat );
+  stat( outputFile, &outputStat );
+  unsigned long total = sink.commands + sink.records;
+
+  printf( "Compiled %s to %s\n", inputFile, outputFile );
+  printf( "    Trace type:      %s\n", sink.traceType == ContactTrace ? "contact" : "mobility" );
+  printf( "    Scenario size:   (%g,%g) m\n", scenarioSizeX, scenarioSizeY );
+  if ( source != NULL )
+  {
+    if ( format == "udel" )
+      printf( "    Tolerance:       %g m\n", tolerance );
+    printf( "    Source samples:  %lu\n", source->samples() );
+  }
+  else
+    printf( "    Parser chunks:   %d\n", parser.chunks() );
+  printf( "    Commands:        %lu\n", sink.commands );
+  printf( "    %s       %lu\n", sink.traceType == ContactTrace ? "Contacts: " : "Waypoints:", sink.records );
+  printf( "    Reordered:       %lu\n", sink.reordered );
+  printf( "    Parse time:      %.3f s\n", parseTime );
+  printf( "    Total time:      %.3f s\n", totalTime );
+  printf( "    Rate:            %.0f records/s\n", totalTime > 0.0 ? total / totalTime : 0.0 );
+  printf( "    Input size:      %lld bytes\n", (long long)inputStat.st_size );
+  printf( "    Output size:     %lld bytes (%.1f bytes/record, %.1f%% of input)\n",
+          (long long)outputStat.st_size, total > 0 ? (double)outputStat.st_size / total : 0.0,
+          inputStat.st_size > 0 ? 100.0 * outputStat.st_size / inputStat.st_size : 0.0 );
+  if ( storageReport )
+    reportWaypointStorage( sink.nodeWaypoints );
+  if ( sink.uncreatedNodes() > 0 )
+    printf( "Warning: %lu nodes have records but are never created\n", sink.uncreatedNodes() );
+  delete source;
+  return 0;
+}